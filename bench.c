@@ -0,0 +1,570 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "leptjson.h"
+#if defined(LEPT_HAVE_FD)
+#include <sys/time.h> /* gettimeofday() */
+#endif
+
+/* Growable output buffer for the generated documents */
+typedef struct {
+    char* s;
+    size_t len, cap;
+} buffer;
+
+static void buffer_puts(buffer* b, const char* s, size_t len) {
+    if (b->len + len + 1 > b->cap) {
+        while (b->len + len + 1 > b->cap)
+            b->cap = b->cap ? b->cap * 2 : 4096;
+        b->s = (char*)realloc(b->s, b->cap);
+    }
+    memcpy(b->s + b->len, s, len);
+    b->len += len;
+    b->s[b->len] = '\0';
+}
+
+#define PUTS(b, s) buffer_puts(b, s, strlen(s))
+
+/* An array of long strings, mostly clean with an escape now and then */
+static char* make_strings(size_t count, size_t len) {
+    buffer b = { NULL, 0, 0 };
+    size_t i, j;
+    PUTS(&b, "[");
+    for (i = 0; i < count; i++) {
+        PUTS(&b, i ? ",\"" : "\"");
+        for (j = 0; j < len; j++) {
+            if (j % 61 == 60)
+                PUTS(&b, "\\n");
+            else {
+                char ch = (char)('a' + (i + j) % 26);
+                buffer_puts(&b, &ch, 1);
+            }
+        }
+        PUTS(&b, "\"");
+    }
+    PUTS(&b, "]");
+    return b.s;
+}
+
+/* A pretty-printed array of records, indented by four spaces per level */
+static char* make_indented(size_t count) {
+    buffer b = { NULL, 0, 0 };
+    size_t i;
+    char num[32];
+    PUTS(&b, "[\n");
+    for (i = 0; i < count; i++) {
+        sprintf(num, "%lu", (unsigned long)i);
+        PUTS(&b, "    {\n");
+        PUTS(&b, "        \"id\": "); PUTS(&b, num); PUTS(&b, ",\n");
+        PUTS(&b, "        \"active\": true,\n");
+        PUTS(&b, "        \"tags\": [\n");
+        PUTS(&b, "            \"a\",\n");
+        PUTS(&b, "            \"b\"\n");
+        PUTS(&b, "        ],\n");
+        PUTS(&b, "        \"owner\": {\n");
+        PUTS(&b, "            \"name\": \"x\",\n");
+        PUTS(&b, "            \"level\": null\n");
+        PUTS(&b, "        }\n");
+        PUTS(&b, i + 1 < count ? "    },\n" : "    }\n");
+    }
+    PUTS(&b, "]\n");
+    return b.s;
+}
+
+/* An array of doubles printed with full precision, plus some small integers */
+static char* make_numbers(size_t count) {
+    buffer b = { NULL, 0, 0 };
+    size_t i;
+    char num[32];
+    unsigned long seed = 12345;
+    PUTS(&b, "[");
+    for (i = 0; i < count; i++) {
+        seed = seed * 1103515245 + 12345;
+        if (i % 4 == 0)
+            sprintf(num, "%lu", (seed >> 16) % 1000);
+        else
+            sprintf(num, "%.17g", (double)(seed >> 8) / ((seed & 0xFF) + 1) * 1e-3);
+        PUTS(&b, i ? "," : "");
+        PUTS(&b, num);
+    }
+    PUTS(&b, "]");
+    return b.s;
+}
+
+/* One record per line, as in a log file */
+static char* make_lines(size_t count) {
+    buffer b = { NULL, 0, 0 };
+    size_t i;
+    char line[128];
+    for (i = 0; i < count; i++) {
+        sprintf(line, "{\"id\":%lu,\"level\":\"info\",\"tags\":[\"a\",\"b\"],\"took\":%lu.25}\n",
+            (unsigned long)i, (unsigned long)(i % 1000));
+        PUTS(&b, line);
+    }
+    return b.s;
+}
+
+/* An array of wide records: 200 fields each, numbers and strings alternating */
+static char* make_records(size_t count) {
+    buffer b = { NULL, 0, 0 };
+    size_t i, j;
+    char field[64];
+    PUTS(&b, "[");
+    for (i = 0; i < count; i++) {
+        PUTS(&b, i ? ",{" : "{");
+        for (j = 0; j < 200; j++) {
+            if (j % 2)
+                sprintf(field, "%s\"f%lu\":\"value %lu\"", j ? "," : "", (unsigned long)j, (unsigned long)(i + j));
+            else
+                sprintf(field, "%s\"f%lu\":%lu", j ? "," : "", (unsigned long)j, (unsigned long)(i * j));
+            PUTS(&b, field);
+        }
+        PUTS(&b, "}");
+    }
+    PUTS(&b, "]");
+    return b.s;
+}
+
+/* An array of narrow documents nested @depth levels, arrays and objects alternating */
+static char* make_deep(size_t count, size_t depth) {
+    buffer b = { NULL, 0, 0 };
+    size_t i, j;
+    PUTS(&b, "[");
+    for (i = 0; i < count; i++) {
+        PUTS(&b, i ? "," : "");
+        for (j = 0; j < depth; j++)
+            PUTS(&b, j % 2 ? "{\"a\":" : "[");
+        PUTS(&b, "1");
+        for (j = depth; j-- > 0; )
+            PUTS(&b, j % 2 ? "}" : "]");
+    }
+    PUTS(&b, "]");
+    return b.s;
+}
+
+static double seconds(clock_t start) {
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+/* Wall-clock time, for the benchmarks that run on several threads */
+static double wall(void) {
+#if defined(LEPT_HAVE_FD)
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+#else
+    return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+static void bench_parse(const char* name, const char* json, int iterations, int engine, lept_key_pool* keys) {
+    size_t len = strlen(json);
+    lept_parse_options options;
+    clock_t start;
+    double t;
+    int i;
+    lept_parse_options_init(&options);
+    options.engine = engine;
+    options.keys = keys;
+    start = clock();
+    for (i = 0; i < iterations; i++) {
+        lept_value v;
+        lept_init(&v);
+        if (lept_parse_ex(&v, json, len, &options) != LEPT_PARSE_OK) {
+            fprintf(stderr, "%s: parse error\n", name);
+            exit(1);
+        }
+        lept_free(&v);
+    }
+    t = seconds(start);
+    printf("%-24s %8.1f MB/s\n", name, (double)len * iterations / t / 1e6);
+}
+
+/* @json loaded from a file: mapped by lept_parse_file(), or read into a NUL-terminated buffer */
+static void bench_file(const char* name, const char* json, int iterations, int mapped) {
+    static const char path[] = "leptjson_bench.json";
+    size_t len = strlen(json);
+    double start, t;
+    FILE* fp;
+    int i;
+    if ((fp = fopen(path, "wb")) == NULL || fwrite(json, 1, len, fp) != len || fclose(fp) != 0) {
+        fprintf(stderr, "%s: cannot write %s\n", name, path);
+        exit(1);
+    }
+    start = wall();
+    for (i = 0; i < iterations; i++) {
+        lept_value v;
+        int ret;
+        lept_init(&v);
+        if (mapped)
+            ret = lept_parse_file(&v, path, NULL);
+        else {
+            char* buffer = (char*)malloc(len + 1);
+            fp = fopen(path, "rb");
+            buffer[fread(buffer, 1, len, fp)] = '\0';
+            fclose(fp);
+            ret = lept_parse(&v, buffer);
+            free(buffer);
+        }
+        if (ret != LEPT_PARSE_OK) {
+            fprintf(stderr, "%s: parse error\n", name);
+            exit(1);
+        }
+        lept_free(&v);
+    }
+    t = wall() - start;
+    printf("%-24s %8.1f MB/s\n", name, (double)len * iterations / t / 1e6);
+    remove(path);
+}
+
+/* A small message parsed @count times, through lept_parse_ex() or one reused lept_parser */
+static void bench_messages(const char* name, const char* json, long count, int reuse) {
+    size_t len = strlen(json);
+    lept_parser* p = lept_parser_new(NULL, 0);
+    clock_t start;
+    double t;
+    long i;
+    start = clock();
+    for (i = 0; i < count; i++) {
+        lept_value v;
+        lept_init(&v);
+        if ((reuse ? lept_parser_parse(p, &v, json, len) : lept_parse_ex(&v, json, len, NULL)) != LEPT_PARSE_OK) {
+            fprintf(stderr, "%s: parse error\n", name);
+            exit(1);
+        }
+        lept_free(&v);
+    }
+    t = seconds(start);
+    printf("%-24s %8.2f M msgs/s\n", name, count / t / 1e6);
+    lept_parser_free(p);
+}
+
+/* One large root array parsed on @threads threads */
+static void bench_parallel(const char* name, const char* json, int iterations, size_t threads) {
+    size_t len = strlen(json);
+    lept_parse_options options;
+    double start, t;
+    int i;
+    lept_parse_options_init(&options);
+    options.threads = threads;
+    start = wall();
+    for (i = 0; i < iterations; i++) {
+        lept_value v;
+        lept_init(&v);
+        if (lept_parse_ex(&v, json, len, &options) != LEPT_PARSE_OK) {
+            fprintf(stderr, "%s: parse error\n", name);
+            exit(1);
+        }
+        lept_free(&v);
+    }
+    t = wall() - start;
+    printf("%-24s %8.1f MB/s\n", name, (double)len * iterations / t / 1e6);
+}
+
+/* Every line of an NDJSON document parsed on @threads threads */
+static void bench_ndjson(const char* name, const char* json, int iterations, size_t threads) {
+    size_t len = strlen(json), count;
+    lept_record* records;
+    double start, t;
+    int i;
+    start = wall();
+    for (i = 0; i < iterations; i++) {
+        count = lept_parse_ndjson(json, len, threads, &records);
+        if (count == 0 || records[count - 1].result != LEPT_PARSE_OK) {
+            fprintf(stderr, "%s: parse error\n", name);
+            exit(1);
+        }
+        lept_free_records(records, count);
+    }
+    t = wall() - start;
+    printf("%-24s %8.1f MB/s\n", name, (double)len * iterations / t / 1e6);
+}
+
+/* The same document fed to the push parser in @chunk-byte pieces */
+static void bench_push(const char* name, const char* json, int iterations, size_t chunk) {
+    size_t len = strlen(json), i;
+    lept_push_parser* p = lept_push_parser_new();
+    clock_t start;
+    double t;
+    int k;
+    start = clock();
+    for (k = 0; k < iterations; k++) {
+        lept_value v;
+        for (i = 0; i < len; i += chunk)
+            lept_push_parser_feed(p, json + i, len - i < chunk ? len - i : chunk);
+        if (lept_push_parser_finish(p, &v) != LEPT_PARSE_OK) {
+            fprintf(stderr, "%s: parse error\n", name);
+            exit(1);
+        }
+        lept_free(&v);
+    }
+    t = seconds(start);
+    printf("%-24s %8.1f MB/s\n", name, (double)len * iterations / t / 1e6);
+    lept_push_parser_free(p);
+}
+
+/* Read three fields of every record: full tree plus lookups, or a cursor */
+static void bench_fields(const char* name, const char* json, int iterations, int cursor) {
+    static const char* keys[] = { "f10", "f101", "f150" };
+    size_t len = strlen(json), i;
+    double sum = 0.0;
+    clock_t start;
+    double t;
+    int k, j;
+    start = clock();
+    for (k = 0; k < iterations; k++) {
+        if (cursor) {
+            lept_cursor cur;
+            const char* key;
+            size_t klen;
+            double n;
+            int more, found;
+            lept_cursor_init(&cur, json, len);
+            lept_cursor_enter_array(&cur);
+            while (lept_cursor_next_element(&cur, &more) == LEPT_PARSE_OK && more) {
+                lept_cursor_enter_object(&cur);
+                for (j = 0; j < 3; j++) {
+                    lept_cursor_find_key(&cur, keys[j], strlen(keys[j]), &found);
+                    if (j != 1 && lept_cursor_get_number(&cur, &n) == LEPT_PARSE_OK)
+                        sum += n;
+                }
+                while (lept_cursor_next_member(&cur, &key, &klen) == LEPT_PARSE_OK && key)
+                    ;
+            }
+            lept_cursor_free(&cur);
+        }
+        else {
+            lept_value v;
+            lept_init(&v);
+            lept_parse_ex(&v, json, len, NULL);
+            for (i = 0; i < lept_get_array_size(&v); i++)
+                for (j = 0; j < 3; j += 2)
+                    sum += lept_get_number(lept_find_object_value(lept_get_array_element(&v, i), keys[j], strlen(keys[j])));
+            lept_free(&v);
+        }
+    }
+    t = seconds(start);
+    printf("%-24s %8.1f MB/s (%g)\n", name, (double)len * iterations / t / 1e6, sum);
+}
+
+/* Build one object of @count keys with lept_set_object_value(), then look every key up */
+static void bench_object(const char* name, size_t count, int iterations) {
+    char key[32];
+    size_t i;
+    double sum = 0.0;
+    clock_t start;
+    double t;
+    int k;
+    start = clock();
+    for (k = 0; k < iterations; k++) {
+        lept_value o;
+        lept_init(&o);
+        lept_set_object(&o, 0);
+        for (i = 0; i < count; i++) {
+            sprintf(key, "feature_%lu", (unsigned long)i);
+            lept_set_number(lept_set_object_value(&o, key, strlen(key)), (double)i);
+        }
+        for (i = 0; i < count; i++) {
+            sprintf(key, "feature_%lu", (unsigned long)i);
+            sum += lept_get_number(lept_find_object_value(&o, key, strlen(key)));
+        }
+        lept_free(&o);
+    }
+    t = seconds(start);
+    printf("%-24s %8.1f Mkeys/s (%g)\n", name, (double)count * iterations / t / 1e6, sum);
+}
+
+/* Allocator hooks that keep the number of live bytes, with the size in front of each block */
+static void* size_alloc(void* ctx, size_t size) {
+    size_t* p = (size_t*)malloc(sizeof(double) + size);
+    *(size_t*)ctx += size;
+    *p = size;
+    return (char*)p + sizeof(double);
+}
+
+static void* size_realloc(void* ctx, void* ptr, size_t size) {
+    size_t* p = (size_t*)((char*)ptr - sizeof(double));
+    *(size_t*)ctx += size - *p;
+    p = (size_t*)realloc(p, sizeof(double) + size);
+    *p = size;
+    return (char*)p + sizeof(double);
+}
+
+static void size_free(void* ctx, void* ptr) {
+    size_t* p = (size_t*)((char*)ptr - sizeof(double));
+    *(size_t*)ctx -= *p;
+    free(p);
+}
+
+/* Visit every value, summing numbers and string lengths */
+static double traverse(const lept_value* v, size_t* count) {
+    double sum = 0.0;
+    size_t i;
+    ++*count;
+    switch (lept_get_type(v)) {
+    case LEPT_NUMBER: return lept_get_number(v);
+    case LEPT_STRING: return (double)lept_get_string_length(v);
+    case LEPT_ARRAY:
+        for (i = 0; i < lept_get_array_size(v); i++)
+            sum += traverse(lept_get_array_element(v, i), count);
+        return sum;
+    case LEPT_OBJECT:
+        for (i = 0; i < lept_get_object_size(v); i++)
+            sum += traverse(lept_get_object_value(v, i), count) + (double)lept_get_object_key_length(v, i);
+        return sum;
+    default: return 0.0;
+    }
+}
+
+/* Heap bytes held by the parsed tree, and the time to walk it */
+static void bench_layout(const char* name, const char* json, int iterations) {
+    lept_allocator sized;
+    lept_value v;
+    size_t live = 0, count = 0;
+    double sum = 0.0;
+    clock_t start;
+    double t;
+    int i;
+    sized.alloc = size_alloc;
+    sized.realloc = size_realloc;
+    sized.free = size_free;
+    sized.ctx = &live;
+    lept_set_allocator(&sized);
+    lept_init(&v);
+    if (lept_parse(&v, json) != LEPT_PARSE_OK) {
+        fprintf(stderr, "%s: parse error\n", name);
+        exit(1);
+    }
+    start = clock();
+    for (i = 0; i < iterations; i++)
+        sum += traverse(&v, &count);
+    t = seconds(start);
+    printf("%-24s %8.1f MB held, %5.1f bytes/value, %6.1f Mvalues/s (%g)\n", name, live / 1e6,
+        (double)live / (count / iterations), count / t / 1e6, sum);
+    lept_free(&v);
+    lept_set_allocator(NULL);
+}
+
+static int count_write(void* ctx, const char* data, size_t len) {
+    (void)data;
+    *(size_t*)ctx += len;
+    return 1;
+}
+
+enum { STRINGIFY_HEAP, STRINGIFY_STREAM, STRINGIFY_BUFFER, STRINGIFY_PARALLEL, STRINGIFY_PATH };
+
+/*
+ * Stringify into a fresh heap buffer, to a writer that only counts, into one
+ * reused buffer, on 4 threads, or into a file
+ */
+static void bench_stringify(const char* name, const char* json, int iterations, int mode) {
+    lept_value v;
+    double start, t;
+    size_t length = 0, capacity = 0;
+    char* buffer = NULL;
+    int i;
+    lept_init(&v);
+    if (lept_parse(&v, json) != LEPT_PARSE_OK) {
+        fprintf(stderr, "%s: parse error\n", name);
+        exit(1);
+    }
+    if (mode == STRINGIFY_PATH)
+        length = lept_stringify_length(&v);
+    start = wall();
+    for (i = 0; i < iterations; i++) {
+        if (mode == STRINGIFY_STREAM) {
+            length = 0;
+            lept_stringify_to(&v, count_write, &length);
+        }
+        else if (mode == STRINGIFY_BUFFER) {
+            while ((length = lept_stringify_buffer(&v, buffer, capacity)) >= capacity)
+                buffer = (char*)realloc(buffer, capacity = length + 1);
+        }
+        else if (mode == STRINGIFY_PARALLEL)
+            free(lept_stringify_parallel(&v, &length, 4));
+        else if (mode == STRINGIFY_PATH)
+            lept_stringify_path(&v, "leptjson_bench.json");
+        else
+            free(lept_stringify(&v, &length));
+    }
+    t = wall() - start;
+    printf("%-24s %8.1f MB/s\n", name, (double)length * iterations / t / 1e6);
+    if (mode == STRINGIFY_PATH)
+        remove("leptjson_bench.json");
+    free(buffer);
+    lept_free(&v);
+}
+
+int main() {
+    lept_key_pool pool;
+    char* json;
+
+    printf("sizeof(lept_value) = %lu, sizeof(lept_member) = %lu\n",
+        (unsigned long)sizeof(lept_value), (unsigned long)sizeof(lept_member));
+
+    json = make_strings(20000, 200);
+    bench_parse("parse long strings", json, 50, LEPT_ENGINE_RECURSIVE, NULL);
+    bench_parse("  indexed engine", json, 50, LEPT_ENGINE_INDEXED, NULL);
+    free(json);
+
+    json = make_strings(200000, 8);
+    bench_parse("parse short strings", json, 20, LEPT_ENGINE_RECURSIVE, NULL);
+    bench_parse("  indexed engine", json, 20, LEPT_ENGINE_INDEXED, NULL);
+    bench_push("  push, 1460-byte chunks", json, 20, 1460);
+    free(json);
+
+    json = make_numbers(200000);
+    bench_parse("parse numbers", json, 20, LEPT_ENGINE_RECURSIVE, NULL);
+    bench_parse("  indexed engine", json, 20, LEPT_ENGINE_INDEXED, NULL);
+    bench_layout("  tree of numbers", json, 50);
+    bench_stringify("stringify numbers", json, 20, STRINGIFY_HEAP);
+    bench_stringify("  reused buffer", json, 20, STRINGIFY_BUFFER);
+    free(json);
+
+    json = make_records(2000);
+    bench_parse("parse records", json, 10, LEPT_ENGINE_RECURSIVE, NULL);
+    lept_key_pool_init(&pool, NULL);
+    bench_parse("  pooled keys", json, 10, LEPT_ENGINE_RECURSIVE, &pool);
+    lept_key_pool_free(&pool);
+    bench_layout("  tree of records", json, 20);
+    bench_parallel("  2 threads", json, 10, 2);
+    bench_parallel("  4 threads", json, 10, 4);
+    bench_fields("3 of 200 fields: tree", json, 10, 0);
+    bench_fields("  cursor", json, 10, 1);
+    bench_file("parse records file", json, 10, 1);
+    bench_file("  read into a buffer", json, 10, 0);
+    bench_stringify("stringify records", json, 10, STRINGIFY_HEAP);
+    bench_stringify("  streamed", json, 10, STRINGIFY_STREAM);
+    bench_stringify("  reused buffer", json, 10, STRINGIFY_BUFFER);
+    bench_stringify("  4 threads", json, 10, STRINGIFY_PARALLEL);
+    bench_stringify("  to a file", json, 10, STRINGIFY_PATH);
+    free(json);
+
+    bench_object("object of 10000 keys", 10000, 50);
+
+    json = "{\"id\":12345,\"user\":\"someone\",\"tags\":[\"a\",\"b\",\"c\"],\"geo\":{\"lat\":1.5,\"lon\":-2.25},\"ok\":true}";
+    bench_messages("small messages", json, 2000000, 0);
+    bench_messages("  reused parser", json, 2000000, 1);
+
+    json = make_lines(200000);
+    bench_ndjson("parse ndjson, 1 thread", json, 10, 1);
+    bench_ndjson("  2 threads", json, 10, 2);
+    bench_ndjson("  4 threads", json, 10, 4);
+    bench_ndjson("  all cores", json, 10, 0);
+    free(json);
+
+    json = make_indented(50000);
+    bench_parse("parse indented", json, 20, LEPT_ENGINE_RECURSIVE, NULL);
+    bench_layout("  tree of indented", json, 20);
+    bench_parse("  indexed engine", json, 20, LEPT_ENGINE_INDEXED, NULL);
+    bench_push("  push, 1460-byte chunks", json, 20, 1460);
+    free(json);
+
+    json = make_deep(2000, 200);
+    bench_parse("parse deep", json, 20, LEPT_ENGINE_RECURSIVE, NULL);
+    bench_stringify("stringify deep", json, 20, STRINGIFY_HEAP);
+    free(json);
+    return 0;
+}
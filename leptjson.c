@@ -1,33 +1,156 @@
+/* POSIX.1-2001 for posix_madvise() and posix_fadvise(), which -ansi hides on glibc */
+#if defined(__linux__) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L
+#endif
+
 #include <assert.h> /* assert() */
-#include <errno.h>  /* errno, ERANGE */
 #include <math.h>   /* HUGE_VAL */
 #include <stddef.h>
-#include <stdio.h>  /* sprintf() */
+#include <stdint.h> /* uint32_t, uint64_t */
 #include <stdlib.h> /* NULL, malloc(), realloc(), free(), strtod() */
-#include <string.h> /* memcpy(), strlen() */
+#include <string.h> /* memcpy(), memmove(), strlen() */
 
 #include "leptjson.h"
+#if defined(LEPT_HAVE_FD)
+#include <errno.h>    /* errno, EINTR */
+#include <fcntl.h>    /* open(), posix_fadvise() */
+#include <sys/mman.h> /* mmap(), posix_madvise() */
+#include <sys/stat.h> /* fstat() */
+#include <unistd.h>   /* read(), write(), close(), sysconf() */
+#endif
+
+/* Worker threads for the parallel entry points; define LEPT_NO_THREADS to run them serially */
+#if defined(LEPT_HAVE_FD) && !defined(LEPT_NO_THREADS)
+#define LEPT_HAVE_THREADS
+#include <pthread.h>
+#endif
+
+/*
+ * SIMD scanning is chosen at build time from the target: AVX2 when the
+ * compiler targets it (e.g. -mavx2), SSE2 on any x86-64, otherwise scalar.
+ * Define LEPT_NO_SIMD to force the scalar code.
+ */
+#if !defined(LEPT_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define LEPT_SSE2
+#include <emmintrin.h>
+#if defined(__AVX2__)
+#define LEPT_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
+/* Count trailing zeros of a non-zero mask */
+#if defined(_MSC_VER)
+#include <intrin.h>
+static unsigned lept_ctz(unsigned x) { unsigned long i; _BitScanForward(&i, x); return (unsigned)i; }
+#define LEPT_CTZ(x) lept_ctz(x)
+#elif defined(__GNUC__)
+#define LEPT_CTZ(x) ((unsigned)__builtin_ctz(x))
+#else
+static unsigned lept_ctz(unsigned x) { unsigned i = 0; while (!(x & 1)) { x >>= 1; i++; } return i; }
+#define LEPT_CTZ(x) lept_ctz(x)
+#endif
+
+static unsigned lept_ctz64(uint64_t x) {
+    return (uint32_t)x ? LEPT_CTZ((uint32_t)x) : 32 + LEPT_CTZ((uint32_t)(x >> 32));
+}
 
 #ifndef LEPT_PARSE_STACK_INIT_SIZE
-#define LEPT_PARSE_STACK_INIT_SIZE 256
+#define LEPT_PARSE_STACK_INIT_SIZE 512
 #endif
 
 #ifndef LEPT_PARSE_STRINGIFY_INIT_SIZE
 #define LEPT_PARSE_STRINGIFY_INIT_SIZE 256
 #endif
 
+#ifndef LEPT_WRITE_BUFFER_SIZE
+#define LEPT_WRITE_BUFFER_SIZE 65536 /* streaming stringify flushes at this size */
+#endif
+
+#ifndef LEPT_ARENA_BLOCK_SIZE
+#define LEPT_ARENA_BLOCK_SIZE 4096
+#endif
+
+#ifndef LEPT_OBJECT_HASH_THRESHOLD
+#define LEPT_OBJECT_HASH_THRESHOLD 16 /* objects this large get a hash index */
+#endif
+
+#ifndef LEPT_INDEXED_MAX_DEPTH
+#define LEPT_INDEXED_MAX_DEPTH 128 /* the two-stage engine recurses; deeper input goes to the other */
+#endif
+
+#ifndef LEPT_PARSER_STACK_LIMIT
+#define LEPT_PARSER_STACK_LIMIT 65536 /* default high-water mark of a lept_parser's stack */
+#endif
+
+#ifndef LEPT_PARALLEL_SLICE_SIZE
+#define LEPT_PARALLEL_SLICE_SIZE 65536 /* least input per slice of a parallel root array */
+#endif
+
+#ifndef LEPT_PARALLEL_RUN_SIZE
+#define LEPT_PARALLEL_RUN_SIZE 4096 /* least values per run of a parallel stringify */
+#endif
+
+/* lept_value.flags */
+#define LEPT_BORROWED_BUFFER 0x01 /* string/array/object buffer is not owned by the value */
+#define LEPT_BORROWED_KEYS   0x02 /* object member keys are not owned by the value */
+#define LEPT_INT64           0x04 /* number is stored in u.i */
+#define LEPT_UINT64          0x08 /* number is stored in u.ui (and exceeds INT64_MAX) */
+#define LEPT_HASH_INDEX      0x10 /* object members are followed by a hash index */
+#define LEPT_POOLED_KEYS     0x20 /* object member keys live in a lept_key_pool (and are borrowed) */
+#define LEPT_SHORT_STRING    0x40 /* string is stored inline, see SHORT_STRING() */
+
+/*
+ * A short string fills the bytes of the value in front of its type and keeps
+ * its remaining capacity in the last of them, which thus doubles as the NUL
+ * when the string is full.
+ */
+#define SHORT_STRING(v) ((char*)(v))
+#define LEPT_SHORT_MAX (offsetof(lept_value, type) - 1)
+
 #define EXPECT(c, ch)  do { assert(*c->json == (ch)); c->json++; } while(0)
 #define ISDIGIT(ch)         ((ch) >= '0' && (ch) <= '9')
 #define ISDIGIT1TO9(ch)     ((ch) >= '1' && (ch) <= '9')
 #define PUTC(c, ch)    do { *(char*)lept_context_push(c, sizeof(char)) = (ch); } while(0)
 #define PUTS(c, s, len)  memcpy(lept_context_push(c, len), s, len)
+/* Input is bounded by c->end; reading at the end yields '\0' */
+#define CHAR_AT(c, p)  ((p) < (c)->end ? *(p) : '\0')
+#define PEEK(c)        CHAR_AT(c, (c)->json)
 
 typedef struct {
     const char* json;
+    const char* end;
     char* stack;
     size_t size, top;
+    const lept_allocator* allocator; /* for the stack */
+    lept_arena* arena; /* where the tree is allocated, NULL for the heap */
+    int insitu;        /* strings are decoded inside the (writable) input */
+    lept_key_pool* keys; /* where member keys are interned, NULL to copy them */
+    size_t max_depth;    /* arrays and objects allowed to nest, (size_t)-1 for no limit */
+    const char* base;      /* start of the input the index refers to */
+    const uint32_t* index; /* structural index of the two-stage engine */
+    size_t index_size, index_pos;
+    size_t index_depth;    /* arrays and objects the two-stage engine is inside */
+    const lept_sax_handler* sax; /* report events instead of building the tree */
+    void* sax_ctx;
+    lept_write_func write;       /* streaming stringify: where the stack is flushed */
+    void* write_ctx;
+    int write_failed;
 } lept_context;
 
+/* Deliver a SAX event through the optional callback @cb */
+#define SAX_EVENT(c, cb, args) \
+    (!(c)->sax->cb || (c)->sax->cb args ? LEPT_PARSE_OK : LEPT_PARSE_ABORTED)
+
+struct lept_arena_block {
+    lept_arena_block* next;
+    size_t size, top;
+};
+
+#define LEPT_ARENA_ALIGN sizeof(double)
+#define LEPT_ARENA_ROUND(n) (((n) + LEPT_ARENA_ALIGN - 1) & ~(LEPT_ARENA_ALIGN - 1))
+#define LEPT_ARENA_HEADER LEPT_ARENA_ROUND(sizeof(lept_arena_block))
+
 const char* LEPT_TYPES[] = {
     "LEPT_NULL",
     "LEPT_FALSE",
@@ -52,9 +175,55 @@ const char* PARSE_RESULTS[] = {
     "LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET",
     "LEPT_PARSE_MISS_KEY",
     "LEPT_PARSE_MISS_COLON",
-    "LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET"
+    "LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET",
+    "LEPT_PARSE_ABORTED",
+    "LEPT_PARSE_WRONG_TYPE",
+    "LEPT_PARSE_TOO_DEEP",
+    "LEPT_PARSE_FILE_ERROR"
+};
+
+static void* lept_default_alloc(void* ctx, size_t size) { (void)ctx; return malloc(size); }
+static void* lept_default_realloc(void* ctx, void* ptr, size_t size) { (void)ctx; return realloc(ptr, size); }
+static void lept_default_free(void* ctx, void* ptr) { (void)ctx; free(ptr); }
+
+static lept_allocator lept_global_allocator = {
+    lept_default_alloc, lept_default_realloc, lept_default_free, NULL
 };
 
+static void* lept_mem_alloc(const lept_allocator* a, size_t size) {
+    return a->alloc(a->ctx, size);
+}
+
+static void* lept_mem_realloc(const lept_allocator* a, void* ptr, size_t size) {
+    return ptr ? a->realloc(a->ctx, ptr, size) : a->alloc(a->ctx, size);
+}
+
+static void lept_mem_free(const lept_allocator* a, void* ptr) {
+    if (ptr)
+        a->free(a->ctx, ptr);
+}
+
+/* Value storage always goes through the global allocator */
+#define MALLOC(size)       lept_mem_alloc(&lept_global_allocator, size)
+#define REALLOC(ptr, size) lept_mem_realloc(&lept_global_allocator, ptr, size)
+#define FREE(ptr)          lept_mem_free(&lept_global_allocator, ptr)
+
+void lept_set_allocator(const lept_allocator *allocator) {
+    if (allocator) {
+        assert(allocator->alloc && allocator->realloc && allocator->free);
+        lept_global_allocator = *allocator;
+    } else {
+        lept_global_allocator.alloc = lept_default_alloc;
+        lept_global_allocator.realloc = lept_default_realloc;
+        lept_global_allocator.free = lept_default_free;
+        lept_global_allocator.ctx = NULL;
+    }
+}
+
+const lept_allocator* lept_get_allocator(void) {
+    return &lept_global_allocator;
+}
+
 static int lept_parse_value(lept_context* c, lept_value* v); /* Forward Declaration */
 
 static void lept_stringify_value(lept_context* c, const lept_value* v); /* Forward Declaration */
@@ -67,7 +236,7 @@ static void* lept_context_push(lept_context* c, size_t size) {
             c->size = LEPT_PARSE_STACK_INIT_SIZE;
         while (c->top + size >= c->size)
             c->size += c->size >> 1; /* c->size * 1.5 */
-        c->stack = (char*)realloc(c->stack, c->size);
+        c->stack = (char*)lept_mem_realloc(c->allocator, c->stack, c->size);
     }
     ret = c->stack + c->top;
     c->top += size;
@@ -79,18 +248,213 @@ static void* lept_context_pop(lept_context* c, size_t size) {
     return c->stack + (c->top -= size);
 }
 
-static void lept_parse_whitespace(lept_context* c) {
-    const char *p = c->json;
-    while (*p == ' ' || *p == '\t' || *p == '\r')
+void lept_arena_init(lept_arena *a, size_t block_size, const lept_allocator *allocator) {
+    assert(a != NULL);
+    a->blocks = NULL;
+    a->block_size = block_size > 0 ? block_size : LEPT_ARENA_BLOCK_SIZE;
+    a->allocator = allocator ? *allocator : lept_global_allocator;
+}
+
+void lept_arena_free(lept_arena *a) {
+    assert(a != NULL);
+    while (a->blocks) {
+        lept_arena_block* next = a->blocks->next;
+        lept_mem_free(&a->allocator, a->blocks);
+        a->blocks = next;
+    }
+}
+
+static void* lept_arena_alloc(lept_arena* a, size_t size) {
+    lept_arena_block* b = a->blocks;
+    size = LEPT_ARENA_ROUND(size);
+    if (b == NULL || b->top + size > b->size) {
+        size_t bsize = size > a->block_size ? size : a->block_size;
+        lept_arena_block* nb = (lept_arena_block*)lept_mem_alloc(&a->allocator, LEPT_ARENA_HEADER + bsize);
+        nb->size = bsize;
+        nb->top = 0;
+        if (b != NULL && size > a->block_size / 2) {
+            /* large allocation: keep bumping in the current block */
+            nb->next = b->next;
+            b->next = nb;
+        } else {
+            nb->next = b;
+            a->blocks = nb;
+        }
+        b = nb;
+    }
+    b->top += size;
+    return (char*)b + LEPT_ARENA_HEADER + b->top - size;
+}
+
+/*
+ * Sizes and capacities. The compact layout has no room in the value for the
+ * capacity of an array or object, so it goes in a header in front of the
+ * element buffer instead; sizes and string lengths are 32 bits wide there.
+ */
+#ifdef LEPT_COMPACT
+typedef union {
+    size_t capacity;
+    double align; /* keeps the elements aligned */
+} lept_buffer_header;
+
+#define LEPT_BUFFER_HEADER sizeof(lept_buffer_header)
+#define LEPT_SIZE_MAX      UINT32_MAX
+#define BUFFER_CAPACITY(p) (((lept_buffer_header*)(p) - 1)->capacity)
+#define A_SIZE(v)          ((v)->size)
+#define O_SIZE(v)          ((v)->size)
+#define S_LENGTH(v)        ((v)->size)
+#define A_CAPACITY(v)      ((v)->u.a.e ? BUFFER_CAPACITY((v)->u.a.e) : 0)
+#define O_CAPACITY(v)      ((v)->u.o.m ? BUFFER_CAPACITY((v)->u.o.m) : 0)
+#define SET_A_CAPACITY(v, n) ((v)->u.a.e ? (void)(BUFFER_CAPACITY((v)->u.a.e) = (n)) : (void)0)
+#define SET_O_CAPACITY(v, n) ((v)->u.o.m ? (void)(BUFFER_CAPACITY((v)->u.o.m) = (n)) : (void)0)
+#else
+#define LEPT_BUFFER_HEADER 0
+#define LEPT_SIZE_MAX      ((size_t)-1)
+#define A_SIZE(v)          ((v)->u.a.size)
+#define O_SIZE(v)          ((v)->u.o.size)
+#define S_LENGTH(v)        ((v)->u.s.len)
+#define A_CAPACITY(v)      ((v)->u.a.capacity)
+#define O_CAPACITY(v)      ((v)->u.o.capacity)
+#define SET_A_CAPACITY(v, n) ((v)->u.a.capacity = (n))
+#define SET_O_CAPACITY(v, n) ((v)->u.o.capacity = (n))
+#endif
+
+/* Array/object element buffers, from @a (NULL for the heap), with room for the header */
+static void* lept_buffer_alloc(lept_arena* a, size_t size) {
+    char* p = (char*)(a ? lept_arena_alloc(a, LEPT_BUFFER_HEADER + size) : MALLOC(LEPT_BUFFER_HEADER + size));
+    return p + LEPT_BUFFER_HEADER;
+}
+
+static void* lept_buffer_realloc(void* p, size_t size) {
+    if (p == NULL)
+        return lept_buffer_alloc(NULL, size);
+    return (char*)REALLOC((char*)p - LEPT_BUFFER_HEADER, LEPT_BUFFER_HEADER + size) + LEPT_BUFFER_HEADER;
+}
+
+static void lept_buffer_free(void* p) {
+    if (p != NULL)
+        FREE((char*)p - LEPT_BUFFER_HEADER);
+}
+
+/* Allocate storage for the tree being parsed */
+static void* lept_context_alloc(lept_context* c, size_t size) {
+    return c->arena ? lept_arena_alloc(c->arena, size) : MALLOC(size);
+}
+
+/*
+ * Tree walks (free, copy, equality, stringify) keep the arrays and objects
+ * they are inside on an explicit stack instead of recursing. The first
+ * LEPT_WALK_LOCAL levels need no allocation.
+ */
+#define LEPT_WALK_LOCAL 32
+
+typedef struct {
+    const lept_value* v;   /* the array or object */
+    const lept_value* rhs; /* lept_is_equal(): the one it is compared with */
+    lept_value* dst;       /* lept_copy(): the copy being filled */
+    size_t i;              /* elements or members done */
+} lept_walk_frame;
+
+typedef struct {
+    lept_walk_frame* frames;
+    size_t depth, capacity;
+    lept_walk_frame local[LEPT_WALK_LOCAL];
+} lept_walk;
+
+#define IS_CONTAINER(v)  ((v)->type == LEPT_ARRAY || (v)->type == LEPT_OBJECT)
+#define CHILD_COUNT(v)   ((v)->type == LEPT_ARRAY ? A_SIZE(v) : O_SIZE(v))
+#define CHILD(x, i)      ((x)->type == LEPT_ARRAY ? &(x)->u.a.e[i] : &(x)->u.o.m[i].v)
+#define WALK_TOP(w)      (&(w)->frames[(w)->depth - 1])
+
+static void lept_walk_init(lept_walk* w) {
+    w->frames = w->local;
+    w->depth = 0;
+    w->capacity = LEPT_WALK_LOCAL;
+}
+
+static void lept_walk_grow(lept_walk* w) {
+    w->capacity *= 2;
+    if (w->frames == w->local) {
+        w->frames = (lept_walk_frame*)MALLOC(w->capacity * sizeof(lept_walk_frame));
+        memcpy(w->frames, w->local, sizeof(w->local));
+    }
+    else
+        w->frames = (lept_walk_frame*)REALLOC(w->frames, w->capacity * sizeof(lept_walk_frame));
+}
+
+static lept_walk_frame* lept_walk_push(lept_walk* w, const lept_value* v) {
+    lept_walk_frame* f;
+    if (w->depth == w->capacity)
+        lept_walk_grow(w);
+    f = &w->frames[w->depth++];
+    f->v = v;
+    f->rhs = NULL;
+    f->dst = NULL;
+    f->i = 0;
+    return f;
+}
+
+static void lept_walk_free(lept_walk* w) {
+    if (w->frames != w->local)
+        FREE(w->frames);
+}
+
+#define ISWHITESPACE(ch) ((ch) == ' ' || (ch) == '\t' || (ch) == '\n' || (ch) == '\r')
+
+/* Skip the JSON whitespace in [p, end), a block at a time for indentation runs */
+static const char* lept_skip_whitespace(const char* p, const char* end) {
+    if (p == end || !ISWHITESPACE(*p))
+        return p;
+#if defined(LEPT_AVX2)
+    {
+        const __m256i space = _mm256_set1_epi8(' ');
+        const __m256i tab = _mm256_set1_epi8('\t');
+        const __m256i lf = _mm256_set1_epi8('\n');
+        const __m256i cr = _mm256_set1_epi8('\r');
+        while (end - p >= 32) {
+            __m256i x = _mm256_loadu_si256((const __m256i*)p);
+            __m256i m = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(x, space), _mm256_cmpeq_epi8(x, tab)),
+                _mm256_or_si256(_mm256_cmpeq_epi8(x, lf), _mm256_cmpeq_epi8(x, cr)));
+            unsigned mask = ~(unsigned)_mm256_movemask_epi8(m);
+            if (mask)
+                return p + LEPT_CTZ(mask);
+            p += 32;
+        }
+    }
+#endif
+#if defined(LEPT_SSE2)
+    {
+        const __m128i space = _mm_set1_epi8(' ');
+        const __m128i tab = _mm_set1_epi8('\t');
+        const __m128i lf = _mm_set1_epi8('\n');
+        const __m128i cr = _mm_set1_epi8('\r');
+        while (end - p >= 16) {
+            __m128i x = _mm_loadu_si128((const __m128i*)p);
+            __m128i m = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(x, space), _mm_cmpeq_epi8(x, tab)),
+                _mm_or_si128(_mm_cmpeq_epi8(x, lf), _mm_cmpeq_epi8(x, cr)));
+            unsigned mask = ~(unsigned)_mm_movemask_epi8(m) & 0xFFFF;
+            if (mask)
+                return p + LEPT_CTZ(mask);
+            p += 16;
+        }
+    }
+#endif
+    while (p < end && ISWHITESPACE(*p))
         p++;
-    c->json = p;
+    return p;
+}
+
+static void lept_parse_whitespace(lept_context* c) {
+    c->json = lept_skip_whitespace(c->json, c->end);
 }
 
 static int lept_parse_literal(lept_context* c, lept_value* v, const char* literal, lept_type type) {
     size_t i;
     EXPECT(c, literal[0]);
     for (i = 0; i < strlen(literal)-1; ++i) {
-        if (c->json[i] != literal[i+1]) {
+        if (CHAR_AT(c, c->json + i) != literal[i+1]) {
             return LEPT_PARSE_INVALID_VALUE;
         }
     }
@@ -99,37 +463,855 @@ static int lept_parse_literal(lept_context* c, lept_value* v, const char* litera
     return LEPT_PARSE_OK;
 }
 
+/*
+ * Number conversion. Digits are accumulated while the grammar is validated;
+ * a decimal w * 10^q with at most 19 significant digits is converted with
+ * Clinger's exact fast path or the Eisel-Lemire algorithm, which is
+ * correctly rounded. Longer inputs whose rounding cannot be decided from
+ * the first 19 digits fall back to strtod().
+ */
+
+/* 10^0 .. 10^22 are exact doubles */
+static const double lept_pow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+#define LEPT_POW5_MIN (-342)
+#define LEPT_POW5_MAX 308
+
+/* 128-bit approximations of 5^q for q in [LEPT_POW5_MIN, LEPT_POW5_MAX], high word first */
+static const uint64_t lept_pow5_128[] = {
+    UINT64_C(0xeef453d6923bd65a), UINT64_C(0x113faa2906a13b3f),
+    UINT64_C(0x9558b4661b6565f8), UINT64_C(0x4ac7ca59a424c507),
+    UINT64_C(0xbaaee17fa23ebf76), UINT64_C(0x5d79bcf00d2df649),
+    UINT64_C(0xe95a99df8ace6f53), UINT64_C(0xf4d82c2c107973dc),
+    UINT64_C(0x91d8a02bb6c10594), UINT64_C(0x79071b9b8a4be869),
+    UINT64_C(0xb64ec836a47146f9), UINT64_C(0x9748e2826cdee284),
+    UINT64_C(0xe3e27a444d8d98b7), UINT64_C(0xfd1b1b2308169b25),
+    UINT64_C(0x8e6d8c6ab0787f72), UINT64_C(0xfe30f0f5e50e20f7),
+    UINT64_C(0xb208ef855c969f4f), UINT64_C(0xbdbd2d335e51a935),
+    UINT64_C(0xde8b2b66b3bc4723), UINT64_C(0xad2c788035e61382),
+    UINT64_C(0x8b16fb203055ac76), UINT64_C(0x4c3bcb5021afcc31),
+    UINT64_C(0xaddcb9e83c6b1793), UINT64_C(0xdf4abe242a1bbf3d),
+    UINT64_C(0xd953e8624b85dd78), UINT64_C(0xd71d6dad34a2af0d),
+    UINT64_C(0x87d4713d6f33aa6b), UINT64_C(0x8672648c40e5ad68),
+    UINT64_C(0xa9c98d8ccb009506), UINT64_C(0x680efdaf511f18c2),
+    UINT64_C(0xd43bf0effdc0ba48), UINT64_C(0x0212bd1b2566def2),
+    UINT64_C(0x84a57695fe98746d), UINT64_C(0x014bb630f7604b57),
+    UINT64_C(0xa5ced43b7e3e9188), UINT64_C(0x419ea3bd35385e2d),
+    UINT64_C(0xcf42894a5dce35ea), UINT64_C(0x52064cac828675b9),
+    UINT64_C(0x818995ce7aa0e1b2), UINT64_C(0x7343efebd1940993),
+    UINT64_C(0xa1ebfb4219491a1f), UINT64_C(0x1014ebe6c5f90bf8),
+    UINT64_C(0xca66fa129f9b60a6), UINT64_C(0xd41a26e077774ef6),
+    UINT64_C(0xfd00b897478238d0), UINT64_C(0x8920b098955522b4),
+    UINT64_C(0x9e20735e8cb16382), UINT64_C(0x55b46e5f5d5535b0),
+    UINT64_C(0xc5a890362fddbc62), UINT64_C(0xeb2189f734aa831d),
+    UINT64_C(0xf712b443bbd52b7b), UINT64_C(0xa5e9ec7501d523e4),
+    UINT64_C(0x9a6bb0aa55653b2d), UINT64_C(0x47b233c92125366e),
+    UINT64_C(0xc1069cd4eabe89f8), UINT64_C(0x999ec0bb696e840a),
+    UINT64_C(0xf148440a256e2c76), UINT64_C(0xc00670ea43ca250d),
+    UINT64_C(0x96cd2a865764dbca), UINT64_C(0x380406926a5e5728),
+    UINT64_C(0xbc807527ed3e12bc), UINT64_C(0xc605083704f5ecf2),
+    UINT64_C(0xeba09271e88d976b), UINT64_C(0xf7864a44c633682e),
+    UINT64_C(0x93445b8731587ea3), UINT64_C(0x7ab3ee6afbe0211d),
+    UINT64_C(0xb8157268fdae9e4c), UINT64_C(0x5960ea05bad82964),
+    UINT64_C(0xe61acf033d1a45df), UINT64_C(0x6fb92487298e33bd),
+    UINT64_C(0x8fd0c16206306bab), UINT64_C(0xa5d3b6d479f8e056),
+    UINT64_C(0xb3c4f1ba87bc8696), UINT64_C(0x8f48a4899877186c),
+    UINT64_C(0xe0b62e2929aba83c), UINT64_C(0x331acdabfe94de87),
+    UINT64_C(0x8c71dcd9ba0b4925), UINT64_C(0x9ff0c08b7f1d0b14),
+    UINT64_C(0xaf8e5410288e1b6f), UINT64_C(0x07ecf0ae5ee44dd9),
+    UINT64_C(0xdb71e91432b1a24a), UINT64_C(0xc9e82cd9f69d6150),
+    UINT64_C(0x892731ac9faf056e), UINT64_C(0xbe311c083a225cd2),
+    UINT64_C(0xab70fe17c79ac6ca), UINT64_C(0x6dbd630a48aaf406),
+    UINT64_C(0xd64d3d9db981787d), UINT64_C(0x092cbbccdad5b108),
+    UINT64_C(0x85f0468293f0eb4e), UINT64_C(0x25bbf56008c58ea5),
+    UINT64_C(0xa76c582338ed2621), UINT64_C(0xaf2af2b80af6f24e),
+    UINT64_C(0xd1476e2c07286faa), UINT64_C(0x1af5af660db4aee1),
+    UINT64_C(0x82cca4db847945ca), UINT64_C(0x50d98d9fc890ed4d),
+    UINT64_C(0xa37fce126597973c), UINT64_C(0xe50ff107bab528a0),
+    UINT64_C(0xcc5fc196fefd7d0c), UINT64_C(0x1e53ed49a96272c8),
+    UINT64_C(0xff77b1fcbebcdc4f), UINT64_C(0x25e8e89c13bb0f7a),
+    UINT64_C(0x9faacf3df73609b1), UINT64_C(0x77b191618c54e9ac),
+    UINT64_C(0xc795830d75038c1d), UINT64_C(0xd59df5b9ef6a2417),
+    UINT64_C(0xf97ae3d0d2446f25), UINT64_C(0x4b0573286b44ad1d),
+    UINT64_C(0x9becce62836ac577), UINT64_C(0x4ee367f9430aec32),
+    UINT64_C(0xc2e801fb244576d5), UINT64_C(0x229c41f793cda73f),
+    UINT64_C(0xf3a20279ed56d48a), UINT64_C(0x6b43527578c1110f),
+    UINT64_C(0x9845418c345644d6), UINT64_C(0x830a13896b78aaa9),
+    UINT64_C(0xbe5691ef416bd60c), UINT64_C(0x23cc986bc656d553),
+    UINT64_C(0xedec366b11c6cb8f), UINT64_C(0x2cbfbe86b7ec8aa8),
+    UINT64_C(0x94b3a202eb1c3f39), UINT64_C(0x7bf7d71432f3d6a9),
+    UINT64_C(0xb9e08a83a5e34f07), UINT64_C(0xdaf5ccd93fb0cc53),
+    UINT64_C(0xe858ad248f5c22c9), UINT64_C(0xd1b3400f8f9cff68),
+    UINT64_C(0x91376c36d99995be), UINT64_C(0x23100809b9c21fa1),
+    UINT64_C(0xb58547448ffffb2d), UINT64_C(0xabd40a0c2832a78a),
+    UINT64_C(0xe2e69915b3fff9f9), UINT64_C(0x16c90c8f323f516c),
+    UINT64_C(0x8dd01fad907ffc3b), UINT64_C(0xae3da7d97f6792e3),
+    UINT64_C(0xb1442798f49ffb4a), UINT64_C(0x99cd11cfdf41779c),
+    UINT64_C(0xdd95317f31c7fa1d), UINT64_C(0x40405643d711d583),
+    UINT64_C(0x8a7d3eef7f1cfc52), UINT64_C(0x482835ea666b2572),
+    UINT64_C(0xad1c8eab5ee43b66), UINT64_C(0xda3243650005eecf),
+    UINT64_C(0xd863b256369d4a40), UINT64_C(0x90bed43e40076a82),
+    UINT64_C(0x873e4f75e2224e68), UINT64_C(0x5a7744a6e804a291),
+    UINT64_C(0xa90de3535aaae202), UINT64_C(0x711515d0a205cb36),
+    UINT64_C(0xd3515c2831559a83), UINT64_C(0x0d5a5b44ca873e03),
+    UINT64_C(0x8412d9991ed58091), UINT64_C(0xe858790afe9486c2),
+    UINT64_C(0xa5178fff668ae0b6), UINT64_C(0x626e974dbe39a872),
+    UINT64_C(0xce5d73ff402d98e3), UINT64_C(0xfb0a3d212dc8128f),
+    UINT64_C(0x80fa687f881c7f8e), UINT64_C(0x7ce66634bc9d0b99),
+    UINT64_C(0xa139029f6a239f72), UINT64_C(0x1c1fffc1ebc44e80),
+    UINT64_C(0xc987434744ac874e), UINT64_C(0xa327ffb266b56220),
+    UINT64_C(0xfbe9141915d7a922), UINT64_C(0x4bf1ff9f0062baa8),
+    UINT64_C(0x9d71ac8fada6c9b5), UINT64_C(0x6f773fc3603db4a9),
+    UINT64_C(0xc4ce17b399107c22), UINT64_C(0xcb550fb4384d21d3),
+    UINT64_C(0xf6019da07f549b2b), UINT64_C(0x7e2a53a146606a48),
+    UINT64_C(0x99c102844f94e0fb), UINT64_C(0x2eda7444cbfc426d),
+    UINT64_C(0xc0314325637a1939), UINT64_C(0xfa911155fefb5308),
+    UINT64_C(0xf03d93eebc589f88), UINT64_C(0x793555ab7eba27ca),
+    UINT64_C(0x96267c7535b763b5), UINT64_C(0x4bc1558b2f3458de),
+    UINT64_C(0xbbb01b9283253ca2), UINT64_C(0x9eb1aaedfb016f16),
+    UINT64_C(0xea9c227723ee8bcb), UINT64_C(0x465e15a979c1cadc),
+    UINT64_C(0x92a1958a7675175f), UINT64_C(0x0bfacd89ec191ec9),
+    UINT64_C(0xb749faed14125d36), UINT64_C(0xcef980ec671f667b),
+    UINT64_C(0xe51c79a85916f484), UINT64_C(0x82b7e12780e7401a),
+    UINT64_C(0x8f31cc0937ae58d2), UINT64_C(0xd1b2ecb8b0908810),
+    UINT64_C(0xb2fe3f0b8599ef07), UINT64_C(0x861fa7e6dcb4aa15),
+    UINT64_C(0xdfbdcece67006ac9), UINT64_C(0x67a791e093e1d49a),
+    UINT64_C(0x8bd6a141006042bd), UINT64_C(0xe0c8bb2c5c6d24e0),
+    UINT64_C(0xaecc49914078536d), UINT64_C(0x58fae9f773886e18),
+    UINT64_C(0xda7f5bf590966848), UINT64_C(0xaf39a475506a899e),
+    UINT64_C(0x888f99797a5e012d), UINT64_C(0x6d8406c952429603),
+    UINT64_C(0xaab37fd7d8f58178), UINT64_C(0xc8e5087ba6d33b83),
+    UINT64_C(0xd5605fcdcf32e1d6), UINT64_C(0xfb1e4a9a90880a64),
+    UINT64_C(0x855c3be0a17fcd26), UINT64_C(0x5cf2eea09a55067f),
+    UINT64_C(0xa6b34ad8c9dfc06f), UINT64_C(0xf42faa48c0ea481e),
+    UINT64_C(0xd0601d8efc57b08b), UINT64_C(0xf13b94daf124da26),
+    UINT64_C(0x823c12795db6ce57), UINT64_C(0x76c53d08d6b70858),
+    UINT64_C(0xa2cb1717b52481ed), UINT64_C(0x54768c4b0c64ca6e),
+    UINT64_C(0xcb7ddcdda26da268), UINT64_C(0xa9942f5dcf7dfd09),
+    UINT64_C(0xfe5d54150b090b02), UINT64_C(0xd3f93b35435d7c4c),
+    UINT64_C(0x9efa548d26e5a6e1), UINT64_C(0xc47bc5014a1a6daf),
+    UINT64_C(0xc6b8e9b0709f109a), UINT64_C(0x359ab6419ca1091b),
+    UINT64_C(0xf867241c8cc6d4c0), UINT64_C(0xc30163d203c94b62),
+    UINT64_C(0x9b407691d7fc44f8), UINT64_C(0x79e0de63425dcf1d),
+    UINT64_C(0xc21094364dfb5636), UINT64_C(0x985915fc12f542e4),
+    UINT64_C(0xf294b943e17a2bc4), UINT64_C(0x3e6f5b7b17b2939d),
+    UINT64_C(0x979cf3ca6cec5b5a), UINT64_C(0xa705992ceecf9c42),
+    UINT64_C(0xbd8430bd08277231), UINT64_C(0x50c6ff782a838353),
+    UINT64_C(0xece53cec4a314ebd), UINT64_C(0xa4f8bf5635246428),
+    UINT64_C(0x940f4613ae5ed136), UINT64_C(0x871b7795e136be99),
+    UINT64_C(0xb913179899f68584), UINT64_C(0x28e2557b59846e3f),
+    UINT64_C(0xe757dd7ec07426e5), UINT64_C(0x331aeada2fe589cf),
+    UINT64_C(0x9096ea6f3848984f), UINT64_C(0x3ff0d2c85def7621),
+    UINT64_C(0xb4bca50b065abe63), UINT64_C(0x0fed077a756b53a9),
+    UINT64_C(0xe1ebce4dc7f16dfb), UINT64_C(0xd3e8495912c62894),
+    UINT64_C(0x8d3360f09cf6e4bd), UINT64_C(0x64712dd7abbbd95c),
+    UINT64_C(0xb080392cc4349dec), UINT64_C(0xbd8d794d96aacfb3),
+    UINT64_C(0xdca04777f541c567), UINT64_C(0xecf0d7a0fc5583a0),
+    UINT64_C(0x89e42caaf9491b60), UINT64_C(0xf41686c49db57244),
+    UINT64_C(0xac5d37d5b79b6239), UINT64_C(0x311c2875c522ced5),
+    UINT64_C(0xd77485cb25823ac7), UINT64_C(0x7d633293366b828b),
+    UINT64_C(0x86a8d39ef77164bc), UINT64_C(0xae5dff9c02033197),
+    UINT64_C(0xa8530886b54dbdeb), UINT64_C(0xd9f57f830283fdfc),
+    UINT64_C(0xd267caa862a12d66), UINT64_C(0xd072df63c324fd7b),
+    UINT64_C(0x8380dea93da4bc60), UINT64_C(0x4247cb9e59f71e6d),
+    UINT64_C(0xa46116538d0deb78), UINT64_C(0x52d9be85f074e608),
+    UINT64_C(0xcd795be870516656), UINT64_C(0x67902e276c921f8b),
+    UINT64_C(0x806bd9714632dff6), UINT64_C(0x00ba1cd8a3db53b6),
+    UINT64_C(0xa086cfcd97bf97f3), UINT64_C(0x80e8a40eccd228a4),
+    UINT64_C(0xc8a883c0fdaf7df0), UINT64_C(0x6122cd128006b2cd),
+    UINT64_C(0xfad2a4b13d1b5d6c), UINT64_C(0x796b805720085f81),
+    UINT64_C(0x9cc3a6eec6311a63), UINT64_C(0xcbe3303674053bb0),
+    UINT64_C(0xc3f490aa77bd60fc), UINT64_C(0xbedbfc4411068a9c),
+    UINT64_C(0xf4f1b4d515acb93b), UINT64_C(0xee92fb5515482d44),
+    UINT64_C(0x991711052d8bf3c5), UINT64_C(0x751bdd152d4d1c4a),
+    UINT64_C(0xbf5cd54678eef0b6), UINT64_C(0xd262d45a78a0635d),
+    UINT64_C(0xef340a98172aace4), UINT64_C(0x86fb897116c87c34),
+    UINT64_C(0x9580869f0e7aac0e), UINT64_C(0xd45d35e6ae3d4da0),
+    UINT64_C(0xbae0a846d2195712), UINT64_C(0x8974836059cca109),
+    UINT64_C(0xe998d258869facd7), UINT64_C(0x2bd1a438703fc94b),
+    UINT64_C(0x91ff83775423cc06), UINT64_C(0x7b6306a34627ddcf),
+    UINT64_C(0xb67f6455292cbf08), UINT64_C(0x1a3bc84c17b1d542),
+    UINT64_C(0xe41f3d6a7377eeca), UINT64_C(0x20caba5f1d9e4a93),
+    UINT64_C(0x8e938662882af53e), UINT64_C(0x547eb47b7282ee9c),
+    UINT64_C(0xb23867fb2a35b28d), UINT64_C(0xe99e619a4f23aa43),
+    UINT64_C(0xdec681f9f4c31f31), UINT64_C(0x6405fa00e2ec94d4),
+    UINT64_C(0x8b3c113c38f9f37e), UINT64_C(0xde83bc408dd3dd04),
+    UINT64_C(0xae0b158b4738705e), UINT64_C(0x9624ab50b148d445),
+    UINT64_C(0xd98ddaee19068c76), UINT64_C(0x3badd624dd9b0957),
+    UINT64_C(0x87f8a8d4cfa417c9), UINT64_C(0xe54ca5d70a80e5d6),
+    UINT64_C(0xa9f6d30a038d1dbc), UINT64_C(0x5e9fcf4ccd211f4c),
+    UINT64_C(0xd47487cc8470652b), UINT64_C(0x7647c3200069671f),
+    UINT64_C(0x84c8d4dfd2c63f3b), UINT64_C(0x29ecd9f40041e073),
+    UINT64_C(0xa5fb0a17c777cf09), UINT64_C(0xf468107100525890),
+    UINT64_C(0xcf79cc9db955c2cc), UINT64_C(0x7182148d4066eeb4),
+    UINT64_C(0x81ac1fe293d599bf), UINT64_C(0xc6f14cd848405530),
+    UINT64_C(0xa21727db38cb002f), UINT64_C(0xb8ada00e5a506a7c),
+    UINT64_C(0xca9cf1d206fdc03b), UINT64_C(0xa6d90811f0e4851c),
+    UINT64_C(0xfd442e4688bd304a), UINT64_C(0x908f4a166d1da663),
+    UINT64_C(0x9e4a9cec15763e2e), UINT64_C(0x9a598e4e043287fe),
+    UINT64_C(0xc5dd44271ad3cdba), UINT64_C(0x40eff1e1853f29fd),
+    UINT64_C(0xf7549530e188c128), UINT64_C(0xd12bee59e68ef47c),
+    UINT64_C(0x9a94dd3e8cf578b9), UINT64_C(0x82bb74f8301958ce),
+    UINT64_C(0xc13a148e3032d6e7), UINT64_C(0xe36a52363c1faf01),
+    UINT64_C(0xf18899b1bc3f8ca1), UINT64_C(0xdc44e6c3cb279ac1),
+    UINT64_C(0x96f5600f15a7b7e5), UINT64_C(0x29ab103a5ef8c0b9),
+    UINT64_C(0xbcb2b812db11a5de), UINT64_C(0x7415d448f6b6f0e7),
+    UINT64_C(0xebdf661791d60f56), UINT64_C(0x111b495b3464ad21),
+    UINT64_C(0x936b9fcebb25c995), UINT64_C(0xcab10dd900beec34),
+    UINT64_C(0xb84687c269ef3bfb), UINT64_C(0x3d5d514f40eea742),
+    UINT64_C(0xe65829b3046b0afa), UINT64_C(0x0cb4a5a3112a5112),
+    UINT64_C(0x8ff71a0fe2c2e6dc), UINT64_C(0x47f0e785eaba72ab),
+    UINT64_C(0xb3f4e093db73a093), UINT64_C(0x59ed216765690f56),
+    UINT64_C(0xe0f218b8d25088b8), UINT64_C(0x306869c13ec3532c),
+    UINT64_C(0x8c974f7383725573), UINT64_C(0x1e414218c73a13fb),
+    UINT64_C(0xafbd2350644eeacf), UINT64_C(0xe5d1929ef90898fa),
+    UINT64_C(0xdbac6c247d62a583), UINT64_C(0xdf45f746b74abf39),
+    UINT64_C(0x894bc396ce5da772), UINT64_C(0x6b8bba8c328eb783),
+    UINT64_C(0xab9eb47c81f5114f), UINT64_C(0x066ea92f3f326564),
+    UINT64_C(0xd686619ba27255a2), UINT64_C(0xc80a537b0efefebd),
+    UINT64_C(0x8613fd0145877585), UINT64_C(0xbd06742ce95f5f36),
+    UINT64_C(0xa798fc4196e952e7), UINT64_C(0x2c48113823b73704),
+    UINT64_C(0xd17f3b51fca3a7a0), UINT64_C(0xf75a15862ca504c5),
+    UINT64_C(0x82ef85133de648c4), UINT64_C(0x9a984d73dbe722fb),
+    UINT64_C(0xa3ab66580d5fdaf5), UINT64_C(0xc13e60d0d2e0ebba),
+    UINT64_C(0xcc963fee10b7d1b3), UINT64_C(0x318df905079926a8),
+    UINT64_C(0xffbbcfe994e5c61f), UINT64_C(0xfdf17746497f7052),
+    UINT64_C(0x9fd561f1fd0f9bd3), UINT64_C(0xfeb6ea8bedefa633),
+    UINT64_C(0xc7caba6e7c5382c8), UINT64_C(0xfe64a52ee96b8fc0),
+    UINT64_C(0xf9bd690a1b68637b), UINT64_C(0x3dfdce7aa3c673b0),
+    UINT64_C(0x9c1661a651213e2d), UINT64_C(0x06bea10ca65c084e),
+    UINT64_C(0xc31bfa0fe5698db8), UINT64_C(0x486e494fcff30a62),
+    UINT64_C(0xf3e2f893dec3f126), UINT64_C(0x5a89dba3c3efccfa),
+    UINT64_C(0x986ddb5c6b3a76b7), UINT64_C(0xf89629465a75e01c),
+    UINT64_C(0xbe89523386091465), UINT64_C(0xf6bbb397f1135823),
+    UINT64_C(0xee2ba6c0678b597f), UINT64_C(0x746aa07ded582e2c),
+    UINT64_C(0x94db483840b717ef), UINT64_C(0xa8c2a44eb4571cdc),
+    UINT64_C(0xba121a4650e4ddeb), UINT64_C(0x92f34d62616ce413),
+    UINT64_C(0xe896a0d7e51e1566), UINT64_C(0x77b020baf9c81d17),
+    UINT64_C(0x915e2486ef32cd60), UINT64_C(0x0ace1474dc1d122e),
+    UINT64_C(0xb5b5ada8aaff80b8), UINT64_C(0x0d819992132456ba),
+    UINT64_C(0xe3231912d5bf60e6), UINT64_C(0x10e1fff697ed6c69),
+    UINT64_C(0x8df5efabc5979c8f), UINT64_C(0xca8d3ffa1ef463c1),
+    UINT64_C(0xb1736b96b6fd83b3), UINT64_C(0xbd308ff8a6b17cb2),
+    UINT64_C(0xddd0467c64bce4a0), UINT64_C(0xac7cb3f6d05ddbde),
+    UINT64_C(0x8aa22c0dbef60ee4), UINT64_C(0x6bcdf07a423aa96b),
+    UINT64_C(0xad4ab7112eb3929d), UINT64_C(0x86c16c98d2c953c6),
+    UINT64_C(0xd89d64d57a607744), UINT64_C(0xe871c7bf077ba8b7),
+    UINT64_C(0x87625f056c7c4a8b), UINT64_C(0x11471cd764ad4972),
+    UINT64_C(0xa93af6c6c79b5d2d), UINT64_C(0xd598e40d3dd89bcf),
+    UINT64_C(0xd389b47879823479), UINT64_C(0x4aff1d108d4ec2c3),
+    UINT64_C(0x843610cb4bf160cb), UINT64_C(0xcedf722a585139ba),
+    UINT64_C(0xa54394fe1eedb8fe), UINT64_C(0xc2974eb4ee658828),
+    UINT64_C(0xce947a3da6a9273e), UINT64_C(0x733d226229feea32),
+    UINT64_C(0x811ccc668829b887), UINT64_C(0x0806357d5a3f525f),
+    UINT64_C(0xa163ff802a3426a8), UINT64_C(0xca07c2dcb0cf26f7),
+    UINT64_C(0xc9bcff6034c13052), UINT64_C(0xfc89b393dd02f0b5),
+    UINT64_C(0xfc2c3f3841f17c67), UINT64_C(0xbbac2078d443ace2),
+    UINT64_C(0x9d9ba7832936edc0), UINT64_C(0xd54b944b84aa4c0d),
+    UINT64_C(0xc5029163f384a931), UINT64_C(0x0a9e795e65d4df11),
+    UINT64_C(0xf64335bcf065d37d), UINT64_C(0x4d4617b5ff4a16d5),
+    UINT64_C(0x99ea0196163fa42e), UINT64_C(0x504bced1bf8e4e45),
+    UINT64_C(0xc06481fb9bcf8d39), UINT64_C(0xe45ec2862f71e1d6),
+    UINT64_C(0xf07da27a82c37088), UINT64_C(0x5d767327bb4e5a4c),
+    UINT64_C(0x964e858c91ba2655), UINT64_C(0x3a6a07f8d510f86f),
+    UINT64_C(0xbbe226efb628afea), UINT64_C(0x890489f70a55368b),
+    UINT64_C(0xeadab0aba3b2dbe5), UINT64_C(0x2b45ac74ccea842e),
+    UINT64_C(0x92c8ae6b464fc96f), UINT64_C(0x3b0b8bc90012929d),
+    UINT64_C(0xb77ada0617e3bbcb), UINT64_C(0x09ce6ebb40173744),
+    UINT64_C(0xe55990879ddcaabd), UINT64_C(0xcc420a6a101d0515),
+    UINT64_C(0x8f57fa54c2a9eab6), UINT64_C(0x9fa946824a12232d),
+    UINT64_C(0xb32df8e9f3546564), UINT64_C(0x47939822dc96abf9),
+    UINT64_C(0xdff9772470297ebd), UINT64_C(0x59787e2b93bc56f7),
+    UINT64_C(0x8bfbea76c619ef36), UINT64_C(0x57eb4edb3c55b65a),
+    UINT64_C(0xaefae51477a06b03), UINT64_C(0xede622920b6b23f1),
+    UINT64_C(0xdab99e59958885c4), UINT64_C(0xe95fab368e45eced),
+    UINT64_C(0x88b402f7fd75539b), UINT64_C(0x11dbcb0218ebb414),
+    UINT64_C(0xaae103b5fcd2a881), UINT64_C(0xd652bdc29f26a119),
+    UINT64_C(0xd59944a37c0752a2), UINT64_C(0x4be76d3346f0495f),
+    UINT64_C(0x857fcae62d8493a5), UINT64_C(0x6f70a4400c562ddb),
+    UINT64_C(0xa6dfbd9fb8e5b88e), UINT64_C(0xcb4ccd500f6bb952),
+    UINT64_C(0xd097ad07a71f26b2), UINT64_C(0x7e2000a41346a7a7),
+    UINT64_C(0x825ecc24c873782f), UINT64_C(0x8ed400668c0c28c8),
+    UINT64_C(0xa2f67f2dfa90563b), UINT64_C(0x728900802f0f32fa),
+    UINT64_C(0xcbb41ef979346bca), UINT64_C(0x4f2b40a03ad2ffb9),
+    UINT64_C(0xfea126b7d78186bc), UINT64_C(0xe2f610c84987bfa8),
+    UINT64_C(0x9f24b832e6b0f436), UINT64_C(0x0dd9ca7d2df4d7c9),
+    UINT64_C(0xc6ede63fa05d3143), UINT64_C(0x91503d1c79720dbb),
+    UINT64_C(0xf8a95fcf88747d94), UINT64_C(0x75a44c6397ce912a),
+    UINT64_C(0x9b69dbe1b548ce7c), UINT64_C(0xc986afbe3ee11aba),
+    UINT64_C(0xc24452da229b021b), UINT64_C(0xfbe85badce996168),
+    UINT64_C(0xf2d56790ab41c2a2), UINT64_C(0xfae27299423fb9c3),
+    UINT64_C(0x97c560ba6b0919a5), UINT64_C(0xdccd879fc967d41a),
+    UINT64_C(0xbdb6b8e905cb600f), UINT64_C(0x5400e987bbc1c920),
+    UINT64_C(0xed246723473e3813), UINT64_C(0x290123e9aab23b68),
+    UINT64_C(0x9436c0760c86e30b), UINT64_C(0xf9a0b6720aaf6521),
+    UINT64_C(0xb94470938fa89bce), UINT64_C(0xf808e40e8d5b3e69),
+    UINT64_C(0xe7958cb87392c2c2), UINT64_C(0xb60b1d1230b20e04),
+    UINT64_C(0x90bd77f3483bb9b9), UINT64_C(0xb1c6f22b5e6f48c2),
+    UINT64_C(0xb4ecd5f01a4aa828), UINT64_C(0x1e38aeb6360b1af3),
+    UINT64_C(0xe2280b6c20dd5232), UINT64_C(0x25c6da63c38de1b0),
+    UINT64_C(0x8d590723948a535f), UINT64_C(0x579c487e5a38ad0e),
+    UINT64_C(0xb0af48ec79ace837), UINT64_C(0x2d835a9df0c6d851),
+    UINT64_C(0xdcdb1b2798182244), UINT64_C(0xf8e431456cf88e65),
+    UINT64_C(0x8a08f0f8bf0f156b), UINT64_C(0x1b8e9ecb641b58ff),
+    UINT64_C(0xac8b2d36eed2dac5), UINT64_C(0xe272467e3d222f3f),
+    UINT64_C(0xd7adf884aa879177), UINT64_C(0x5b0ed81dcc6abb0f),
+    UINT64_C(0x86ccbb52ea94baea), UINT64_C(0x98e947129fc2b4e9),
+    UINT64_C(0xa87fea27a539e9a5), UINT64_C(0x3f2398d747b36224),
+    UINT64_C(0xd29fe4b18e88640e), UINT64_C(0x8eec7f0d19a03aad),
+    UINT64_C(0x83a3eeeef9153e89), UINT64_C(0x1953cf68300424ac),
+    UINT64_C(0xa48ceaaab75a8e2b), UINT64_C(0x5fa8c3423c052dd7),
+    UINT64_C(0xcdb02555653131b6), UINT64_C(0x3792f412cb06794d),
+    UINT64_C(0x808e17555f3ebf11), UINT64_C(0xe2bbd88bbee40bd0),
+    UINT64_C(0xa0b19d2ab70e6ed6), UINT64_C(0x5b6aceaeae9d0ec4),
+    UINT64_C(0xc8de047564d20a8b), UINT64_C(0xf245825a5a445275),
+    UINT64_C(0xfb158592be068d2e), UINT64_C(0xeed6e2f0f0d56712),
+    UINT64_C(0x9ced737bb6c4183d), UINT64_C(0x55464dd69685606b),
+    UINT64_C(0xc428d05aa4751e4c), UINT64_C(0xaa97e14c3c26b886),
+    UINT64_C(0xf53304714d9265df), UINT64_C(0xd53dd99f4b3066a8),
+    UINT64_C(0x993fe2c6d07b7fab), UINT64_C(0xe546a8038efe4029),
+    UINT64_C(0xbf8fdb78849a5f96), UINT64_C(0xde98520472bdd033),
+    UINT64_C(0xef73d256a5c0f77c), UINT64_C(0x963e66858f6d4440),
+    UINT64_C(0x95a8637627989aad), UINT64_C(0xdde7001379a44aa8),
+    UINT64_C(0xbb127c53b17ec159), UINT64_C(0x5560c018580d5d52),
+    UINT64_C(0xe9d71b689dde71af), UINT64_C(0xaab8f01e6e10b4a6),
+    UINT64_C(0x9226712162ab070d), UINT64_C(0xcab3961304ca70e8),
+    UINT64_C(0xb6b00d69bb55c8d1), UINT64_C(0x3d607b97c5fd0d22),
+    UINT64_C(0xe45c10c42a2b3b05), UINT64_C(0x8cb89a7db77c506a),
+    UINT64_C(0x8eb98a7a9a5b04e3), UINT64_C(0x77f3608e92adb242),
+    UINT64_C(0xb267ed1940f1c61c), UINT64_C(0x55f038b237591ed3),
+    UINT64_C(0xdf01e85f912e37a3), UINT64_C(0x6b6c46dec52f6688),
+    UINT64_C(0x8b61313bbabce2c6), UINT64_C(0x2323ac4b3b3da015),
+    UINT64_C(0xae397d8aa96c1b77), UINT64_C(0xabec975e0a0d081a),
+    UINT64_C(0xd9c7dced53c72255), UINT64_C(0x96e7bd358c904a21),
+    UINT64_C(0x881cea14545c7575), UINT64_C(0x7e50d64177da2e54),
+    UINT64_C(0xaa242499697392d2), UINT64_C(0xdde50bd1d5d0b9e9),
+    UINT64_C(0xd4ad2dbfc3d07787), UINT64_C(0x955e4ec64b44e864),
+    UINT64_C(0x84ec3c97da624ab4), UINT64_C(0xbd5af13bef0b113e),
+    UINT64_C(0xa6274bbdd0fadd61), UINT64_C(0xecb1ad8aeacdd58e),
+    UINT64_C(0xcfb11ead453994ba), UINT64_C(0x67de18eda5814af2),
+    UINT64_C(0x81ceb32c4b43fcf4), UINT64_C(0x80eacf948770ced7),
+    UINT64_C(0xa2425ff75e14fc31), UINT64_C(0xa1258379a94d028d),
+    UINT64_C(0xcad2f7f5359a3b3e), UINT64_C(0x096ee45813a04330),
+    UINT64_C(0xfd87b5f28300ca0d), UINT64_C(0x8bca9d6e188853fc),
+    UINT64_C(0x9e74d1b791e07e48), UINT64_C(0x775ea264cf55347e),
+    UINT64_C(0xc612062576589dda), UINT64_C(0x95364afe032a819e),
+    UINT64_C(0xf79687aed3eec551), UINT64_C(0x3a83ddbd83f52205),
+    UINT64_C(0x9abe14cd44753b52), UINT64_C(0xc4926a9672793543),
+    UINT64_C(0xc16d9a0095928a27), UINT64_C(0x75b7053c0f178294),
+    UINT64_C(0xf1c90080baf72cb1), UINT64_C(0x5324c68b12dd6339),
+    UINT64_C(0x971da05074da7bee), UINT64_C(0xd3f6fc16ebca5e04),
+    UINT64_C(0xbce5086492111aea), UINT64_C(0x88f4bb1ca6bcf585),
+    UINT64_C(0xec1e4a7db69561a5), UINT64_C(0x2b31e9e3d06c32e6),
+    UINT64_C(0x9392ee8e921d5d07), UINT64_C(0x3aff322e62439fd0),
+    UINT64_C(0xb877aa3236a4b449), UINT64_C(0x09befeb9fad487c3),
+    UINT64_C(0xe69594bec44de15b), UINT64_C(0x4c2ebe687989a9b4),
+    UINT64_C(0x901d7cf73ab0acd9), UINT64_C(0x0f9d37014bf60a11),
+    UINT64_C(0xb424dc35095cd80f), UINT64_C(0x538484c19ef38c95),
+    UINT64_C(0xe12e13424bb40e13), UINT64_C(0x2865a5f206b06fba),
+    UINT64_C(0x8cbccc096f5088cb), UINT64_C(0xf93f87b7442e45d4),
+    UINT64_C(0xafebff0bcb24aafe), UINT64_C(0xf78f69a51539d749),
+    UINT64_C(0xdbe6fecebdedd5be), UINT64_C(0xb573440e5a884d1c),
+    UINT64_C(0x89705f4136b4a597), UINT64_C(0x31680a88f8953031),
+    UINT64_C(0xabcc77118461cefc), UINT64_C(0xfdc20d2b36ba7c3e),
+    UINT64_C(0xd6bf94d5e57a42bc), UINT64_C(0x3d32907604691b4d),
+    UINT64_C(0x8637bd05af6c69b5), UINT64_C(0xa63f9a49c2c1b110),
+    UINT64_C(0xa7c5ac471b478423), UINT64_C(0x0fcf80dc33721d54),
+    UINT64_C(0xd1b71758e219652b), UINT64_C(0xd3c36113404ea4a9),
+    UINT64_C(0x83126e978d4fdf3b), UINT64_C(0x645a1cac083126ea),
+    UINT64_C(0xa3d70a3d70a3d70a), UINT64_C(0x3d70a3d70a3d70a4),
+    UINT64_C(0xcccccccccccccccc), UINT64_C(0xcccccccccccccccd),
+    UINT64_C(0x8000000000000000), UINT64_C(0x0000000000000000),
+    UINT64_C(0xa000000000000000), UINT64_C(0x0000000000000000),
+    UINT64_C(0xc800000000000000), UINT64_C(0x0000000000000000),
+    UINT64_C(0xfa00000000000000), UINT64_C(0x0000000000000000),
+    UINT64_C(0x9c40000000000000), UINT64_C(0x0000000000000000),
+    UINT64_C(0xc350000000000000), UINT64_C(0x0000000000000000),
+    UINT64_C(0xf424000000000000), UINT64_C(0x0000000000000000),
+    UINT64_C(0x9896800000000000), UINT64_C(0x0000000000000000),
+    UINT64_C(0xbebc200000000000), UINT64_C(0x0000000000000000),
+    UINT64_C(0xee6b280000000000), UINT64_C(0x0000000000000000),
+    UINT64_C(0x9502f90000000000), UINT64_C(0x0000000000000000),
+    UINT64_C(0xba43b74000000000), UINT64_C(0x0000000000000000),
+    UINT64_C(0xe8d4a51000000000), UINT64_C(0x0000000000000000),
+    UINT64_C(0x9184e72a00000000), UINT64_C(0x0000000000000000),
+    UINT64_C(0xb5e620f480000000), UINT64_C(0x0000000000000000),
+    UINT64_C(0xe35fa931a0000000), UINT64_C(0x0000000000000000),
+    UINT64_C(0x8e1bc9bf04000000), UINT64_C(0x0000000000000000),
+    UINT64_C(0xb1a2bc2ec5000000), UINT64_C(0x0000000000000000),
+    UINT64_C(0xde0b6b3a76400000), UINT64_C(0x0000000000000000),
+    UINT64_C(0x8ac7230489e80000), UINT64_C(0x0000000000000000),
+    UINT64_C(0xad78ebc5ac620000), UINT64_C(0x0000000000000000),
+    UINT64_C(0xd8d726b7177a8000), UINT64_C(0x0000000000000000),
+    UINT64_C(0x878678326eac9000), UINT64_C(0x0000000000000000),
+    UINT64_C(0xa968163f0a57b400), UINT64_C(0x0000000000000000),
+    UINT64_C(0xd3c21bcecceda100), UINT64_C(0x0000000000000000),
+    UINT64_C(0x84595161401484a0), UINT64_C(0x0000000000000000),
+    UINT64_C(0xa56fa5b99019a5c8), UINT64_C(0x0000000000000000),
+    UINT64_C(0xcecb8f27f4200f3a), UINT64_C(0x0000000000000000),
+    UINT64_C(0x813f3978f8940984), UINT64_C(0x4000000000000000),
+    UINT64_C(0xa18f07d736b90be5), UINT64_C(0x5000000000000000),
+    UINT64_C(0xc9f2c9cd04674ede), UINT64_C(0xa400000000000000),
+    UINT64_C(0xfc6f7c4045812296), UINT64_C(0x4d00000000000000),
+    UINT64_C(0x9dc5ada82b70b59d), UINT64_C(0xf020000000000000),
+    UINT64_C(0xc5371912364ce305), UINT64_C(0x6c28000000000000),
+    UINT64_C(0xf684df56c3e01bc6), UINT64_C(0xc732000000000000),
+    UINT64_C(0x9a130b963a6c115c), UINT64_C(0x3c7f400000000000),
+    UINT64_C(0xc097ce7bc90715b3), UINT64_C(0x4b9f100000000000),
+    UINT64_C(0xf0bdc21abb48db20), UINT64_C(0x1e86d40000000000),
+    UINT64_C(0x96769950b50d88f4), UINT64_C(0x1314448000000000),
+    UINT64_C(0xbc143fa4e250eb31), UINT64_C(0x17d955a000000000),
+    UINT64_C(0xeb194f8e1ae525fd), UINT64_C(0x5dcfab0800000000),
+    UINT64_C(0x92efd1b8d0cf37be), UINT64_C(0x5aa1cae500000000),
+    UINT64_C(0xb7abc627050305ad), UINT64_C(0xf14a3d9e40000000),
+    UINT64_C(0xe596b7b0c643c719), UINT64_C(0x6d9ccd05d0000000),
+    UINT64_C(0x8f7e32ce7bea5c6f), UINT64_C(0xe4820023a2000000),
+    UINT64_C(0xb35dbf821ae4f38b), UINT64_C(0xdda2802c8a800000),
+    UINT64_C(0xe0352f62a19e306e), UINT64_C(0xd50b2037ad200000),
+    UINT64_C(0x8c213d9da502de45), UINT64_C(0x4526f422cc340000),
+    UINT64_C(0xaf298d050e4395d6), UINT64_C(0x9670b12b7f410000),
+    UINT64_C(0xdaf3f04651d47b4c), UINT64_C(0x3c0cdd765f114000),
+    UINT64_C(0x88d8762bf324cd0f), UINT64_C(0xa5880a69fb6ac800),
+    UINT64_C(0xab0e93b6efee0053), UINT64_C(0x8eea0d047a457a00),
+    UINT64_C(0xd5d238a4abe98068), UINT64_C(0x72a4904598d6d880),
+    UINT64_C(0x85a36366eb71f041), UINT64_C(0x47a6da2b7f864750),
+    UINT64_C(0xa70c3c40a64e6c51), UINT64_C(0x999090b65f67d924),
+    UINT64_C(0xd0cf4b50cfe20765), UINT64_C(0xfff4b4e3f741cf6d),
+    UINT64_C(0x82818f1281ed449f), UINT64_C(0xbff8f10e7a8921a4),
+    UINT64_C(0xa321f2d7226895c7), UINT64_C(0xaff72d52192b6a0d),
+    UINT64_C(0xcbea6f8ceb02bb39), UINT64_C(0x9bf4f8a69f764490),
+    UINT64_C(0xfee50b7025c36a08), UINT64_C(0x02f236d04753d5b4),
+    UINT64_C(0x9f4f2726179a2245), UINT64_C(0x01d762422c946590),
+    UINT64_C(0xc722f0ef9d80aad6), UINT64_C(0x424d3ad2b7b97ef5),
+    UINT64_C(0xf8ebad2b84e0d58b), UINT64_C(0xd2e0898765a7deb2),
+    UINT64_C(0x9b934c3b330c8577), UINT64_C(0x63cc55f49f88eb2f),
+    UINT64_C(0xc2781f49ffcfa6d5), UINT64_C(0x3cbf6b71c76b25fb),
+    UINT64_C(0xf316271c7fc3908a), UINT64_C(0x8bef464e3945ef7a),
+    UINT64_C(0x97edd871cfda3a56), UINT64_C(0x97758bf0e3cbb5ac),
+    UINT64_C(0xbde94e8e43d0c8ec), UINT64_C(0x3d52eeed1cbea317),
+    UINT64_C(0xed63a231d4c4fb27), UINT64_C(0x4ca7aaa863ee4bdd),
+    UINT64_C(0x945e455f24fb1cf8), UINT64_C(0x8fe8caa93e74ef6a),
+    UINT64_C(0xb975d6b6ee39e436), UINT64_C(0xb3e2fd538e122b44),
+    UINT64_C(0xe7d34c64a9c85d44), UINT64_C(0x60dbbca87196b616),
+    UINT64_C(0x90e40fbeea1d3a4a), UINT64_C(0xbc8955e946fe31cd),
+    UINT64_C(0xb51d13aea4a488dd), UINT64_C(0x6babab6398bdbe41),
+    UINT64_C(0xe264589a4dcdab14), UINT64_C(0xc696963c7eed2dd1),
+    UINT64_C(0x8d7eb76070a08aec), UINT64_C(0xfc1e1de5cf543ca2),
+    UINT64_C(0xb0de65388cc8ada8), UINT64_C(0x3b25a55f43294bcb),
+    UINT64_C(0xdd15fe86affad912), UINT64_C(0x49ef0eb713f39ebe),
+    UINT64_C(0x8a2dbf142dfcc7ab), UINT64_C(0x6e3569326c784337),
+    UINT64_C(0xacb92ed9397bf996), UINT64_C(0x49c2c37f07965404),
+    UINT64_C(0xd7e77a8f87daf7fb), UINT64_C(0xdc33745ec97be906),
+    UINT64_C(0x86f0ac99b4e8dafd), UINT64_C(0x69a028bb3ded71a3),
+    UINT64_C(0xa8acd7c0222311bc), UINT64_C(0xc40832ea0d68ce0c),
+    UINT64_C(0xd2d80db02aabd62b), UINT64_C(0xf50a3fa490c30190),
+    UINT64_C(0x83c7088e1aab65db), UINT64_C(0x792667c6da79e0fa),
+    UINT64_C(0xa4b8cab1a1563f52), UINT64_C(0x577001b891185938),
+    UINT64_C(0xcde6fd5e09abcf26), UINT64_C(0xed4c0226b55e6f86),
+    UINT64_C(0x80b05e5ac60b6178), UINT64_C(0x544f8158315b05b4),
+    UINT64_C(0xa0dc75f1778e39d6), UINT64_C(0x696361ae3db1c721),
+    UINT64_C(0xc913936dd571c84c), UINT64_C(0x03bc3a19cd1e38e9),
+    UINT64_C(0xfb5878494ace3a5f), UINT64_C(0x04ab48a04065c723),
+    UINT64_C(0x9d174b2dcec0e47b), UINT64_C(0x62eb0d64283f9c76),
+    UINT64_C(0xc45d1df942711d9a), UINT64_C(0x3ba5d0bd324f8394),
+    UINT64_C(0xf5746577930d6500), UINT64_C(0xca8f44ec7ee36479),
+    UINT64_C(0x9968bf6abbe85f20), UINT64_C(0x7e998b13cf4e1ecb),
+    UINT64_C(0xbfc2ef456ae276e8), UINT64_C(0x9e3fedd8c321a67e),
+    UINT64_C(0xefb3ab16c59b14a2), UINT64_C(0xc5cfe94ef3ea101e),
+    UINT64_C(0x95d04aee3b80ece5), UINT64_C(0xbba1f1d158724a12),
+    UINT64_C(0xbb445da9ca61281f), UINT64_C(0x2a8a6e45ae8edc97),
+    UINT64_C(0xea1575143cf97226), UINT64_C(0xf52d09d71a3293bd),
+    UINT64_C(0x924d692ca61be758), UINT64_C(0x593c2626705f9c56),
+    UINT64_C(0xb6e0c377cfa2e12e), UINT64_C(0x6f8b2fb00c77836c),
+    UINT64_C(0xe498f455c38b997a), UINT64_C(0x0b6dfb9c0f956447),
+    UINT64_C(0x8edf98b59a373fec), UINT64_C(0x4724bd4189bd5eac),
+    UINT64_C(0xb2977ee300c50fe7), UINT64_C(0x58edec91ec2cb657),
+    UINT64_C(0xdf3d5e9bc0f653e1), UINT64_C(0x2f2967b66737e3ed),
+    UINT64_C(0x8b865b215899f46c), UINT64_C(0xbd79e0d20082ee74),
+    UINT64_C(0xae67f1e9aec07187), UINT64_C(0xecd8590680a3aa11),
+    UINT64_C(0xda01ee641a708de9), UINT64_C(0xe80e6f4820cc9495),
+    UINT64_C(0x884134fe908658b2), UINT64_C(0x3109058d147fdcdd),
+    UINT64_C(0xaa51823e34a7eede), UINT64_C(0xbd4b46f0599fd415),
+    UINT64_C(0xd4e5e2cdc1d1ea96), UINT64_C(0x6c9e18ac7007c91a),
+    UINT64_C(0x850fadc09923329e), UINT64_C(0x03e2cf6bc604ddb0),
+    UINT64_C(0xa6539930bf6bff45), UINT64_C(0x84db8346b786151c),
+    UINT64_C(0xcfe87f7cef46ff16), UINT64_C(0xe612641865679a63),
+    UINT64_C(0x81f14fae158c5f6e), UINT64_C(0x4fcb7e8f3f60c07e),
+    UINT64_C(0xa26da3999aef7749), UINT64_C(0xe3be5e330f38f09d),
+    UINT64_C(0xcb090c8001ab551c), UINT64_C(0x5cadf5bfd3072cc5),
+    UINT64_C(0xfdcb4fa002162a63), UINT64_C(0x73d9732fc7c8f7f6),
+    UINT64_C(0x9e9f11c4014dda7e), UINT64_C(0x2867e7fddcdd9afa),
+    UINT64_C(0xc646d63501a1511d), UINT64_C(0xb281e1fd541501b8),
+    UINT64_C(0xf7d88bc24209a565), UINT64_C(0x1f225a7ca91a4226),
+    UINT64_C(0x9ae757596946075f), UINT64_C(0x3375788de9b06958),
+    UINT64_C(0xc1a12d2fc3978937), UINT64_C(0x0052d6b1641c83ae),
+    UINT64_C(0xf209787bb47d6b84), UINT64_C(0xc0678c5dbd23a49a),
+    UINT64_C(0x9745eb4d50ce6332), UINT64_C(0xf840b7ba963646e0),
+    UINT64_C(0xbd176620a501fbff), UINT64_C(0xb650e5a93bc3d898),
+    UINT64_C(0xec5d3fa8ce427aff), UINT64_C(0xa3e51f138ab4cebe),
+    UINT64_C(0x93ba47c980e98cdf), UINT64_C(0xc66f336c36b10137),
+    UINT64_C(0xb8a8d9bbe123f017), UINT64_C(0xb80b0047445d4184),
+    UINT64_C(0xe6d3102ad96cec1d), UINT64_C(0xa60dc059157491e5),
+    UINT64_C(0x9043ea1ac7e41392), UINT64_C(0x87c89837ad68db2f),
+    UINT64_C(0xb454e4a179dd1877), UINT64_C(0x29babe4598c311fb),
+    UINT64_C(0xe16a1dc9d8545e94), UINT64_C(0xf4296dd6fef3d67a),
+    UINT64_C(0x8ce2529e2734bb1d), UINT64_C(0x1899e4a65f58660c),
+    UINT64_C(0xb01ae745b101e9e4), UINT64_C(0x5ec05dcff72e7f8f),
+    UINT64_C(0xdc21a1171d42645d), UINT64_C(0x76707543f4fa1f73),
+    UINT64_C(0x899504ae72497eba), UINT64_C(0x6a06494a791c53a8),
+    UINT64_C(0xabfa45da0edbde69), UINT64_C(0x0487db9d17636892),
+    UINT64_C(0xd6f8d7509292d603), UINT64_C(0x45a9d2845d3c42b6),
+    UINT64_C(0x865b86925b9bc5c2), UINT64_C(0x0b8a2392ba45a9b2),
+    UINT64_C(0xa7f26836f282b732), UINT64_C(0x8e6cac7768d7141e),
+    UINT64_C(0xd1ef0244af2364ff), UINT64_C(0x3207d795430cd926),
+    UINT64_C(0x8335616aed761f1f), UINT64_C(0x7f44e6bd49e807b8),
+    UINT64_C(0xa402b9c5a8d3a6e7), UINT64_C(0x5f16206c9c6209a6),
+    UINT64_C(0xcd036837130890a1), UINT64_C(0x36dba887c37a8c0f),
+    UINT64_C(0x802221226be55a64), UINT64_C(0xc2494954da2c9789),
+    UINT64_C(0xa02aa96b06deb0fd), UINT64_C(0xf2db9baa10b7bd6c),
+    UINT64_C(0xc83553c5c8965d3d), UINT64_C(0x6f92829494e5acc7),
+    UINT64_C(0xfa42a8b73abbf48c), UINT64_C(0xcb772339ba1f17f9),
+    UINT64_C(0x9c69a97284b578d7), UINT64_C(0xff2a760414536efb),
+    UINT64_C(0xc38413cf25e2d70d), UINT64_C(0xfef5138519684aba),
+    UINT64_C(0xf46518c2ef5b8cd1), UINT64_C(0x7eb258665fc25d69),
+    UINT64_C(0x98bf2f79d5993802), UINT64_C(0xef2f773ffbd97a61),
+    UINT64_C(0xbeeefb584aff8603), UINT64_C(0xaafb550ffacfd8fa),
+    UINT64_C(0xeeaaba2e5dbf6784), UINT64_C(0x95ba2a53f983cf38),
+    UINT64_C(0x952ab45cfa97a0b2), UINT64_C(0xdd945a747bf26183),
+    UINT64_C(0xba756174393d88df), UINT64_C(0x94f971119aeef9e4),
+    UINT64_C(0xe912b9d1478ceb17), UINT64_C(0x7a37cd5601aab85d),
+    UINT64_C(0x91abb422ccb812ee), UINT64_C(0xac62e055c10ab33a),
+    UINT64_C(0xb616a12b7fe617aa), UINT64_C(0x577b986b314d6009),
+    UINT64_C(0xe39c49765fdf9d94), UINT64_C(0xed5a7e85fda0b80b),
+    UINT64_C(0x8e41ade9fbebc27d), UINT64_C(0x14588f13be847307),
+    UINT64_C(0xb1d219647ae6b31c), UINT64_C(0x596eb2d8ae258fc8),
+    UINT64_C(0xde469fbd99a05fe3), UINT64_C(0x6fca5f8ed9aef3bb),
+    UINT64_C(0x8aec23d680043bee), UINT64_C(0x25de7bb9480d5854),
+    UINT64_C(0xada72ccc20054ae9), UINT64_C(0xaf561aa79a10ae6a),
+    UINT64_C(0xd910f7ff28069da4), UINT64_C(0x1b2ba1518094da04),
+    UINT64_C(0x87aa9aff79042286), UINT64_C(0x90fb44d2f05d0842),
+    UINT64_C(0xa99541bf57452b28), UINT64_C(0x353a1607ac744a53),
+    UINT64_C(0xd3fa922f2d1675f2), UINT64_C(0x42889b8997915ce8),
+    UINT64_C(0x847c9b5d7c2e09b7), UINT64_C(0x69956135febada11),
+    UINT64_C(0xa59bc234db398c25), UINT64_C(0x43fab9837e699095),
+    UINT64_C(0xcf02b2c21207ef2e), UINT64_C(0x94f967e45e03f4bb),
+    UINT64_C(0x8161afb94b44f57d), UINT64_C(0x1d1be0eebac278f5),
+    UINT64_C(0xa1ba1ba79e1632dc), UINT64_C(0x6462d92a69731732),
+    UINT64_C(0xca28a291859bbf93), UINT64_C(0x7d7b8f7503cfdcfe),
+    UINT64_C(0xfcb2cb35e702af78), UINT64_C(0x5cda735244c3d43e),
+    UINT64_C(0x9defbf01b061adab), UINT64_C(0x3a0888136afa64a7),
+    UINT64_C(0xc56baec21c7a1916), UINT64_C(0x088aaa1845b8fdd0),
+    UINT64_C(0xf6c69a72a3989f5b), UINT64_C(0x8aad549e57273d45),
+    UINT64_C(0x9a3c2087a63f6399), UINT64_C(0x36ac54e2f678864b),
+    UINT64_C(0xc0cb28a98fcf3c7f), UINT64_C(0x84576a1bb416a7dd),
+    UINT64_C(0xf0fdf2d3f3c30b9f), UINT64_C(0x656d44a2a11c51d5),
+    UINT64_C(0x969eb7c47859e743), UINT64_C(0x9f644ae5a4b1b325),
+    UINT64_C(0xbc4665b596706114), UINT64_C(0x873d5d9f0dde1fee),
+    UINT64_C(0xeb57ff22fc0c7959), UINT64_C(0xa90cb506d155a7ea),
+    UINT64_C(0x9316ff75dd87cbd8), UINT64_C(0x09a7f12442d588f2),
+    UINT64_C(0xb7dcbf5354e9bece), UINT64_C(0x0c11ed6d538aeb2f),
+    UINT64_C(0xe5d3ef282a242e81), UINT64_C(0x8f1668c8a86da5fa),
+    UINT64_C(0x8fa475791a569d10), UINT64_C(0xf96e017d694487bc),
+    UINT64_C(0xb38d92d760ec4455), UINT64_C(0x37c981dcc395a9ac),
+    UINT64_C(0xe070f78d3927556a), UINT64_C(0x85bbe253f47b1417),
+    UINT64_C(0x8c469ab843b89562), UINT64_C(0x93956d7478ccec8e),
+    UINT64_C(0xaf58416654a6babb), UINT64_C(0x387ac8d1970027b2),
+    UINT64_C(0xdb2e51bfe9d0696a), UINT64_C(0x06997b05fcc0319e),
+    UINT64_C(0x88fcf317f22241e2), UINT64_C(0x441fece3bdf81f03),
+    UINT64_C(0xab3c2fddeeaad25a), UINT64_C(0xd527e81cad7626c3),
+    UINT64_C(0xd60b3bd56a5586f1), UINT64_C(0x8a71e223d8d3b074),
+    UINT64_C(0x85c7056562757456), UINT64_C(0xf6872d5667844e49),
+    UINT64_C(0xa738c6bebb12d16c), UINT64_C(0xb428f8ac016561db),
+    UINT64_C(0xd106f86e69d785c7), UINT64_C(0xe13336d701beba52),
+    UINT64_C(0x82a45b450226b39c), UINT64_C(0xecc0024661173473),
+    UINT64_C(0xa34d721642b06084), UINT64_C(0x27f002d7f95d0190),
+    UINT64_C(0xcc20ce9bd35c78a5), UINT64_C(0x31ec038df7b441f4),
+    UINT64_C(0xff290242c83396ce), UINT64_C(0x7e67047175a15271),
+    UINT64_C(0x9f79a169bd203e41), UINT64_C(0x0f0062c6e984d386),
+    UINT64_C(0xc75809c42c684dd1), UINT64_C(0x52c07b78a3e60868),
+    UINT64_C(0xf92e0c3537826145), UINT64_C(0xa7709a56ccdf8a82),
+    UINT64_C(0x9bbcc7a142b17ccb), UINT64_C(0x88a66076400bb691),
+    UINT64_C(0xc2abf989935ddbfe), UINT64_C(0x6acff893d00ea435),
+    UINT64_C(0xf356f7ebf83552fe), UINT64_C(0x0583f6b8c4124d43),
+    UINT64_C(0x98165af37b2153de), UINT64_C(0xc3727a337a8b704a),
+    UINT64_C(0xbe1bf1b059e9a8d6), UINT64_C(0x744f18c0592e4c5c),
+    UINT64_C(0xeda2ee1c7064130c), UINT64_C(0x1162def06f79df73),
+    UINT64_C(0x9485d4d1c63e8be7), UINT64_C(0x8addcb5645ac2ba8),
+    UINT64_C(0xb9a74a0637ce2ee1), UINT64_C(0x6d953e2bd7173692),
+    UINT64_C(0xe8111c87c5c1ba99), UINT64_C(0xc8fa8db6ccdd0437),
+    UINT64_C(0x910ab1d4db9914a0), UINT64_C(0x1d9c9892400a22a2),
+    UINT64_C(0xb54d5e4a127f59c8), UINT64_C(0x2503beb6d00cab4b),
+    UINT64_C(0xe2a0b5dc971f303a), UINT64_C(0x2e44ae64840fd61d),
+    UINT64_C(0x8da471a9de737e24), UINT64_C(0x5ceaecfed289e5d2),
+    UINT64_C(0xb10d8e1456105dad), UINT64_C(0x7425a83e872c5f47),
+    UINT64_C(0xdd50f1996b947518), UINT64_C(0xd12f124e28f77719),
+    UINT64_C(0x8a5296ffe33cc92f), UINT64_C(0x82bd6b70d99aaa6f),
+    UINT64_C(0xace73cbfdc0bfb7b), UINT64_C(0x636cc64d1001550b),
+    UINT64_C(0xd8210befd30efa5a), UINT64_C(0x3c47f7e05401aa4e),
+    UINT64_C(0x8714a775e3e95c78), UINT64_C(0x65acfaec34810a71),
+    UINT64_C(0xa8d9d1535ce3b396), UINT64_C(0x7f1839a741a14d0d),
+    UINT64_C(0xd31045a8341ca07c), UINT64_C(0x1ede48111209a050),
+    UINT64_C(0x83ea2b892091e44d), UINT64_C(0x934aed0aab460432),
+    UINT64_C(0xa4e4b66b68b65d60), UINT64_C(0xf81da84d5617853f),
+    UINT64_C(0xce1de40642e3f4b9), UINT64_C(0x36251260ab9d668e),
+    UINT64_C(0x80d2ae83e9ce78f3), UINT64_C(0xc1d72b7c6b426019),
+    UINT64_C(0xa1075a24e4421730), UINT64_C(0xb24cf65b8612f81f),
+    UINT64_C(0xc94930ae1d529cfc), UINT64_C(0xdee033f26797b627),
+    UINT64_C(0xfb9b7cd9a4a7443c), UINT64_C(0x169840ef017da3b1),
+    UINT64_C(0x9d412e0806e88aa5), UINT64_C(0x8e1f289560ee864e),
+    UINT64_C(0xc491798a08a2ad4e), UINT64_C(0xf1a6f2bab92a27e2),
+    UINT64_C(0xf5b5d7ec8acb58a2), UINT64_C(0xae10af696774b1db),
+    UINT64_C(0x9991a6f3d6bf1765), UINT64_C(0xacca6da1e0a8ef29),
+    UINT64_C(0xbff610b0cc6edd3f), UINT64_C(0x17fd090a58d32af3),
+    UINT64_C(0xeff394dcff8a948e), UINT64_C(0xddfc4b4cef07f5b0),
+    UINT64_C(0x95f83d0a1fb69cd9), UINT64_C(0x4abdaf101564f98e),
+    UINT64_C(0xbb764c4ca7a4440f), UINT64_C(0x9d6d1ad41abe37f1),
+    UINT64_C(0xea53df5fd18d5513), UINT64_C(0x84c86189216dc5ed),
+    UINT64_C(0x92746b9be2f8552c), UINT64_C(0x32fd3cf5b4e49bb4),
+    UINT64_C(0xb7118682dbb66a77), UINT64_C(0x3fbc8c33221dc2a1),
+    UINT64_C(0xe4d5e82392a40515), UINT64_C(0x0fabaf3feaa5334a),
+    UINT64_C(0x8f05b1163ba6832d), UINT64_C(0x29cb4d87f2a7400e),
+    UINT64_C(0xb2c71d5bca9023f8), UINT64_C(0x743e20e9ef511012),
+    UINT64_C(0xdf78e4b2bd342cf6), UINT64_C(0x914da9246b255416),
+    UINT64_C(0x8bab8eefb6409c1a), UINT64_C(0x1ad089b6c2f7548e),
+    UINT64_C(0xae9672aba3d0c320), UINT64_C(0xa184ac2473b529b1),
+    UINT64_C(0xda3c0f568cc4f3e8), UINT64_C(0xc9e5d72d90a2741e),
+    UINT64_C(0x8865899617fb1871), UINT64_C(0x7e2fa67c7a658892),
+    UINT64_C(0xaa7eebfb9df9de8d), UINT64_C(0xddbb901b98feeab7),
+    UINT64_C(0xd51ea6fa85785631), UINT64_C(0x552a74227f3ea565),
+    UINT64_C(0x8533285c936b35de), UINT64_C(0xd53a88958f87275f),
+    UINT64_C(0xa67ff273b8460356), UINT64_C(0x8a892abaf368f137),
+    UINT64_C(0xd01fef10a657842c), UINT64_C(0x2d2b7569b0432d85),
+    UINT64_C(0x8213f56a67f6b29b), UINT64_C(0x9c3b29620e29fc73),
+    UINT64_C(0xa298f2c501f45f42), UINT64_C(0x8349f3ba91b47b8f),
+    UINT64_C(0xcb3f2f7642717713), UINT64_C(0x241c70a936219a73),
+    UINT64_C(0xfe0efb53d30dd4d7), UINT64_C(0xed238cd383aa0110),
+    UINT64_C(0x9ec95d1463e8a506), UINT64_C(0xf4363804324a40aa),
+    UINT64_C(0xc67bb4597ce2ce48), UINT64_C(0xb143c6053edcd0d5),
+    UINT64_C(0xf81aa16fdc1b81da), UINT64_C(0xdd94b7868e94050a),
+    UINT64_C(0x9b10a4e5e9913128), UINT64_C(0xca7cf2b4191c8326),
+    UINT64_C(0xc1d4ce1f63f57d72), UINT64_C(0xfd1c2f611f63a3f0),
+    UINT64_C(0xf24a01a73cf2dccf), UINT64_C(0xbc633b39673c8cec),
+    UINT64_C(0x976e41088617ca01), UINT64_C(0xd5be0503e085d813),
+    UINT64_C(0xbd49d14aa79dbc82), UINT64_C(0x4b2d8644d8a74e18),
+    UINT64_C(0xec9c459d51852ba2), UINT64_C(0xddf8e7d60ed1219e),
+    UINT64_C(0x93e1ab8252f33b45), UINT64_C(0xcabb90e5c942b503),
+    UINT64_C(0xb8da1662e7b00a17), UINT64_C(0x3d6a751f3b936243),
+    UINT64_C(0xe7109bfba19c0c9d), UINT64_C(0x0cc512670a783ad4),
+    UINT64_C(0x906a617d450187e2), UINT64_C(0x27fb2b80668b24c5),
+    UINT64_C(0xb484f9dc9641e9da), UINT64_C(0xb1f9f660802dedf6),
+    UINT64_C(0xe1a63853bbd26451), UINT64_C(0x5e7873f8a0396973),
+    UINT64_C(0x8d07e33455637eb2), UINT64_C(0xdb0b487b6423e1e8),
+    UINT64_C(0xb049dc016abc5e5f), UINT64_C(0x91ce1a9a3d2cda62),
+    UINT64_C(0xdc5c5301c56b75f7), UINT64_C(0x7641a140cc7810fb),
+    UINT64_C(0x89b9b3e11b6329ba), UINT64_C(0xa9e904c87fcb0a9d),
+    UINT64_C(0xac2820d9623bf429), UINT64_C(0x546345fa9fbdcd44),
+    UINT64_C(0xd732290fbacaf133), UINT64_C(0xa97c177947ad4095),
+    UINT64_C(0x867f59a9d4bed6c0), UINT64_C(0x49ed8eabcccc485d),
+    UINT64_C(0xa81f301449ee8c70), UINT64_C(0x5c68f256bfff5a74),
+    UINT64_C(0xd226fc195c6a2f8c), UINT64_C(0x73832eec6fff3111),
+    UINT64_C(0x83585d8fd9c25db7), UINT64_C(0xc831fd53c5ff7eab),
+    UINT64_C(0xa42e74f3d032f525), UINT64_C(0xba3e7ca8b77f5e55),
+    UINT64_C(0xcd3a1230c43fb26f), UINT64_C(0x28ce1bd2e55f35eb),
+    UINT64_C(0x80444b5e7aa7cf85), UINT64_C(0x7980d163cf5b81b3),
+    UINT64_C(0xa0555e361951c366), UINT64_C(0xd7e105bcc332621f),
+    UINT64_C(0xc86ab5c39fa63440), UINT64_C(0x8dd9472bf3fefaa7),
+    UINT64_C(0xfa856334878fc150), UINT64_C(0xb14f98f6f0feb951),
+    UINT64_C(0x9c935e00d4b9d8d2), UINT64_C(0x6ed1bf9a569f33d3),
+    UINT64_C(0xc3b8358109e84f07), UINT64_C(0x0a862f80ec4700c8),
+    UINT64_C(0xf4a642e14c6262c8), UINT64_C(0xcd27bb612758c0fa),
+    UINT64_C(0x98e7e9cccfbd7dbd), UINT64_C(0x8038d51cb897789c),
+    UINT64_C(0xbf21e44003acdd2c), UINT64_C(0xe0470a63e6bd56c3),
+    UINT64_C(0xeeea5d5004981478), UINT64_C(0x1858ccfce06cac74),
+    UINT64_C(0x95527a5202df0ccb), UINT64_C(0x0f37801e0c43ebc8),
+    UINT64_C(0xbaa718e68396cffd), UINT64_C(0xd30560258f54e6ba),
+    UINT64_C(0xe950df20247c83fd), UINT64_C(0x47c6b82ef32a2069),
+    UINT64_C(0x91d28b7416cdd27e), UINT64_C(0x4cdc331d57fa5441),
+    UINT64_C(0xb6472e511c81471d), UINT64_C(0xe0133fe4adf8e952),
+    UINT64_C(0xe3d8f9e563a198e5), UINT64_C(0x58180fddd97723a6),
+    UINT64_C(0x8e679c2f5e44ff8f), UINT64_C(0x570f09eaa7ea7648)
+};
+
+/* Full 64x64 -> 128-bit product */
+static uint64_t lept_mul128(uint64_t a, uint64_t b, uint64_t* hi) {
+#if defined(__SIZEOF_INT128__)
+    __extension__ typedef unsigned __int128 lept_uint128;
+    lept_uint128 r = (lept_uint128)a * b;
+    *hi = (uint64_t)(r >> 64);
+    return (uint64_t)r;
+#else
+    uint64_t a0 = (uint32_t)a, a1 = a >> 32, b0 = (uint32_t)b, b1 = b >> 32;
+    uint64_t p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+    uint64_t mid = (p00 >> 32) + (uint32_t)p01 + (uint32_t)p10;
+    *hi = p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+    return (mid << 32) | (uint32_t)p00;
+#endif
+}
+
+static int lept_clz64(uint64_t x) {
+    int n = 0;
+    if (!(x >> 32)) { n += 32; x <<= 32; }
+    if (!(x >> 48)) { n += 16; x <<= 16; }
+    if (!(x >> 56)) { n += 8; x <<= 8; }
+    if (!(x >> 60)) { n += 4; x <<= 4; }
+    if (!(x >> 62)) { n += 2; x <<= 2; }
+    if (!(x >> 63)) { n += 1; }
+    return n;
+}
+
+/* Eisel-Lemire: the IEEE bits of w * 10^q (w != 0), without the sign */
+static uint64_t lept_eisel_lemire(uint64_t w, int q) {
+    uint64_t lo, hi, lo2, hi2, mantissa;
+    int lz, upperbit, shift, power2;
+    const uint64_t* t;
+    if (q < LEPT_POW5_MIN)
+        return 0;
+    if (q > LEPT_POW5_MAX)
+        return (uint64_t)0x7FF << 52;
+    lz = lept_clz64(w);
+    w <<= lz;
+    t = &lept_pow5_128[2 * (q - LEPT_POW5_MIN)];
+    lo = lept_mul128(w, t[0], &hi);
+    if ((hi & 0x1FF) == 0x1FF) { /* low bits may carry into the result: use the full 128 bits */
+        lept_mul128(w, t[1], &hi2);
+        lo2 = lo + hi2;
+        if (lo2 < lo)
+            hi++;
+        lo = lo2;
+    }
+    upperbit = (int)(hi >> 63);
+    shift = upperbit + 64 - 52 - 3;
+    mantissa = hi >> shift;
+    /* floor(q * log2(10)) + 63 + upperbit - lz, biased */
+    power2 = (int)((((152170 + 65536) * (long)q) >> 16) + 63) + upperbit - lz + 1023;
+    if (power2 <= 0) { /* subnormal */
+        if (-power2 + 1 >= 64)
+            return 0;
+        mantissa >>= -power2 + 1;
+        mantissa += mantissa & 1;
+        mantissa >>= 1;
+        power2 = mantissa < ((uint64_t)1 << 52) ? 0 : 1;
+        return ((uint64_t)power2 << 52) | (mantissa & (((uint64_t)1 << 52) - 1));
+    }
+    /* exactly halfway: round to even */
+    if (lo <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1 && (mantissa << shift) == hi)
+        mantissa &= ~(uint64_t)1;
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    if (mantissa >= ((uint64_t)2 << 52)) {
+        mantissa = (uint64_t)1 << 52;
+        power2++;
+    }
+    if (power2 >= 0x7FF)
+        return (uint64_t)0x7FF << 52;
+    return ((uint64_t)power2 << 52) | (mantissa & (((uint64_t)1 << 52) - 1));
+}
+
+static double lept_make_double(uint64_t bits, int negative) {
+    double d;
+    bits |= (uint64_t)negative << 63;
+    memcpy(&d, &bits, sizeof(d));
+    return d;
+}
+
+/* Accumulate one significant digit into w, or account for a dropped one */
+#define ADD_DIGIT(ch, fraction)                         \
+    do {                                                \
+        if (digits < 19) {                              \
+            w = w * 10 + ((ch) - '0');                  \
+            if (w) digits++;                            \
+            if (fraction) q--;                          \
+        } else {                                        \
+            if (!(fraction)) q++;                       \
+            if ((ch) != '0') truncated = 1;             \
+        }                                               \
+    } while(0)
+
 static int lept_parse_number(lept_context* c, lept_value* v) {
     const char *p = c->json;
-    if (*p == '-') ++p;
-    if (*p == '0') ++p;
+    uint64_t w = 0;
+    long q = 0, e = 0;
+    int digits = 0, negative = 0, exp_negative = 0, truncated = 0, integral = 1;
+    if (CHAR_AT(c, p) == '-') { ++p; negative = 1; }
+    if (CHAR_AT(c, p) == '0') ++p;
     else {
-        if (!ISDIGIT1TO9(*p)) return LEPT_PARSE_INVALID_VALUE;
-        while (ISDIGIT(*p)) ++p;
+        if (!ISDIGIT1TO9(CHAR_AT(c, p))) return LEPT_PARSE_INVALID_VALUE;
+        for (; ISDIGIT(CHAR_AT(c, p)); ++p)
+            ADD_DIGIT(*p, 0);
     }
-    if (*p == '.') {
+    if (CHAR_AT(c, p) == '.') {
         ++p;
-        if (!ISDIGIT(*p)) return LEPT_PARSE_INVALID_VALUE;
-        while (ISDIGIT(*p)) ++p;
+        integral = 0;
+        if (!ISDIGIT(CHAR_AT(c, p))) return LEPT_PARSE_INVALID_VALUE;
+        for (; ISDIGIT(CHAR_AT(c, p)); ++p)
+            ADD_DIGIT(*p, 1);
     }
-    if (*p == 'e' || *p == 'E') {
+    if (CHAR_AT(c, p) == 'e' || CHAR_AT(c, p) == 'E') {
         ++p;
-        if (*p == '+' || *p == '-') ++p;
-        if (!ISDIGIT(*p)) return LEPT_PARSE_INVALID_VALUE;
-        while (ISDIGIT(*p)) ++p;
+        integral = 0;
+        if (CHAR_AT(c, p) == '+') ++p;
+        else if (CHAR_AT(c, p) == '-') { ++p; exp_negative = 1; }
+        if (!ISDIGIT(CHAR_AT(c, p))) return LEPT_PARSE_INVALID_VALUE;
+        for (; ISDIGIT(CHAR_AT(c, p)); ++p)
+            if (e < 100000) /* far beyond any finite double */
+                e = e * 10 + (*p - '0');
+    }
+    q += exp_negative ? -e : e;
+
+    if (integral && (q == 0 || (q == 1 && w <= (UINT64_MAX - (p[-1] - '0')) / 10))) {
+        /* an integer literal that fits 64 bits is kept exact */
+        uint64_t u = q ? w * 10 + (p[-1] - '0') : w;
+        if (!negative) {
+            v->u.ui = u;
+            v->flags = u <= INT64_MAX ? LEPT_INT64 : LEPT_UINT64;
+            c->json = p;
+            v->type = LEPT_NUMBER;
+            return LEPT_PARSE_OK;
+        }
+        if (u != 0 && u - 1 <= INT64_MAX) { /* -0 stays a double */
+            v->u.i = -(int64_t)(u - 1) - 1;
+            v->flags = LEPT_INT64;
+            c->json = p;
+            v->type = LEPT_NUMBER;
+            return LEPT_PARSE_OK;
+        }
+    }
+
+    if (w == 0)
+        v->u.n = negative ? -0.0 : 0.0;
+    else if (!truncated && w <= ((uint64_t)1 << 53) && q >= -22 && q <= 22)
+        v->u.n = q < 0 ? (negative ? -(double)w : (double)w) / lept_pow10[-q]
+                       : (negative ? -(double)w : (double)w) * lept_pow10[q];
+    else {
+        uint64_t bits = lept_eisel_lemire(w, (int)(q < -400 ? -400 : q > 400 ? 400 : q));
+        if (truncated && bits != lept_eisel_lemire(w + 1, (int)(q < -400 ? -400 : q > 400 ? 400 : q))) {
+            /* the dropped digits decide the rounding */
+            size_t n = p - c->json;
+            char* buf = (char*)lept_context_push(c, n + 1);
+            memcpy(buf, c->json, n);
+            buf[n] = '\0';
+            v->u.n = strtod(buf, NULL);
+            c->top -= n + 1;
+        }
+        else
+            v->u.n = lept_make_double(bits, negative);
     }
-    errno = 0;
-    v->u.n = strtod(c->json, NULL);
-    if (errno == ERANGE && (v->u.n == HUGE_VAL || v->u.n == -HUGE_VAL))
+    if (v->u.n == HUGE_VAL || v->u.n == -HUGE_VAL)
         return LEPT_PARSE_NUMBER_TOO_BIG;
     c->json = p;
     v->type = LEPT_NUMBER;
+    v->flags = 0;
     return LEPT_PARSE_OK;
 }
 
-static const char* lept_parse_hex4(const char* p, unsigned* u) {
+static const char* lept_parse_hex4(const char* p, const char* end, unsigned* u) {
     int i;
     *u = 0;
+    if (end - p < 4)
+        return NULL;
     for (i = 0; i < 4; ++i) {
         char ch = *p++;
         *u <<= 4;
@@ -141,242 +1323,2314 @@ static const char* lept_parse_hex4(const char* p, unsigned* u) {
     return p;
 }
 
-static void lept_encode_utf8(lept_context* c, unsigned u) {
+static char* lept_encode_utf8(char* p, unsigned u) {
     assert(u <= 0x10FFFF);
     if (u <= 0x007F) {
-        PUTC(c, u);
+        *p++ = (char)u;
     } else if (u <= 0x07FF) {
-        PUTC(c, 0xC0 | ((u >> 6) & 0xFF));  /* 0xC0 = 11000000 */
-        PUTC(c, 0x80 | ( u       & 0x3F));  /* 0x3F = 00111111 */
+        *p++ = (char)(0xC0 | ((u >> 6) & 0xFF));  /* 0xC0 = 11000000 */
+        *p++ = (char)(0x80 | ( u       & 0x3F));  /* 0x3F = 00111111 */
     } else if (u <= 0xFFFF) {
-        PUTC(c, 0xE0 | ((u >> 12) & 0x1F)); /* 0xE0 = 11100000 */
-        PUTC(c, 0x80 | ((u >>  6) & 0x3F)); /* 0x80 = 10000000 */
-        PUTC(c, 0x80 | ( u        & 0x3F));
+        *p++ = (char)(0xE0 | ((u >> 12) & 0x1F)); /* 0xE0 = 11100000 */
+        *p++ = (char)(0x80 | ((u >>  6) & 0x3F)); /* 0x80 = 10000000 */
+        *p++ = (char)(0x80 | ( u        & 0x3F));
     } else { /* 0x10000 - 0x10FFFF */
-        PUTC(c, 0xF0 | ((u >> 18) & 0xFF)); /* 0xF0 = 11110000 */
-        PUTC(c, 0x80 | ((u >> 12) & 0x3F));
-        PUTC(c, 0x80 | ((u >>  6) & 0x3F));
-        PUTC(c, 0x80 | ( u        & 0x3F));
+        *p++ = (char)(0xF0 | ((u >> 18) & 0xFF)); /* 0xF0 = 11110000 */
+        *p++ = (char)(0x80 | ((u >> 12) & 0x3F));
+        *p++ = (char)(0x80 | ((u >>  6) & 0x3F));
+        *p++ = (char)(0x80 | ( u        & 0x3F));
+    }
+    return p;
+}
+
+/* Decode the escape sequence after a backslash at @p into @*w (at most 4 bytes) */
+/* Return the position after the sequence, or NULL and the error in @*ret */
+static const char* lept_parse_escape(const char* p, const char* end, char** w, int* ret) {
+    unsigned u, u2;
+    switch (p < end ? *p++ : '\0') {
+    case '"':  *(*w)++ = '"';  return p;
+    case '\\': *(*w)++ = '\\'; return p;
+    case '/':  *(*w)++ = '/';  return p;
+    case 'b':  *(*w)++ = '\b'; return p;
+    case 'f':  *(*w)++ = '\f'; return p;
+    case 'n':  *(*w)++ = '\n'; return p;
+    case 'r':  *(*w)++ = '\r'; return p;
+    case 't':  *(*w)++ = '\t'; return p;
+    case 'u':
+        if (!(p = lept_parse_hex4(p, end, &u))) {
+            *ret = LEPT_PARSE_INVALID_UNICODE_HEX;
+            return NULL;
+        }
+        if (u >= 0xD800 && u <= 0xDBFF) {
+            if (end - p < 2 || *p++ != '\\' || *p++ != 'u') {
+                *ret = LEPT_PARSE_INVALID_UNICODE_SURROGATE;
+                return NULL;
+            }
+            if (!(p = lept_parse_hex4(p, end, &u2))) {
+                *ret = LEPT_PARSE_INVALID_UNICODE_HEX;
+                return NULL;
+            }
+            if (u2 < 0xDC00 || u2 > 0xDFFF) {
+                *ret = LEPT_PARSE_INVALID_UNICODE_SURROGATE;
+                return NULL;
+            }
+            u = 0x10000 + ((u - 0xD800) << 10) + (u2 - 0xDC00);
+        }
+        *w = lept_encode_utf8(*w, u);
+        return p;
+    default:
+        *ret = LEPT_PARSE_INVALID_STRING_ESCAPE;
+        return NULL;
+    }
+}
+
+/* Find the first '"', '\\' or control character in [p, end), or end */
+static const char* lept_scan_string(const char* p, const char* end) {
+#if defined(LEPT_AVX2)
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i control = _mm256_set1_epi8(0x1F);
+    while (end - p >= 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)p);
+        __m256i m = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(x, quote), _mm256_cmpeq_epi8(x, backslash)),
+            _mm256_cmpeq_epi8(_mm256_min_epu8(x, control), x)); /* x <= 0x1F */
+        unsigned mask = (unsigned)_mm256_movemask_epi8(m);
+        if (mask)
+            return p + LEPT_CTZ(mask);
+        p += 32;
     }
+#endif
+#if defined(LEPT_SSE2)
+    {
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        const __m128i control = _mm_set1_epi8(0x1F);
+        while (end - p >= 16) {
+            __m128i x = _mm_loadu_si128((const __m128i*)p);
+            __m128i m = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(x, quote), _mm_cmpeq_epi8(x, backslash)),
+                _mm_cmpeq_epi8(_mm_min_epu8(x, control), x)); /* x <= 0x1F */
+            unsigned mask = (unsigned)_mm_movemask_epi8(m);
+            if (mask)
+                return p + LEPT_CTZ(mask);
+            p += 16;
+        }
+    }
+#endif
+    while (p < end && *p != '"' && *p != '\\' && (unsigned char)*p >= 0x20)
+        p++;
+    return p;
 }
 
 #define STRING_ERROR(ret) do { c->top = head; return ret; } while(0)
 
 /* Parse JSON string, write result into @str and @len */
-/* str points to c->stack element */
+/* str points to a c->stack element, or into the input when there is nothing to unescape */
 static int lept_parse_string_raw(lept_context* c, char** str, size_t* len) {
     size_t head = c->top;
-    unsigned u;
-    const char* p;
+    int ret;
+    const char *p, *q;
+    char* w;
     EXPECT(c, '\"');
     p = c->json;
+    q = lept_scan_string(p, c->end);
+    if (q < c->end && *q == '\"') {
+        *str = (char*)p;
+        *len = q - p;
+        c->json = q + 1;
+        return LEPT_PARSE_OK;
+    }
     for (;;) {
-        char ch = *p++;
-        switch (ch) {
+        if (q != p) {
+            PUTS(c, p, q - p);
+            p = q;
+        }
+        if (p == c->end)
+            STRING_ERROR(LEPT_PARSE_MISS_QUOTATION_MARK);
+        switch (*p++) {
         case '\"':
             *len = c->top - head;
             *str = lept_context_pop(c, *len);
             c->json = p;
             return LEPT_PARSE_OK;
         case '\\':
-            ch = *p++;
-            switch (ch) {
-            case '"':  PUTC(c, '"');  break;
-            case '\\': PUTC(c, '\\'); break;
-            case '/':  PUTC(c, '/');  break;
-            case 'b':  PUTC(c, '\b'); break;
-            case 'f':  PUTC(c, '\f'); break;
-            case 'n':  PUTC(c, '\n'); break;
-            case 'r':  PUTC(c, '\r'); break;
-            case 't':  PUTC(c, '\t'); break;
-            case 'u':
-                if (!(p = lept_parse_hex4(p, &u)))
-                    STRING_ERROR(LEPT_PARSE_INVALID_UNICODE_HEX);
-                if (u >= 0xD800 && u <= 0xDBFF) {
-                    unsigned u2;
-                    if (*p++ != '\\')
-                        STRING_ERROR(LEPT_PARSE_INVALID_UNICODE_SURROGATE);
-                    if (*p++ != 'u')
-                        STRING_ERROR(LEPT_PARSE_INVALID_UNICODE_SURROGATE);
-                    if (!(p = lept_parse_hex4(p, &u2)))
-                        STRING_ERROR(LEPT_PARSE_INVALID_UNICODE_HEX);
-                    if (u2 < 0xDC00 || u2 > 0xDFFF)
-                        STRING_ERROR(LEPT_PARSE_INVALID_UNICODE_SURROGATE);
-                    u = 0x10000 + ((u - 0xD800) << 10) + (u2 - 0xDC00);
-                }
-                lept_encode_utf8(c, u);
-                break;
-            default:
-                STRING_ERROR(LEPT_PARSE_INVALID_STRING_ESCAPE);
-            }
+            w = (char*)lept_context_push(c, 4);
+            if (!(p = lept_parse_escape(p, c->end, &w, &ret)))
+                STRING_ERROR(ret);
+            c->top = w - c->stack;
+            break;
+        default:
+            STRING_ERROR(LEPT_PARSE_INVALID_STRING_CHAR);
+        }
+        q = lept_scan_string(p, c->end);
+    }
+}
+
+/* In-situ variant: decode in place inside the input and NUL-terminate there */
+static int lept_parse_string_insitu(lept_context* c, char** str, size_t* len) {
+    int ret;
+    const char *p, *q;
+    char* w;
+    EXPECT(c, '\"');
+    p = c->json;
+    *str = w = (char*)p;
+    for (;;) {
+        q = lept_scan_string(p, c->end);
+        if (w != p)
+            memmove(w, p, q - p);
+        w += q - p;
+        p = q;
+        if (p == c->end)
+            return LEPT_PARSE_MISS_QUOTATION_MARK;
+        switch (*p++) {
+        case '\"':
+            *len = w - *str;
+            *w = '\0';
+            c->json = p;
+            return LEPT_PARSE_OK;
+        case '\\':
+            if (!(p = lept_parse_escape(p, c->end, &w, &ret)))
+                return ret;
             break;
-        case '\0':
-            STRING_ERROR(LEPT_PARSE_MISS_QUOTATION_MARK);
         default:
-            if (ch < '\x20')
-                STRING_ERROR(LEPT_PARSE_INVALID_STRING_CHAR);
-            PUTC(c, ch);
+            return LEPT_PARSE_INVALID_STRING_CHAR;
         }
     }
 }
 
+/* Turn @v into a string of @len bytes, inline when short, otherwise from @a (NULL for the heap) */
+static char* lept_set_string_storage(lept_value* v, size_t len, lept_arena* a) {
+    char* s;
+    v->type = LEPT_STRING;
+    if (len <= LEPT_SHORT_MAX) {
+        v->flags = LEPT_SHORT_STRING;
+        s = SHORT_STRING(v);
+        s[LEPT_SHORT_MAX] = (char)(LEPT_SHORT_MAX - len);
+    }
+    else {
+        assert(len <= LEPT_SIZE_MAX);
+        v->flags = a ? LEPT_BORROWED_BUFFER : 0;
+        s = v->u.s.s = (char*)(a ? lept_arena_alloc(a, len + 1) : MALLOC(len + 1));
+        S_LENGTH(v) = len;
+    }
+    s[len] = '\0';
+    return s;
+}
+
 static int lept_parse_string(lept_context* c, lept_value* v) {
     int ret;
     char *s;
     size_t len;
-    if ((ret = lept_parse_string_raw(c, &s, &len)) == LEPT_PARSE_OK)
-        lept_set_string(v, s, len);
+    if (c->sax) {
+        if ((ret = lept_parse_string_raw(c, &s, &len)) == LEPT_PARSE_OK)
+            ret = SAX_EVENT(c, string, (c->sax_ctx, s, len));
+        return ret;
+    }
+    if (c->insitu) {
+        if ((ret = lept_parse_string_insitu(c, &s, &len)) == LEPT_PARSE_OK) {
+            assert(len <= LEPT_SIZE_MAX);
+            v->u.s.s = s;
+            S_LENGTH(v) = len;
+            v->type = LEPT_STRING;
+            v->flags = LEPT_BORROWED_BUFFER;
+        }
+    }
+    else if ((ret = lept_parse_string_raw(c, &s, &len)) == LEPT_PARSE_OK)
+        memcpy(lept_set_string_storage(v, len, c->arena), s, len);
     return ret;
 }
 
-static int lept_parse_array(lept_context* c, lept_value* v) {
-    size_t size = 0, i;
-    int ret;
-    EXPECT(c, '[');
-    lept_parse_whitespace(c);
-    if (*c->json == ']') {
-        c->json++;
-        lept_set_array(v, 0);
-        return LEPT_PARSE_OK;
+/*
+ * Object hash index: an open-addressing table of member index + 1 (0 is an
+ * empty slot) that lives in the same allocation right after the members, so
+ * lept_move()/lept_swap() carry it along. Members keep insertion order; the
+ * table is rebuilt whenever members move or the capacity changes.
+ */
+#define LEPT_HASH_SLOTS(v) ((size_t*)((v)->u.o.m + O_CAPACITY(v)))
+
+static size_t lept_hash_key(const char* k, size_t klen) {
+    uint64_t h = UINT64_C(0x9e3779b97f4a7c15) ^ klen, w;
+    for (; klen >= 8; k += 8, klen -= 8) {
+        memcpy(&w, k, 8);
+        h = (h ^ w) * UINT64_C(0xff51afd7ed558ccd);
+        h ^= h >> 32;
     }
-    for (;;) {
-        lept_value e;
-        lept_init(&e);
-        if ((ret = lept_parse_value(c, &e)) != LEPT_PARSE_OK)
-            break;
-        memcpy(lept_context_push(c, sizeof(lept_value)), &e, sizeof(lept_value));
-        size++;
-        lept_parse_whitespace(c);
-        if (*c->json == ',') {
-            c->json++;
-            lept_parse_whitespace(c);
-        }
-        else if (*c->json == ']') {
-            c->json++;
-            lept_set_array(v, size);
-            memcpy(v->u.a.e, lept_context_pop(c, size * sizeof(lept_value)), size * sizeof(lept_value));
-            v->u.a.size = size;
-            return LEPT_PARSE_OK;
-        }
-        else {
-            ret = LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
-            break;
+    w = 0;
+    memcpy(&w, k, klen);
+    h = (h ^ w) * UINT64_C(0xff51afd7ed558ccd);
+    return (size_t)(h ^ (h >> 29));
+}
+
+/* A power of two, so that the table is at most half full */
+static size_t lept_hash_buckets(size_t capacity) {
+    size_t n = 8;
+    while (n < capacity * 2)
+        n <<= 1;
+    return n;
+}
+
+static size_t lept_object_bytes(size_t capacity, int hashed) {
+    return capacity * sizeof(lept_member) + (hashed ? lept_hash_buckets(capacity) * sizeof(size_t) : 0);
+}
+
+/* Header of a pooled key, followed by the key and a NUL */
+typedef struct {
+    size_t hash, klen;
+} lept_pool_key;
+
+#define LEPT_POOL_KEY(k) ((const lept_pool_key*)(k) - 1)
+
+void lept_key_pool_init(lept_key_pool *pool, const lept_allocator *allocator) {
+    assert(pool != NULL);
+    lept_arena_init(&pool->arena, 0, allocator);
+    pool->slots = NULL;
+    pool->buckets = pool->count = 0;
+}
+
+void lept_key_pool_free(lept_key_pool *pool) {
+    assert(pool != NULL);
+    lept_mem_free(&pool->arena.allocator, (void*)pool->slots);
+    lept_arena_free(&pool->arena);
+    pool->slots = NULL;
+    pool->buckets = pool->count = 0;
+}
+
+static void lept_key_pool_grow(lept_key_pool* pool) {
+    size_t buckets = pool->buckets ? pool->buckets * 2 : 64, i, h;
+    const char** slots = (const char**)lept_mem_alloc(&pool->arena.allocator, buckets * sizeof(const char*));
+    memset((void*)slots, 0, buckets * sizeof(const char*));
+    for (i = 0; i < pool->buckets; i++)
+        if (pool->slots[i]) {
+            h = LEPT_POOL_KEY(pool->slots[i])->hash & (buckets - 1);
+            while (slots[h])
+                h = (h + 1) & (buckets - 1);
+            slots[h] = pool->slots[i];
         }
+    lept_mem_free(&pool->arena.allocator, (void*)pool->slots);
+    pool->slots = slots;
+    pool->buckets = buckets;
+}
+
+const char* lept_key_pool_intern(lept_key_pool *pool, const char *key, size_t klen) {
+    size_t hash, h;
+    lept_pool_key* pk;
+    assert(pool != NULL && key != NULL);
+    if ((pool->count + 1) * 2 > pool->buckets)
+        lept_key_pool_grow(pool);
+    hash = lept_hash_key(key, klen);
+    for (h = hash & (pool->buckets - 1); pool->slots[h]; h = (h + 1) & (pool->buckets - 1)) {
+        const lept_pool_key* e = LEPT_POOL_KEY(pool->slots[h]);
+        if (e->hash == hash && e->klen == klen && memcmp(pool->slots[h], key, klen) == 0)
+            return pool->slots[h];
     }
-    /* Pop and free values on the stack */
-    for (i = 0; i < size; i++) {
-        lept_free((lept_value*)lept_context_pop(c, sizeof(lept_value)));
+    pk = (lept_pool_key*)lept_arena_alloc(&pool->arena, sizeof(lept_pool_key) + klen + 1);
+    pk->hash = hash;
+    pk->klen = klen;
+    memcpy(pk + 1, key, klen);
+    ((char*)(pk + 1))[klen] = '\0';
+    pool->count++;
+    return pool->slots[h] = (const char*)(pk + 1);
+}
+
+static void lept_hash_insert(lept_value* v, size_t index) {
+    size_t* slots = LEPT_HASH_SLOTS(v);
+    size_t mask = lept_hash_buckets(O_CAPACITY(v)) - 1;
+    const lept_member* m = &v->u.o.m[index];
+    size_t h = (v->flags & LEPT_POOLED_KEYS ? LEPT_POOL_KEY(m->k)->hash : lept_hash_key(m->k, m->klen)) & mask;
+    while (slots[h])
+        h = (h + 1) & mask;
+    slots[h] = index + 1;
+}
+
+static void lept_hash_rebuild(lept_value* v) {
+    size_t i;
+    memset(LEPT_HASH_SLOTS(v), 0, lept_hash_buckets(O_CAPACITY(v)) * sizeof(size_t));
+    for (i = 0; i < O_SIZE(v); i++)
+        lept_hash_insert(v, i);
+}
+
+static size_t lept_hash_find(const lept_value* v, const char* key, size_t klen) {
+    const size_t* slots = LEPT_HASH_SLOTS(v);
+    size_t mask = lept_hash_buckets(O_CAPACITY(v)) - 1;
+    size_t h = lept_hash_key(key, klen) & mask;
+    for (; slots[h]; h = (h + 1) & mask) {
+        const lept_member* m = &v->u.o.m[slots[h] - 1];
+        if (m->klen == klen && (m->k == key || memcmp(m->k, key, klen) == 0))
+            return slots[h] - 1;
     }
-    return ret;
+    return LEPT_KEY_NOT_EXIST;
 }
 
-static int lept_parse_object(lept_context* c, lept_value* v) {
-    size_t size, i;
-    lept_member m;
-    int ret;
-    EXPECT(c, '{');
-    lept_parse_whitespace(c);
-    if (*c->json == '}') {
-        c->json++;
+/* Move the members to owned storage for @capacity members, with a hash index if @hashed */
+static void lept_object_resize(lept_value* v, size_t capacity, int hashed) {
+    assert(capacity <= LEPT_SIZE_MAX);
+    if (capacity == 0) {
+        if (!(v->flags & LEPT_BORROWED_BUFFER))
+            lept_buffer_free(v->u.o.m);
+        v->u.o.m = NULL;
+        v->flags &= ~(LEPT_BORROWED_BUFFER | LEPT_HASH_INDEX);
+    }
+    else if (v->flags & LEPT_BORROWED_BUFFER) {
+        /* copy out of the arena on first growth, keys stay borrowed */
+        lept_member* m = (lept_member*)lept_buffer_alloc(NULL, lept_object_bytes(capacity, hashed));
+        if (O_SIZE(v) > 0)
+            memcpy(m, v->u.o.m, O_SIZE(v) * sizeof(lept_member));
+        v->u.o.m = m;
+        v->flags &= ~LEPT_BORROWED_BUFFER;
+    }
+    else
+        v->u.o.m = (lept_member*)lept_buffer_realloc(v->u.o.m, lept_object_bytes(capacity, hashed));
+    SET_O_CAPACITY(v, capacity);
+    if (hashed && capacity > 0) {
+        v->flags |= LEPT_HASH_INDEX;
+        lept_hash_rebuild(v);
+    }
+    else
+        v->flags &= ~LEPT_HASH_INDEX;
+}
+
+/* Like lept_set_array()/lept_set_object(), with storage from the context */
+static void lept_context_set_array(lept_context* c, lept_value* v, size_t size) {
+    if (c->arena) {
+        assert(size <= LEPT_SIZE_MAX);
+        v->type = LEPT_ARRAY;
+        v->flags = LEPT_BORROWED_BUFFER;
+        A_SIZE(v) = 0;
+        v->u.a.e = size > 0 ? (lept_value*)lept_buffer_alloc(c->arena, size * sizeof(lept_value)) : NULL;
+        SET_A_CAPACITY(v, size);
+    }
+    else
+        lept_set_array(v, size);
+}
+
+/* Filled with the @size members popped off the stack, hash index included when large enough */
+static void lept_context_set_object(lept_context* c, lept_value* v, size_t size) {
+    int hashed = size >= LEPT_OBJECT_HASH_THRESHOLD;
+    assert(size <= LEPT_SIZE_MAX);
+    if (c->arena) {
+        v->type = LEPT_OBJECT;
+        v->flags = LEPT_BORROWED_BUFFER | LEPT_BORROWED_KEYS;
+    }
+    else
         lept_set_object(v, 0);
+    v->u.o.m = size > 0 ? (lept_member*)lept_buffer_alloc(c->arena, lept_object_bytes(size, hashed)) : NULL;
+    if (c->insitu)
+        v->flags |= LEPT_BORROWED_KEYS;
+    if (c->keys)
+        v->flags |= LEPT_BORROWED_KEYS | LEPT_POOLED_KEYS;
+    O_SIZE(v) = size;
+    SET_O_CAPACITY(v, size);
+    if (size > 0)
+        memcpy(v->u.o.m, lept_context_pop(c, size * sizeof(lept_member)), size * sizeof(lept_member));
+    if (hashed) {
+        v->flags |= LEPT_HASH_INDEX;
+        lept_hash_rebuild(v);
+    }
+}
+
+/* Whether parsed member keys are heap copies that the parser has to free on error */
+#define OWNS_KEYS(c) (!(c)->arena && !(c)->insitu && !(c)->keys)
+
+/* Parse the member key at c->json into @m, with storage from the context */
+static int lept_parse_key(lept_context* c, lept_member* m) {
+    int ret;
+    char *s;
+    if (c->sax) {
+        if ((ret = lept_parse_string_raw(c, &s, &m->klen)) == LEPT_PARSE_OK)
+            ret = SAX_EVENT(c, key, (c->sax_ctx, s, m->klen));
+        return ret;
+    }
+    if (c->insitu)
+        return lept_parse_string_insitu(c, &m->k, &m->klen);
+    if ((ret = lept_parse_string_raw(c, &s, &m->klen)) != LEPT_PARSE_OK)
+        return ret;
+    if (c->keys) {
+        m->k = (char*)lept_key_pool_intern(c->keys, s, m->klen);
         return LEPT_PARSE_OK;
     }
-    m.k = NULL;
-    size = 0;
-    for (;;) {
-        char *s;
-        lept_init(&m.v);
-        if (*c->json != '\"') {
-            ret = LEPT_PARSE_MISS_KEY;
-            break;
+    memcpy(m->k = (char*)lept_context_alloc(c, m->klen + 1), s, m->klen);
+    m->k[m->klen] = '\0';
+    return LEPT_PARSE_OK;
+}
+
+/* Report the scalar just parsed into @v */
+static int lept_sax_scalar(lept_context* c, const lept_value* v) {
+    switch (v->type) {
+    case LEPT_NULL:   return SAX_EVENT(c, null, (c->sax_ctx));
+    case LEPT_FALSE:  return SAX_EVENT(c, boolean, (c->sax_ctx, 0));
+    case LEPT_TRUE:   return SAX_EVENT(c, boolean, (c->sax_ctx, 1));
+    default:          return SAX_EVENT(c, number, (c->sax_ctx, v));
+    }
+}
+
+/*
+ * Arrays and objects are parsed without recursion. Each open container has
+ * a frame on the context stack, below the elements or members collected for
+ * it so far; frames are chained through @prev, so nesting takes heap stack
+ * rather than C stack.
+ */
+typedef struct {
+    size_t base;   /* stack top before the frame was pushed */
+    size_t prev;   /* offset of the enclosing frame, LEPT_NO_FRAME at the root */
+    size_t size;   /* elements or members collected */
+    char* k;       /* object: key of the member whose value is being parsed */
+    size_t klen;
+    lept_type type;
+} lept_parse_frame;
+
+#define LEPT_NO_FRAME ((size_t)-1)
+#define FRAME(c, offset) ((lept_parse_frame*)((c)->stack + (offset)))
+
+/* Open the array or object at c->json on a new frame */
+static int lept_parse_open(lept_context* c, size_t* frame) {
+    lept_type type = *c->json++ == '[' ? LEPT_ARRAY : LEPT_OBJECT;
+    size_t base = c->top, offset = LEPT_ARENA_ROUND(base);
+    lept_parse_frame* f;
+    int ret;
+    if (c->sax && (ret = type == LEPT_ARRAY ?
+        SAX_EVENT(c, start_array, (c->sax_ctx)) : SAX_EVENT(c, start_object, (c->sax_ctx))) != LEPT_PARSE_OK)
+        return ret;
+    lept_context_push(c, offset - base + sizeof(lept_parse_frame)); /* frames stay aligned */
+    f = FRAME(c, offset);
+    f->base = base;
+    f->prev = *frame;
+    f->size = 0;
+    f->k = NULL;
+    f->type = type;
+    *frame = offset;
+    lept_parse_whitespace(c);
+    return LEPT_PARSE_OK;
+}
+
+/* The key of the next member of the object at @frame, up to and past its ':' */
+static int lept_parse_member_key(lept_context* c, size_t frame) {
+    lept_member m;
+    int ret;
+    if (PEEK(c) != '\"')
+        return LEPT_PARSE_MISS_KEY;
+    m.k = NULL;
+    if ((ret = lept_parse_key(c, &m)) != LEPT_PARSE_OK)
+        return ret;
+    FRAME(c, frame)->k = m.k;
+    FRAME(c, frame)->klen = m.klen;
+    lept_parse_whitespace(c);
+    if (PEEK(c) != ':')
+        return LEPT_PARSE_MISS_COLON;
+    c->json++;
+    lept_parse_whitespace(c);
+    return LEPT_PARSE_OK;
+}
+
+/* Add @e to the container at @frame */
+static void lept_parse_append(lept_context* c, size_t frame, const lept_value* e) {
+    lept_parse_frame* f = FRAME(c, frame);
+    if (!c->sax) {
+        if (f->type == LEPT_ARRAY)
+            memcpy(lept_context_push(c, sizeof(lept_value)), e, sizeof(lept_value));
+        else {
+            char* k = f->k;
+            size_t klen = f->klen;
+            lept_member* m = (lept_member*)lept_context_push(c, sizeof(lept_member));
+            m->k = k;
+            m->klen = klen;
+            memcpy(&m->v, e, sizeof(lept_value));
+        }
+        f = FRAME(c, frame); /* the stack may have moved */
+    }
+    f->size++;
+    f->k = NULL; /* ownership is transferred to member on stack */
+}
+
+/* Build the container of the top frame into @e and pop the frame */
+static int lept_parse_close(lept_context* c, size_t* frame, lept_value* e) {
+    lept_parse_frame* f = FRAME(c, *frame);
+    size_t size = f->size;
+    *frame = f->prev;
+    if (c->sax) {
+        c->top = f->base;
+        return f->type == LEPT_ARRAY ?
+            SAX_EVENT(c, end_array, (c->sax_ctx, size)) : SAX_EVENT(c, end_object, (c->sax_ctx, size));
+    }
+    if (f->type == LEPT_ARRAY) {
+        lept_context_set_array(c, e, size);
+        if (size > 0)
+            memcpy(e->u.a.e, lept_context_pop(c, size * sizeof(lept_value)), size * sizeof(lept_value));
+        A_SIZE(e) = size;
+    }
+    else
+        lept_context_set_object(c, e, size);
+    c->top = f->base;
+    return LEPT_PARSE_OK;
+}
+
+/* Pop every frame from @frame outwards, freeing what they collected */
+static void lept_parse_unwind(lept_context* c, size_t frame) {
+    while (frame != LEPT_NO_FRAME) {
+        lept_parse_frame* f = FRAME(c, frame);
+        size_t i, size = c->sax ? 0 : f->size;
+        for (i = 0; i < size && f->type == LEPT_ARRAY; i++)
+            lept_free((lept_value*)lept_context_pop(c, sizeof(lept_value)));
+        for (i = 0; i < size && f->type == LEPT_OBJECT; i++) {
+            lept_member* m = (lept_member*)lept_context_pop(c, sizeof(lept_member));
+            if (OWNS_KEYS(c))
+                FREE(m->k);
+            lept_free(&m->v);
+        }
+        if (OWNS_KEYS(c))
+            FREE(f->k);
+        c->top = f->base;
+        frame = f->prev;
+    }
+}
+
+static int lept_parse_value(lept_context* c, lept_value* v) {
+    size_t frame = LEPT_NO_FRAME, depth = 0;
+    lept_value e, *t;
+    int ret, next;
+    for (;;) {
+        /* a value starts at c->json; the root one is built in place */
+        t = frame == LEPT_NO_FRAME ? v : &e;
+        lept_init(t);
+        next = 0;
+        if (c->json == c->end)
+            ret = LEPT_PARSE_EXPECT_VALUE;
+        else if (*c->json == '[' || *c->json == '{') {
+            if (depth == c->max_depth)
+                ret = LEPT_PARSE_TOO_DEEP;
+            else if ((ret = lept_parse_open(c, &frame)) == LEPT_PARSE_OK) {
+                depth++;
+                if (PEEK(c) == (FRAME(c, frame)->type == LEPT_ARRAY ? ']' : '}')) {
+                    c->json++;
+                    ret = lept_parse_close(c, &frame, t);
+                    depth--;
+                }
+                else
+                    next = 1;
+            }
         }
-        if ((ret = lept_parse_string_raw(c, &s, &m.klen)) != LEPT_PARSE_OK)
-            break;
-        memcpy(m.k = (char*)malloc(m.klen +1), s, m.klen);
-        m.k[m.klen] = '\0';
-        lept_parse_whitespace(c);
-        if (*c->json == ':')
-            c->json++;
         else {
+            char ch = *c->json;
+            switch (ch) {
+            case 'n': ret = lept_parse_literal(c, t, "null", LEPT_NULL); break;
+            case 't': ret = lept_parse_literal(c, t, "true", LEPT_TRUE); break;
+            case 'f': ret = lept_parse_literal(c, t, "false", LEPT_FALSE); break;
+            case '"': ret = lept_parse_string(c, t); break; /* reports itself to SAX */
+            default:  ret = lept_parse_number(c, t); break;
+            }
+            if (c->sax && ret == LEPT_PARSE_OK && ch != '"')
+                ret = lept_sax_scalar(c, t);
+        }
+        /* the value is complete: hand it to its container, closing the containers it completes */
+        while (ret == LEPT_PARSE_OK && !next) {
+            lept_parse_frame* f;
+            if (frame == LEPT_NO_FRAME)
+                return LEPT_PARSE_OK;
+            lept_parse_append(c, frame, &e);
+            lept_parse_whitespace(c);
+            f = FRAME(c, frame);
+            if (PEEK(c) == ',') {
+                c->json++;
+                lept_parse_whitespace(c);
+                next = 1;
+            }
+            else if (PEEK(c) == (f->type == LEPT_ARRAY ? ']' : '}')) {
+                c->json++;
+                t = f->prev == LEPT_NO_FRAME ? v : &e;
+                lept_init(t);
+                ret = lept_parse_close(c, &frame, t);
+                depth--;
+            }
+            else
+                ret = f->type == LEPT_ARRAY ?
+                    LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET : LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+        }
+        /* in an object the next value comes after its key */
+        if (ret == LEPT_PARSE_OK && FRAME(c, frame)->type == LEPT_OBJECT)
+            ret = lept_parse_member_key(c, frame);
+        if (ret != LEPT_PARSE_OK)
+            break;
+    }
+    lept_parse_unwind(c, frame);
+    return ret;
+}
+
+/*
+ * Two-stage engine. Stage 1 classifies the input 64 bytes at a time and
+ * records the offset of every structural character, opening quote and
+ * scalar start outside strings. Stage 2 builds the tree by walking that
+ * index with the same sub-parsers as the recursive engine. Only valid input
+ * is handled here: on any error the recursive engine re-parses from the
+ * start so that the error code is exactly the one lept_parse() reports.
+ */
+
+/* Bit masks of whitespace, structural characters, quotes and backslashes in p[0..63] */
+static void lept_classify64(const char* p, uint64_t* ws, uint64_t* st, uint64_t* quote, uint64_t* bs) {
+    size_t i;
+#if defined(LEPT_AVX2)
+#define LEPT_EQ(x, ch) ((uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, _mm256_set1_epi8(ch))))
+    const __m256i lower = _mm256_set1_epi8(0x20); /* '[' | 0x20 == '{', ']' | 0x20 == '}' */
+    *ws = *st = *quote = *bs = 0;
+    for (i = 0; i < 64; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(p + i));
+        __m256i y = _mm256_or_si256(x, lower);
+        *ws |= (LEPT_EQ(x, ' ') | LEPT_EQ(x, '\t') | LEPT_EQ(x, '\n') | LEPT_EQ(x, '\r')) << i;
+        *st |= (LEPT_EQ(y, '{') | LEPT_EQ(y, '}') | LEPT_EQ(x, ':') | LEPT_EQ(x, ',')) << i;
+        *quote |= LEPT_EQ(x, '"') << i;
+        *bs |= LEPT_EQ(x, '\\') << i;
+    }
+#undef LEPT_EQ
+#elif defined(LEPT_SSE2)
+#define LEPT_EQ(x, ch) ((uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_set1_epi8(ch))))
+    const __m128i lower = _mm_set1_epi8(0x20); /* '[' | 0x20 == '{', ']' | 0x20 == '}' */
+    *ws = *st = *quote = *bs = 0;
+    for (i = 0; i < 64; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(p + i));
+        __m128i y = _mm_or_si128(x, lower);
+        *ws |= (LEPT_EQ(x, ' ') | LEPT_EQ(x, '\t') | LEPT_EQ(x, '\n') | LEPT_EQ(x, '\r')) << i;
+        *st |= (LEPT_EQ(y, '{') | LEPT_EQ(y, '}') | LEPT_EQ(x, ':') | LEPT_EQ(x, ',')) << i;
+        *quote |= LEPT_EQ(x, '"') << i;
+        *bs |= LEPT_EQ(x, '\\') << i;
+    }
+#undef LEPT_EQ
+#else
+    *ws = *st = *quote = *bs = 0;
+    for (i = 0; i < 64; i++) {
+        uint64_t bit = (uint64_t)1 << i;
+        switch (p[i]) {
+        case ' ': case '\t': case '\n': case '\r':
+            *ws |= bit; break;
+        case '{': case '}': case '[': case ']': case ':': case ',':
+            *st |= bit; break;
+        case '"':
+            *quote |= bit; break;
+        case '\\':
+            *bs |= bit; break;
+        }
+    }
+#endif
+}
+
+/* Bit i of the result is the parity of bits 0..i of @x */
+static uint64_t lept_prefix_xor(uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+/* Characters escaped by a backslash; @*carry tells whether the next block starts escaped */
+static uint64_t lept_find_escaped(uint64_t bs, uint64_t* carry) {
+    const uint64_t even_bits = ((uint64_t)0x55555555 << 32) | 0x55555555;
+    uint64_t follows_escape, odd_starts, sum;
+    bs &= ~*carry;
+    follows_escape = bs << 1 | *carry;
+    /* odd-length backslash runs starting on an odd bit end on an even bit, and vice versa */
+    odd_starts = bs & ~even_bits & ~follows_escape;
+    sum = odd_starts + bs;
+    *carry = sum < odd_starts;
+    return (even_bits ^ (sum << 1)) & follows_escape;
+}
+
+/* Stage 1: fill @index, return the entry count or (size_t)-1 for an unterminated string */
+static size_t lept_build_index(const char* json, size_t len, uint32_t* index) {
+    uint64_t escaped_carry = 0, in_string_carry = 0, sep_carry = 1;
+    size_t n = 0, i;
+    char pad[64];
+    for (i = 0; i < len; i += 64) {
+        const char* p = json + i;
+        uint64_t ws, st, quote, bs, in_string, sep, bits;
+        if (len - i < 64) {
+            memset(pad, ' ', sizeof(pad));
+            memcpy(pad, p, len - i);
+            p = pad;
+        }
+        lept_classify64(p, &ws, &st, &quote, &bs);
+        quote &= ~lept_find_escaped(bs, &escaped_carry);
+        in_string = lept_prefix_xor(quote) ^ in_string_carry; /* includes opening quotes */
+        in_string_carry = (uint64_t)0 - (in_string >> 63);
+        sep = ((ws | st) & ~in_string) | quote;
+        bits = (st & ~in_string) | (quote & in_string);
+        bits |= ~(sep | in_string) & (sep << 1 | sep_carry); /* scalar starts */
+        sep_carry = sep >> 63;
+        while (bits) {
+            index[n++] = (uint32_t)(i + lept_ctz64(bits));
+            bits &= bits - 1;
+        }
+    }
+    return in_string_carry ? (size_t)-1 : n;
+}
+
+/* Position of the next index entry, or the end of input */
+#define INDEX_NEXT(c) ((c)->index_pos < (c)->index_size ? (c)->base + (c)->index[(c)->index_pos] : (c)->end)
+#define INDEX_PEEK(c) ((c)->index_pos < (c)->index_size ? (c)->base[(c)->index[(c)->index_pos]] : '\0')
+
+static int lept_parse_indexed_value(lept_context* c, lept_value* v); /* Forward Declaration */
+
+static int lept_parse_indexed_array(lept_context* c, lept_value* v) {
+    size_t size = 0, i;
+    int ret;
+    if (INDEX_PEEK(c) == ']') {
+        c->index_pos++;
+        lept_context_set_array(c, v, 0);
+        return LEPT_PARSE_OK;
+    }
+    for (;;) {
+        lept_value e;
+        char ch;
+        lept_init(&e);
+        if ((ret = lept_parse_indexed_value(c, &e)) != LEPT_PARSE_OK)
+            break;
+        memcpy(lept_context_push(c, sizeof(lept_value)), &e, sizeof(lept_value));
+        size++;
+        ch = INDEX_PEEK(c);
+        c->index_pos++;
+        if (ch == ']') {
+            lept_context_set_array(c, v, size);
+            memcpy(v->u.a.e, lept_context_pop(c, size * sizeof(lept_value)), size * sizeof(lept_value));
+            A_SIZE(v) = size;
+            return LEPT_PARSE_OK;
+        }
+        if (ch != ',') {
+            ret = LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+            break;
+        }
+    }
+    for (i = 0; i < size; i++)
+        lept_free((lept_value*)lept_context_pop(c, sizeof(lept_value)));
+    return ret;
+}
+
+static int lept_parse_indexed_object(lept_context* c, lept_value* v) {
+    size_t size = 0, i;
+    lept_member m;
+    int ret;
+    if (INDEX_PEEK(c) == '}') {
+        c->index_pos++;
+        lept_context_set_object(c, v, 0);
+        return LEPT_PARSE_OK;
+    }
+    m.k = NULL;
+    for (;;) {
+        char ch;
+        lept_init(&m.v);
+        if (INDEX_PEEK(c) != '\"') {
+            ret = LEPT_PARSE_MISS_KEY;
+            break;
+        }
+        c->json = INDEX_NEXT(c);
+        c->index_pos++;
+        if ((ret = lept_parse_key(c, &m)) != LEPT_PARSE_OK)
+            break;
+        if (lept_skip_whitespace(c->json, c->end) != INDEX_NEXT(c) || INDEX_PEEK(c) != ':') {
             ret = LEPT_PARSE_MISS_COLON;
             break;
         }
-        lept_parse_whitespace(c);
-        /* parse value */
-        if ((ret = lept_parse_value(c, &m.v)) != LEPT_PARSE_OK)
+        c->index_pos++;
+        if ((ret = lept_parse_indexed_value(c, &m.v)) != LEPT_PARSE_OK)
             break;
         memcpy(lept_context_push(c, sizeof(lept_member)), &m, sizeof(lept_member));
         size++;
         m.k = NULL; /* ownership is transferred to member on stack */
-        lept_parse_whitespace(c);
-        if (*c->json == ',') {
-            c->json++;
-            lept_parse_whitespace(c);
-        }
-        else if (*c->json == '}') {
-            c->json++;
-            lept_set_object(v, size);
-            memcpy(v->u.o.m, lept_context_pop(c, size * sizeof(lept_member)), size * sizeof(lept_member));
-            v->u.o.size = size;
+        ch = INDEX_PEEK(c);
+        c->index_pos++;
+        if (ch == '}') {
+            lept_context_set_object(c, v, size);
             return LEPT_PARSE_OK;
         }
-        else {
+        if (ch != ',') {
             ret = LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
             break;
         }
     }
-    free(m.k);
+    if (OWNS_KEYS(c))
+        FREE(m.k);
     for (i = 0; i < size; i++) {
-        lept_member *m = (lept_member*)lept_context_pop(c, sizeof(lept_member));
-        free(m->k);
-        lept_free(&m->v);
+        lept_member *pm = (lept_member*)lept_context_pop(c, sizeof(lept_member));
+        if (OWNS_KEYS(c))
+            FREE(pm->k);
+        lept_free(&pm->v);
+    }
+    return ret;
+}
+
+static int lept_parse_indexed_value(lept_context* c, lept_value* v) {
+    int ret;
+    if (c->index_pos == c->index_size)
+        return LEPT_PARSE_EXPECT_VALUE;
+    c->json = INDEX_NEXT(c);
+    c->index_pos++;
+    switch (*c->json) {
+    case '[':
+    case '{':
+        /* deep documents are left to the non-recursive engine */
+        if (c->index_depth == LEPT_INDEXED_MAX_DEPTH || c->index_depth == c->max_depth)
+            return LEPT_PARSE_TOO_DEEP;
+        c->index_depth++;
+        ret = *c->json == '[' ? lept_parse_indexed_array(c, v) : lept_parse_indexed_object(c, v);
+        c->index_depth--;
+        return ret;
+    case ']': case '}': case ':': case ',': return LEPT_PARSE_INVALID_VALUE;
+    case 'n': ret = lept_parse_literal(c, v, "null", LEPT_NULL); break;
+    case 't': ret = lept_parse_literal(c, v, "true", LEPT_TRUE); break;
+    case 'f': ret = lept_parse_literal(c, v, "false", LEPT_FALSE); break;
+    case '"': ret = lept_parse_string(c, v); break;
+    default:  ret = lept_parse_number(c, v); break;
+    }
+    /* a scalar must extend up to the next indexed position */
+    if (ret == LEPT_PARSE_OK && lept_skip_whitespace(c->json, c->end) != INDEX_NEXT(c)) {
+        lept_free(v);
+        ret = LEPT_PARSE_INVALID_VALUE;
+    }
+    return ret;
+}
+
+static int lept_parse_context(lept_context* c, lept_value* v); /* Forward Declaration */
+
+static int lept_parse_indexed(lept_context* c, lept_value* v) {
+    size_t len = c->end - c->json;
+    uint32_t* index;
+    int ret = LEPT_PARSE_INVALID_VALUE;
+    if (len >= (uint32_t)-1 || c->insitu ||
+        !(index = (uint32_t*)lept_mem_alloc(c->allocator, (len + 1) * sizeof(uint32_t))))
+        return lept_parse_context(c, v);
+    c->base = c->json;
+    c->index_size = lept_build_index(c->json, len, index);
+    if (c->index_size != (size_t)-1) {
+        c->index = index;
+        c->index_pos = 0;
+        lept_init(v);
+        if ((ret = lept_parse_indexed_value(c, v)) == LEPT_PARSE_OK && c->index_pos != c->index_size) {
+            lept_free(v);
+            ret = LEPT_PARSE_ROOT_NOT_SINGULAR;
+        }
+        c->index = NULL;
+    }
+    lept_mem_free(c->allocator, index);
+    if (ret == LEPT_PARSE_OK) {
+        c->json = c->end;
+        return ret;
+    }
+    c->json = c->base;
+    return lept_parse_context(c, v);
+}
+
+static int lept_parse_context(lept_context* c, lept_value* v) {
+    int result;
+    lept_init(v);
+    lept_parse_whitespace(c);
+
+    if ((result = lept_parse_value(c, v)) == LEPT_PARSE_OK) {
+        lept_parse_whitespace(c);
+        if (c->json != c->end) {
+            lept_free(v);
+            return LEPT_PARSE_ROOT_NOT_SINGULAR;
+        }
+    }
+    return result;
+}
+
+int lept_parse(lept_value *v, const char *json) {
+    return lept_parse_with(v, json, NULL);
+}
+
+static void lept_context_init(lept_context* c, const char* json, size_t len, const lept_allocator* allocator) {
+    c->json = json;
+    c->end = json ? json + len : NULL;
+    c->stack = NULL;
+    c->size = c->top = 0;
+    c->allocator = allocator ? allocator : &lept_global_allocator;
+    c->arena = NULL;
+    c->insitu = 0;
+    c->keys = NULL;
+    c->max_depth = (size_t)-1;
+    c->base = json;
+    c->index = NULL;
+    c->index_size = c->index_pos = c->index_depth = 0;
+    c->sax = NULL;
+    c->sax_ctx = NULL;
+    c->write = NULL;
+    c->write_ctx = NULL;
+    c->write_failed = 0;
+}
+
+int lept_parse_with(lept_value *v, const char *json, const lept_allocator *allocator) {
+    lept_context c;
+    int result;
+    assert(v != NULL);
+    lept_context_init(&c, json, strlen(json), allocator);
+    result = lept_parse_context(&c, v);
+    assert(c.top == 0);
+    lept_mem_free(c.allocator, c.stack);
+    return result;
+}
+
+int lept_parse_n(lept_value *v, const char *json, size_t len, size_t *consumed) {
+    lept_context c;
+    int result;
+    assert(v != NULL && (json != NULL || len == 0));
+    lept_context_init(&c, json, len, NULL);
+    result = lept_parse_context(&c, v);
+    assert(c.top == 0);
+    lept_mem_free(c.allocator, c.stack);
+    if (consumed)
+        *consumed = c.json - json;
+    return result;
+}
+
+int lept_parse_sax(const char *json, size_t len, const lept_sax_handler *handler, void *ctx) {
+    lept_context c;
+    lept_value v;
+    int result;
+    assert(handler != NULL && (json != NULL || len == 0));
+    lept_context_init(&c, json, len, NULL);
+    c.sax = handler;
+    c.sax_ctx = ctx;
+    result = lept_parse_context(&c, &v); /* @v only ever holds a scalar */
+    assert(c.top == 0);
+    lept_mem_free(c.allocator, c.stack);
+    return result;
+}
+
+/*
+ * Push parser. The structure is tracked by an explicit state machine and a
+ * frame per open array/object, so input can stop anywhere. Elements of open
+ * containers wait on the context stack as they do in lept_parse_value(). A
+ * scalar token is parsed by the regular sub-parsers: straight from the chunk
+ * when it is complete there, otherwise after its pieces have been collected
+ * in the token buffer.
+ */
+
+enum {
+    LEPT_PUSH_VALUE,          /* a value must follow */
+    LEPT_PUSH_VALUE_OR_END,   /* after '[' */
+    LEPT_PUSH_KEY,            /* after ',' in an object */
+    LEPT_PUSH_KEY_OR_END,     /* after '{' */
+    LEPT_PUSH_COLON,
+    LEPT_PUSH_COMMA_OR_END,
+    LEPT_PUSH_DONE            /* the root value is complete */
+};
+
+typedef struct {
+    lept_type type;       /* LEPT_ARRAY or LEPT_OBJECT */
+    size_t size;          /* elements/members on the context stack */
+    char* k; size_t klen; /* key waiting for its value */
+} lept_push_frame;
+
+struct lept_push_parser {
+    lept_context c;
+    lept_push_frame* frames;
+    size_t depth, frames_capacity;
+    int state, error;
+    lept_value root;
+    char* token;         /* pieces of a token split across chunks */
+    size_t token_len, token_capacity;
+    char token_kind;     /* '"', 'l' (literal), '0' (number) or 0 for none */
+    int escape;          /* the token so far ends inside a string escape */
+};
+
+lept_push_parser* lept_push_parser_new(void) {
+    lept_push_parser* p = (lept_push_parser*)MALLOC(sizeof(lept_push_parser));
+    lept_context_init(&p->c, NULL, 0, NULL);
+    p->frames = NULL;
+    p->depth = p->frames_capacity = 0;
+    p->state = LEPT_PUSH_VALUE;
+    p->error = LEPT_PARSE_OK;
+    lept_init(&p->root);
+    p->token = NULL;
+    p->token_len = p->token_capacity = 0;
+    p->token_kind = 0;
+    p->escape = 0;
+    return p;
+}
+
+/* Drop everything parsed so far and get ready for the next document */
+static void lept_push_reset(lept_push_parser* p) {
+    size_t i;
+    while (p->depth > 0) {
+        lept_push_frame* f = &p->frames[--p->depth];
+        for (i = 0; i < f->size; i++) {
+            if (f->type == LEPT_ARRAY)
+                lept_free((lept_value*)lept_context_pop(&p->c, sizeof(lept_value)));
+            else {
+                lept_member* m = (lept_member*)lept_context_pop(&p->c, sizeof(lept_member));
+                FREE(m->k);
+                lept_free(&m->v);
+            }
+        }
+        FREE(f->k);
+    }
+    assert(p->c.top == 0);
+    lept_free(&p->root);
+    p->state = LEPT_PUSH_VALUE;
+    p->error = LEPT_PARSE_OK;
+    p->token_len = 0;
+    p->token_kind = 0;
+    p->escape = 0;
+}
+
+void lept_push_parser_free(lept_push_parser* p) {
+    if (p) {
+        lept_push_reset(p);
+        lept_mem_free(p->c.allocator, p->c.stack);
+        lept_mem_free(p->c.allocator, p->frames);
+        lept_mem_free(p->c.allocator, p->token);
+        FREE(p);
+    }
+}
+
+/* The error for an unexpected character (or the end of input) in the current state */
+static int lept_push_unexpected(const lept_push_parser* p) {
+    switch (p->state) {
+    case LEPT_PUSH_VALUE:
+    case LEPT_PUSH_VALUE_OR_END: return LEPT_PARSE_EXPECT_VALUE;
+    case LEPT_PUSH_KEY:
+    case LEPT_PUSH_KEY_OR_END:   return LEPT_PARSE_MISS_KEY;
+    case LEPT_PUSH_COLON:        return LEPT_PARSE_MISS_COLON;
+    case LEPT_PUSH_COMMA_OR_END:
+        return p->frames[p->depth - 1].type == LEPT_ARRAY ?
+            LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET : LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+    default:                     return LEPT_PARSE_ROOT_NOT_SINGULAR;
+    }
+}
+
+/* Hand a complete value to the innermost open container, or make it the root */
+static void lept_push_value(lept_push_parser* p, lept_value* v) {
+    lept_push_frame* f;
+    if (p->depth == 0) {
+        p->root = *v;
+        p->state = LEPT_PUSH_DONE;
+        return;
+    }
+    f = &p->frames[p->depth - 1];
+    if (f->type == LEPT_ARRAY)
+        memcpy(lept_context_push(&p->c, sizeof(lept_value)), v, sizeof(lept_value));
+    else {
+        lept_member* m = (lept_member*)lept_context_push(&p->c, sizeof(lept_member));
+        m->k = f->k;
+        m->klen = f->klen;
+        m->v = *v;
+        f->k = NULL;
+    }
+    f->size++;
+    p->state = LEPT_PUSH_COMMA_OR_END;
+}
+
+static void lept_push_open(lept_push_parser* p, lept_type type) {
+    lept_push_frame* f;
+    if (p->depth == p->frames_capacity) {
+        p->frames_capacity = p->frames_capacity ? p->frames_capacity * 2 : 16;
+        p->frames = (lept_push_frame*)lept_mem_realloc(p->c.allocator, p->frames, p->frames_capacity * sizeof(lept_push_frame));
+    }
+    f = &p->frames[p->depth++];
+    f->type = type;
+    f->size = 0;
+    f->k = NULL;
+    p->state = type == LEPT_ARRAY ? LEPT_PUSH_VALUE_OR_END : LEPT_PUSH_KEY_OR_END;
+}
+
+static void lept_push_close(lept_push_parser* p) {
+    lept_push_frame* f = &p->frames[--p->depth];
+    lept_value v;
+    lept_init(&v);
+    if (f->type == LEPT_ARRAY) {
+        lept_context_set_array(&p->c, &v, f->size);
+        if (f->size)
+            memcpy(v.u.a.e, lept_context_pop(&p->c, f->size * sizeof(lept_value)), f->size * sizeof(lept_value));
+        A_SIZE(&v) = f->size;
+    }
+    else {
+        lept_context_set_object(&p->c, &v, f->size);
+    }
+    lept_push_value(p, &v);
+}
+
+/* Where the token of @kind that continues at @s ends, or NULL if it may go on past @end */
+static const char* lept_push_token_end(lept_push_parser* p, char kind, const char* s, const char* end) {
+    if (kind == '"') {
+        while (s < end) {
+            if (p->escape) {
+                p->escape = 0;
+                s++;
+                continue;
+            }
+            if ((s = lept_scan_string(s, end)) == end)
+                break;
+            if (*s == '"')
+                return s + 1;
+            p->escape = *s++ == '\\';
+        }
+        return NULL;
+    }
+    if (kind == 'l')
+        while (s < end && *s >= 'a' && *s <= 'z')
+            s++;
+    else
+        while (s < end && (ISDIGIT(*s) || *s == '-' || *s == '+' || *s == '.' || *s == 'e' || *s == 'E'))
+            s++;
+    return s < end ? s : NULL;
+}
+
+/* Parse the complete token [s, s + len) with the regular sub-parsers */
+static int lept_push_token(lept_push_parser* p, const char* s, size_t len) {
+    lept_value v;
+    lept_member m;
+    int ret;
+    p->c.json = s;
+    p->c.end = s + len;
+    if (p->state == LEPT_PUSH_KEY || p->state == LEPT_PUSH_KEY_OR_END) {
+        if ((ret = lept_parse_key(&p->c, &m)) != LEPT_PARSE_OK)
+            return ret;
+        p->frames[p->depth - 1].k = m.k;
+        p->frames[p->depth - 1].klen = m.klen;
+        p->state = LEPT_PUSH_COLON;
+        return LEPT_PARSE_OK;
+    }
+    lept_init(&v);
+    switch (len ? *s : '\0') {
+    case 'n': ret = lept_parse_literal(&p->c, &v, "null", LEPT_NULL); break;
+    case 't': ret = lept_parse_literal(&p->c, &v, "true", LEPT_TRUE); break;
+    case 'f': ret = lept_parse_literal(&p->c, &v, "false", LEPT_FALSE); break;
+    case '"': ret = lept_parse_string(&p->c, &v); break;
+    default:  ret = lept_parse_number(&p->c, &v); break;
+    }
+    if (ret != LEPT_PARSE_OK)
+        return ret;
+    lept_push_value(p, &v);
+    /* a valid prefix such as the 0 of "0123": what follows cannot continue the structure */
+    return p->c.json == p->c.end ? LEPT_PARSE_OK : lept_push_unexpected(p);
+}
+
+static void lept_push_buffer(lept_push_parser* p, const char* s, size_t len) {
+    if (p->token_len + len > p->token_capacity) {
+        while (p->token_len + len > p->token_capacity)
+            p->token_capacity = p->token_capacity ? p->token_capacity + (p->token_capacity >> 1) : 64;
+        p->token = (char*)lept_mem_realloc(p->c.allocator, p->token, p->token_capacity);
+    }
+    memcpy(p->token + p->token_len, s, len);
+    p->token_len += len;
+}
+
+#define PUSH_ERROR(p, ret) do { (p)->error = (ret); return (ret); } while(0)
+
+int lept_push_parser_feed(lept_push_parser* p, const char* json, size_t len) {
+    const char *s = json, *end = json + len, *e;
+    char kind;
+    int ret;
+    assert(p != NULL && (json != NULL || len == 0));
+    if (p->error != LEPT_PARSE_OK)
+        return p->error;
+    if (p->token_kind) {
+        e = lept_push_token_end(p, p->token_kind, s, end);
+        lept_push_buffer(p, s, (e ? e : end) - s);
+        if (!e)
+            return LEPT_PARSE_OK;
+        s = e;
+        p->token_kind = 0;
+        if ((ret = lept_push_token(p, p->token, p->token_len)) != LEPT_PARSE_OK)
+            PUSH_ERROR(p, ret);
+        p->token_len = 0;
+    }
+    while ((s = lept_skip_whitespace(s, end)) < end) {
+        switch (p->state) {
+        case LEPT_PUSH_COLON:
+            if (*s != ':')
+                PUSH_ERROR(p, LEPT_PARSE_MISS_COLON);
+            s++;
+            p->state = LEPT_PUSH_VALUE;
+            continue;
+        case LEPT_PUSH_COMMA_OR_END:
+            if (*s == ',') {
+                s++;
+                p->state = p->frames[p->depth - 1].type == LEPT_ARRAY ? LEPT_PUSH_VALUE : LEPT_PUSH_KEY;
+            }
+            else if (*s == (p->frames[p->depth - 1].type == LEPT_ARRAY ? ']' : '}')) {
+                s++;
+                lept_push_close(p);
+            }
+            else
+                PUSH_ERROR(p, lept_push_unexpected(p));
+            continue;
+        case LEPT_PUSH_DONE:
+            PUSH_ERROR(p, LEPT_PARSE_ROOT_NOT_SINGULAR);
+        case LEPT_PUSH_KEY_OR_END:
+            if (*s == '}') {
+                s++;
+                lept_push_close(p);
+                continue;
+            }
+            /* Fall through */
+        case LEPT_PUSH_KEY:
+            if (*s != '"')
+                PUSH_ERROR(p, LEPT_PARSE_MISS_KEY);
+            kind = '"';
+            break;
+        case LEPT_PUSH_VALUE_OR_END:
+            if (*s == ']') {
+                s++;
+                lept_push_close(p);
+                continue;
+            }
+            /* Fall through */
+        default:
+            if (*s == '[' || *s == '{') {
+                lept_push_open(p, *s++ == '[' ? LEPT_ARRAY : LEPT_OBJECT);
+                continue;
+            }
+            kind = *s == '"' ? '"' : (*s == 'n' || *s == 't' || *s == 'f') ? 'l' : '0';
+            break;
+        }
+        /* a scalar token starts at s */
+        p->escape = 0;
+        if (!(e = lept_push_token_end(p, kind, kind == '"' ? s + 1 : s, end))) {
+            p->token_kind = kind;
+            lept_push_buffer(p, s, end - s);
+            return LEPT_PARSE_OK;
+        }
+        if ((ret = lept_push_token(p, s, e - s)) != LEPT_PARSE_OK)
+            PUSH_ERROR(p, ret);
+        s = e;
+    }
+    return LEPT_PARSE_OK;
+}
+
+int lept_push_parser_finish(lept_push_parser* p, lept_value* v) {
+    int ret = p->error;
+    assert(p != NULL && v != NULL);
+    if (ret == LEPT_PARSE_OK && p->token_kind) {
+        p->token_kind = 0;
+        ret = lept_push_token(p, p->token, p->token_len);
+    }
+    if (ret == LEPT_PARSE_OK && p->state != LEPT_PUSH_DONE)
+        ret = lept_push_unexpected(p);
+    lept_init(v);
+    if (ret == LEPT_PARSE_OK) {
+        *v = p->root;
+        lept_init(&p->root);
+    }
+    lept_push_reset(p);
+    return ret;
+}
+
+/*
+ * Pull cursor. Every call works on a short-lived context over the rest of the
+ * input that shares the cursor's scratch stack, so tokens are validated by the
+ * regular sub-parsers and skipped values go through the event mode with no
+ * handler: nothing is allocated for what the caller does not ask for.
+ */
+
+static const lept_sax_handler lept_sax_skip = { NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL };
+
+static void lept_cursor_context(lept_cursor* cur, lept_context* c) {
+    lept_context_init(c, cur->json, cur->end - cur->json, NULL);
+    c->stack = cur->stack;
+    c->size = cur->size;
+    lept_parse_whitespace(c);
+}
+
+static int lept_cursor_done(lept_cursor* cur, lept_context* c, int ret) {
+    assert(c->top == 0);
+    cur->json = c->json;
+    cur->stack = c->stack;
+    cur->size = c->size;
+    return ret;
+}
+
+void lept_cursor_init(lept_cursor *cur, const char *json, size_t len) {
+    assert(cur != NULL && (json != NULL || len == 0));
+    cur->json = json;
+    cur->end = json ? json + len : NULL;
+    cur->stack = NULL;
+    cur->size = 0;
+    cur->first = 0;
+    cur->pending = 1; /* the root value */
+}
+
+void lept_cursor_free(lept_cursor *cur) {
+    assert(cur != NULL);
+    lept_mem_free(&lept_global_allocator, cur->stack);
+    cur->stack = NULL;
+    cur->size = 0;
+}
+
+int lept_cursor_peek(lept_cursor *cur, lept_type *type) {
+    lept_context c;
+    int ret = LEPT_PARSE_OK;
+    assert(cur != NULL && type != NULL);
+    lept_cursor_context(cur, &c);
+    switch (PEEK(&c)) {
+    case 'n': *type = LEPT_NULL; break;
+    case 't': *type = LEPT_TRUE; break;
+    case 'f': *type = LEPT_FALSE; break;
+    case '"': *type = LEPT_STRING; break;
+    case '[': *type = LEPT_ARRAY; break;
+    case '{': *type = LEPT_OBJECT; break;
+    case '\0': ret = c.json == c.end ? LEPT_PARSE_EXPECT_VALUE : LEPT_PARSE_INVALID_VALUE; break;
+    default:
+        if (*c.json == '-' || ISDIGIT(*c.json))
+            *type = LEPT_NUMBER;
+        else
+            ret = LEPT_PARSE_INVALID_VALUE;
+    }
+    return lept_cursor_done(cur, &c, ret);
+}
+
+int lept_cursor_skip(lept_cursor *cur) {
+    lept_context c;
+    lept_value v;
+    assert(cur != NULL);
+    lept_cursor_context(cur, &c);
+    c.sax = &lept_sax_skip;
+    cur->pending = 0;
+    return lept_cursor_done(cur, &c, lept_parse_value(&c, &v));
+}
+
+int lept_cursor_get_value(lept_cursor *cur, lept_value *v) {
+    lept_context c;
+    int ret;
+    assert(cur != NULL && v != NULL);
+    lept_cursor_context(cur, &c);
+    lept_init(v);
+    cur->pending = 0;
+    ret = lept_parse_value(&c, v);
+    return lept_cursor_done(cur, &c, ret);
+}
+
+int lept_cursor_get_number(lept_cursor *cur, double *n) {
+    lept_context c;
+    lept_value v;
+    int ret;
+    assert(cur != NULL && n != NULL);
+    lept_cursor_context(cur, &c);
+    if (PEEK(&c) != '-' && !ISDIGIT(PEEK(&c)))
+        return lept_cursor_done(cur, &c, LEPT_PARSE_WRONG_TYPE);
+    cur->pending = 0;
+    if ((ret = lept_parse_number(&c, &v)) == LEPT_PARSE_OK)
+        *n = lept_get_number(&v);
+    return lept_cursor_done(cur, &c, ret);
+}
+
+int lept_cursor_get_string(lept_cursor *cur, const char **s, size_t *len) {
+    lept_context c;
+    char* str;
+    int ret;
+    assert(cur != NULL && s != NULL && len != NULL);
+    lept_cursor_context(cur, &c);
+    if (PEEK(&c) != '"')
+        return lept_cursor_done(cur, &c, LEPT_PARSE_WRONG_TYPE);
+    cur->pending = 0;
+    if ((ret = lept_parse_string_raw(&c, &str, len)) == LEPT_PARSE_OK)
+        *s = str; /* the popped scratch stays intact until the next call */
+    return lept_cursor_done(cur, &c, ret);
+}
+
+static int lept_cursor_enter(lept_cursor* cur, char ch) {
+    lept_context c;
+    lept_cursor_context(cur, &c);
+    if (PEEK(&c) != ch)
+        return lept_cursor_done(cur, &c, LEPT_PARSE_WRONG_TYPE);
+    c.json++;
+    cur->first = 1;
+    cur->pending = 0;
+    return lept_cursor_done(cur, &c, LEPT_PARSE_OK);
+}
+
+int lept_cursor_enter_array(lept_cursor *cur) {
+    assert(cur != NULL);
+    return lept_cursor_enter(cur, '[');
+}
+
+int lept_cursor_enter_object(lept_cursor *cur) {
+    assert(cur != NULL);
+    return lept_cursor_enter(cur, '{');
+}
+
+/* Step over an unread value and the separator; 0 in *more if @close ended the container */
+static int lept_cursor_next(lept_cursor* cur, lept_context* c, char close, int error, int* more) {
+    lept_value v;
+    int ret;
+    lept_cursor_context(cur, c);
+    if (cur->pending) {
+        c->sax = &lept_sax_skip;
+        if ((ret = lept_parse_value(c, &v)) != LEPT_PARSE_OK)
+            return ret;
+        c->sax = NULL;
+        lept_parse_whitespace(c);
+    }
+    *more = 1;
+    if (PEEK(c) == close) {
+        c->json++;
+        *more = 0;
+    }
+    else if (!cur->first) {
+        if (PEEK(c) != ',')
+            return error;
+        c->json++;
+        lept_parse_whitespace(c);
+    }
+    cur->first = 0;
+    cur->pending = *more;
+    return LEPT_PARSE_OK;
+}
+
+int lept_cursor_next_element(lept_cursor *cur, int *more) {
+    lept_context c;
+    assert(cur != NULL && more != NULL);
+    return lept_cursor_done(cur, &c, lept_cursor_next(cur, &c, ']', LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, more));
+}
+
+int lept_cursor_next_member(lept_cursor *cur, const char **key, size_t *klen) {
+    lept_context c;
+    char* k;
+    int ret, more;
+    assert(cur != NULL && key != NULL && klen != NULL);
+    *key = NULL;
+    if ((ret = lept_cursor_next(cur, &c, '}', LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET, &more)) != LEPT_PARSE_OK || !more)
+        return lept_cursor_done(cur, &c, ret);
+    if (PEEK(&c) != '"')
+        return lept_cursor_done(cur, &c, LEPT_PARSE_MISS_KEY);
+    if ((ret = lept_parse_string_raw(&c, &k, klen)) != LEPT_PARSE_OK)
+        return lept_cursor_done(cur, &c, ret);
+    lept_parse_whitespace(&c);
+    if (PEEK(&c) != ':')
+        return lept_cursor_done(cur, &c, LEPT_PARSE_MISS_COLON);
+    c.json++;
+    *key = k;
+    return lept_cursor_done(cur, &c, LEPT_PARSE_OK);
+}
+
+int lept_cursor_find_key(lept_cursor *cur, const char *key, size_t klen, int *found) {
+    const char* k;
+    size_t len;
+    int ret;
+    assert(cur != NULL && key != NULL && found != NULL);
+    for (;;) {
+        if ((ret = lept_cursor_next_member(cur, &k, &len)) != LEPT_PARSE_OK || !k) {
+            *found = 0;
+            return ret;
+        }
+        if (len == klen && memcmp(k, key, klen) == 0) {
+            *found = 1;
+            return LEPT_PARSE_OK;
+        }
+    }
+}
+
+int lept_cursor_leave_array(lept_cursor *cur) {
+    int ret, more = 1;
+    assert(cur != NULL);
+    while (more)
+        if ((ret = lept_cursor_next_element(cur, &more)) != LEPT_PARSE_OK)
+            return ret;
+    return LEPT_PARSE_OK;
+}
+
+int lept_cursor_leave_object(lept_cursor *cur) {
+    const char* k = "";
+    size_t len;
+    int ret;
+    assert(cur != NULL);
+    while (k)
+        if ((ret = lept_cursor_next_member(cur, &k, &len)) != LEPT_PARSE_OK)
+            return ret;
+    return LEPT_PARSE_OK;
+}
+
+int lept_cursor_finish(lept_cursor *cur) {
+    lept_context c;
+    int ret;
+    assert(cur != NULL);
+    if (cur->pending && (ret = lept_cursor_skip(cur)) != LEPT_PARSE_OK)
+        return ret;
+    lept_cursor_context(cur, &c);
+    return lept_cursor_done(cur, &c, c.json == c.end ? LEPT_PARSE_OK : LEPT_PARSE_ROOT_NOT_SINGULAR);
+}
+
+void lept_parse_options_init(lept_parse_options *options) {
+    assert(options != NULL);
+    options->engine = LEPT_ENGINE_RECURSIVE;
+    options->keys = NULL;
+    options->threads = 1;
+    options->max_depth = 0;
+}
+
+static int lept_parse_array_parallel(lept_value* v, const char* json, size_t len, size_t threads, size_t max_depth); /* Forward Declaration */
+
+/* Parse the input of @c with @options, NULL for the defaults */
+static int lept_parse_options_context(lept_context* c, lept_value* v, const lept_parse_options* options) {
+    if (options) {
+        c->keys = options->keys;
+        c->max_depth = options->max_depth ? options->max_depth : (size_t)-1;
+    }
+    if (options && options->threads != 1 && !options->keys &&
+        lept_parse_array_parallel(v, c->json, c->end - c->json, options->threads, c->max_depth))
+        return LEPT_PARSE_OK;
+    if (options && options->engine == LEPT_ENGINE_INDEXED)
+        return lept_parse_indexed(c, v);
+    return lept_parse_context(c, v);
+}
+
+int lept_parse_ex(lept_value *v, const char *json, size_t len, const lept_parse_options *options) {
+    lept_context c;
+    int result;
+    assert(v != NULL && (json != NULL || len == 0));
+    lept_context_init(&c, json, len, NULL);
+    result = lept_parse_options_context(&c, v, options);
+    assert(c.top == 0);
+    lept_mem_free(c.allocator, c.stack);
+    return result;
+}
+
+/*
+ * File parsing. A regular file is mapped and parsed where it lies; the
+ * parse reads exactly the file's size, so a file that fills its last page
+ * needs no terminator past it. Whatever cannot be mapped (pipes, files that
+ * report no size) is read into a heap buffer instead.
+ */
+#define LEPT_READ_CHUNK 65536
+
+#if defined(LEPT_HAVE_FD)
+typedef int lept_file;
+#else
+typedef FILE* lept_file;
+#endif
+
+/* Up to @size bytes from @f: 0 at the end of the file, (size_t)-1 on an error */
+static size_t lept_file_read(lept_file f, char* buf, size_t size) {
+#if defined(LEPT_HAVE_FD)
+    ssize_t n;
+    while ((n = read(f, buf, size)) < 0 && errno == EINTR)
+        ;
+    return n < 0 ? (size_t)-1 : (size_t)n;
+#else
+    size_t n = fread(buf, 1, size, f);
+    return n == 0 && ferror(f) ? (size_t)-1 : n;
+#endif
+}
+
+/* The rest of @f in a heap buffer of *@len bytes, NULL on a read error */
+static char* lept_file_read_all(lept_file f, size_t* len) {
+    char* buf = NULL;
+    size_t size = 0, capacity = 0, n;
+    do {
+        if (size == capacity)
+            buf = (char*)REALLOC(buf, capacity = capacity ? capacity + (capacity >> 1) : LEPT_READ_CHUNK);
+        if ((n = lept_file_read(f, buf + size, capacity - size)) == (size_t)-1) {
+            FREE(buf);
+            return NULL;
+        }
+        size += n;
+    } while (n > 0);
+    *len = size;
+    return buf;
+}
+
+int lept_parse_file(lept_value *v, const char *path, const lept_parse_options *options) {
+    lept_file f;
+    char* json;
+    size_t len;
+    int result;
+#if defined(LEPT_HAVE_FD)
+    struct stat st;
+    void* map;
+#endif
+    assert(v != NULL && path != NULL);
+    lept_init(v);
+#if defined(LEPT_HAVE_FD)
+    if ((f = open(path, O_RDONLY)) < 0)
+        return LEPT_PARSE_FILE_ERROR;
+    if (fstat(f, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 && (off_t)(size_t)st.st_size == st.st_size) {
+        len = (size_t)st.st_size;
+#if defined(POSIX_FADV_SEQUENTIAL)
+        posix_fadvise(f, 0, 0, POSIX_FADV_SEQUENTIAL); /* read ahead aggressively */
+#endif
+        if ((map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, f, 0)) != MAP_FAILED) {
+#if defined(POSIX_MADV_SEQUENTIAL)
+            posix_madvise(map, len, POSIX_MADV_SEQUENTIAL);
+#endif
+            result = lept_parse_ex(v, (const char*)map, len, options);
+            munmap(map, len);
+            close(f);
+            return result;
+        }
+    }
+    json = lept_file_read_all(f, &len);
+    close(f);
+#else
+    if ((f = fopen(path, "rb")) == NULL)
+        return LEPT_PARSE_FILE_ERROR;
+    json = lept_file_read_all(f, &len);
+    fclose(f);
+#endif
+    if (json == NULL)
+        return LEPT_PARSE_FILE_ERROR;
+    result = lept_parse_ex(v, json, len, options);
+    FREE(json);
+    return result;
+}
+
+int lept_parse_arena(lept_arena *a, lept_value *v, const char *json) {
+    lept_context c;
+    int result;
+    assert(a != NULL && v != NULL);
+    lept_context_init(&c, json, strlen(json), NULL);
+    c.arena = a;
+    result = lept_parse_context(&c, v);
+    assert(c.top == 0);
+    lept_mem_free(c.allocator, c.stack);
+    return result;
+}
+
+int lept_parse_insitu(lept_value *v, char *json) {
+    lept_context c;
+    int result;
+    assert(v != NULL);
+    lept_context_init(&c, json, strlen(json), NULL);
+    c.insitu = 1;
+    result = lept_parse_context(&c, v);
+    assert(c.top == 0);
+    lept_mem_free(c.allocator, c.stack);
+    return result;
+}
+
+struct lept_parser {
+    lept_parse_options options;
+    char* stack; /* scratch stack, kept from one parse to the next */
+    size_t size, stack_limit;
+};
+
+lept_parser* lept_parser_new(const lept_parse_options *options, size_t stack_limit) {
+    lept_parser* p = (lept_parser*)MALLOC(sizeof(lept_parser));
+    if (options)
+        p->options = *options;
+    else
+        lept_parse_options_init(&p->options);
+    p->stack = NULL;
+    p->size = 0;
+    p->stack_limit = stack_limit ? stack_limit : LEPT_PARSER_STACK_LIMIT;
+    return p;
+}
+
+lept_parse_options* lept_parser_options(lept_parser *p) {
+    assert(p != NULL);
+    return &p->options;
+}
+
+size_t lept_parser_stack_size(const lept_parser *p) {
+    assert(p != NULL);
+    return p->size;
+}
+
+int lept_parser_parse(lept_parser *p, lept_value *v, const char *json, size_t len) {
+    lept_context c;
+    int result;
+    assert(p != NULL && v != NULL && (json != NULL || len == 0));
+    lept_context_init(&c, json, len, NULL);
+    c.stack = p->stack;
+    c.size = p->size;
+    result = lept_parse_options_context(&c, v, &p->options);
+    assert(c.top == 0);
+    if (c.size > p->stack_limit) {
+        /* one outsized document does not pin its stack for good */
+        c.stack = (char*)REALLOC(c.stack, p->stack_limit);
+        c.size = p->stack_limit;
+    }
+    p->stack = c.stack;
+    p->size = c.size;
+    return result;
+}
+
+void lept_parser_free(lept_parser *p) {
+    if (p) {
+        lept_mem_free(&lept_global_allocator, p->stack);
+        FREE(p);
+    }
+}
+
+/*
+ * Parallel jobs: @count tasks handed out in order to the calling thread and
+ * up to @threads - 1 helpers. Tasks are coarse (a block of lines, a slice of
+ * an array), so one lock around the counter is all the coordination needed.
+ */
+typedef struct {
+    void (*run)(void* ctx, size_t task);
+    void* ctx;
+    size_t next, count;
+#if defined(LEPT_HAVE_THREADS)
+    pthread_mutex_t lock;
+#endif
+} lept_job;
+
+static void* lept_job_work(void* arg) {
+    lept_job* job = (lept_job*)arg;
+    for (;;) {
+        size_t task;
+#if defined(LEPT_HAVE_THREADS)
+        pthread_mutex_lock(&job->lock);
+#endif
+        task = job->next < job->count ? job->next++ : job->count;
+#if defined(LEPT_HAVE_THREADS)
+        pthread_mutex_unlock(&job->lock);
+#endif
+        if (task == job->count)
+            return NULL;
+        job->run(job->ctx, task);
+    }
+}
+
+/* Threads to use when the caller asks for 0 */
+static size_t lept_default_threads(void) {
+#if defined(LEPT_HAVE_THREADS) && defined(_SC_NPROCESSORS_ONLN)
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (size_t)n : 1;
+#else
+    return 1;
+#endif
+}
+
+static void lept_run_parallel(size_t threads, size_t count, void (*run)(void*, size_t), void* ctx) {
+    lept_job job;
+    job.run = run;
+    job.ctx = ctx;
+    job.next = 0;
+    job.count = count;
+    if (threads == 0)
+        threads = lept_default_threads();
+    if (threads > count)
+        threads = count;
+#if defined(LEPT_HAVE_THREADS)
+    pthread_mutex_init(&job.lock, NULL);
+    if (threads > 1) {
+        pthread_t* helpers = (pthread_t*)MALLOC((threads - 1) * sizeof(pthread_t));
+        size_t i, started;
+        for (started = 0; started < threads - 1; started++)
+            if (pthread_create(&helpers[started], NULL, lept_job_work, &job) != 0)
+                break; /* whatever is left runs on fewer threads */
+        lept_job_work(&job);
+        for (i = 0; i < started; i++)
+            pthread_join(helpers[i], NULL);
+        FREE(helpers);
+    }
+    else
+        lept_job_work(&job);
+    pthread_mutex_destroy(&job.lock);
+#else
+    lept_job_work(&job);
+#endif
+}
+
+#define LEPT_NDJSON_BLOCK 256 /* lines per task */
+
+typedef struct {
+    const char* json;
+    const size_t* ends; /* where each record's line ends */
+    lept_record* records;
+    size_t count;
+    const lept_parse_options* options; /* for every record, NULL for the defaults */
+} lept_ndjson;
+
+static void lept_ndjson_block(void* ctx, size_t task) {
+    lept_ndjson* batch = (lept_ndjson*)ctx;
+    size_t i, last = (task + 1) * LEPT_NDJSON_BLOCK;
+    for (i = task * LEPT_NDJSON_BLOCK; i < last && i < batch->count; i++) {
+        lept_record* r = &batch->records[i];
+        lept_init(&r->v);
+        r->result = lept_parse_ex(&r->v, batch->json + r->offset, batch->ends[i] - r->offset, batch->options);
+    }
+}
+
+size_t lept_parse_ndjson(const char *json, size_t len, size_t threads, lept_record **records) {
+    return lept_parse_ndjson_ex(json, len, threads, NULL, records);
+}
+
+size_t lept_parse_ndjson_ex(const char *json, size_t len, size_t threads, const lept_parse_options *options,
+                            lept_record **records) {
+    lept_ndjson batch;
+    lept_parse_options record_options;
+    size_t capacity = 0, pos = 0;
+    size_t* ends = NULL;
+    assert((json != NULL || len == 0) && records != NULL);
+    batch.json = json;
+    batch.records = NULL;
+    batch.count = 0;
+    batch.options = NULL;
+    if (options) {
+        /* the records are what runs side by side, each one on a single thread */
+        record_options = *options;
+        record_options.threads = 1;
+        batch.options = &record_options;
+        if (options->keys)
+            threads = 1; /* the pool is not thread-safe */
+    }
+    /* record boundaries first, so that the lines can be handed out in blocks */
+    while (pos < len) {
+        const char* nl = (const char*)memchr(json + pos, '\n', len - pos);
+        size_t end = nl ? (size_t)(nl - json) : len;
+        if (lept_skip_whitespace(json + pos, json + end) != json + end) {
+            if (batch.count == capacity) {
+                if (capacity == 0) {
+                    capacity = 64;
+                    batch.records = (lept_record*)MALLOC(capacity * sizeof(lept_record));
+                    ends = (size_t*)MALLOC(capacity * sizeof(size_t));
+                }
+                else {
+                    capacity *= 2;
+                    batch.records = (lept_record*)REALLOC(batch.records, capacity * sizeof(lept_record));
+                    ends = (size_t*)REALLOC(ends, capacity * sizeof(size_t));
+                }
+            }
+            batch.records[batch.count].offset = pos;
+            ends[batch.count++] = end;
+        }
+        pos = end + 1;
+    }
+    batch.ends = ends;
+    if (batch.count > 0) {
+        lept_run_parallel(threads, (batch.count + LEPT_NDJSON_BLOCK - 1) / LEPT_NDJSON_BLOCK, lept_ndjson_block, &batch);
+        FREE(ends);
+    }
+    *records = batch.records;
+    return batch.count;
+}
+
+void lept_free_records(lept_record *records, size_t count) {
+    size_t i;
+    for (i = 0; i < count; i++)
+        lept_free(&records[i].v);
+    if (records != NULL)
+        FREE(records);
+}
+
+/*
+ * Parallel root array: the input is cut at top-level commas into slices of
+ * whole elements, every slice is parsed on its own into its own stack, and
+ * the stacks are copied into the array one after the other.
+ */
+typedef struct {
+    size_t begin, end;     /* the slice in the input, commas excluded */
+    lept_value* elements;  /* the slice's parse stack, holding @size values */
+    size_t size;
+    int result;
+} lept_array_slice;
+
+typedef struct {
+    const char* json;
+    lept_array_slice* slices;
+    size_t max_depth; /* for the elements */
+} lept_array_job;
+
+/*
+ * Offsets of up to @count - 1 top-level commas of the array at @json, the
+ * first after @step bytes and each next one at least @step bytes further.
+ * Only strings and brackets are followed; on malformed input the cuts may be
+ * wrong, which the slice parsers then report.
+ */
+static size_t lept_split_array(const char* json, const char* end, size_t step, size_t* cuts, size_t count) {
+    const char* p = json + 1;
+    const char* next = json + step;
+    size_t n = 0, depth = 0;
+    while (p < end && n < count - 1) {
+        switch (*p++) {
+            case '"':
+                for (;;) {
+                    p = lept_scan_string(p, end);
+                    if (p >= end)
+                        return n;
+                    if (*p == '"')
+                        break;
+                    p += *p == '\\' ? 2 : 1; /* an escape, or a control character left for the parser */
+                }
+                p++;
+                break;
+            case '[':
+            case '{':
+                depth++;
+                break;
+            case ']':
+            case '}':
+                if (depth-- == 0)
+                    return n;
+                break;
+            case ',':
+                if (depth == 0 && p > next) {
+                    cuts[n++] = p - 1 - json;
+                    next = p + step;
+                }
+                break;
+        }
+    }
+    return n;
+}
+
+/* The comma-separated elements of one slice, on a stack of its own */
+static void lept_array_slice_parse(void* ctx, size_t task) {
+    lept_array_job* job = (lept_array_job*)ctx;
+    lept_array_slice* s = &job->slices[task];
+    lept_context c;
+    lept_context_init(&c, job->json + s->begin, s->end - s->begin, NULL);
+    c.max_depth = job->max_depth;
+    s->size = 0;
+    for (;;) {
+        lept_value e;
+        lept_init(&e);
+        lept_parse_whitespace(&c);
+        if ((s->result = lept_parse_value(&c, &e)) != LEPT_PARSE_OK)
+            break;
+        memcpy(lept_context_push(&c, sizeof(lept_value)), &e, sizeof(lept_value));
+        s->size++;
+        lept_parse_whitespace(&c);
+        if (c.json == c.end)
+            break;
+        if (*c.json++ != ',') {
+            s->result = LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+            break;
+        }
+    }
+    if (s->result != LEPT_PARSE_OK) {
+        while (s->size > 0) {
+            lept_free((lept_value*)lept_context_pop(&c, sizeof(lept_value)));
+            s->size--;
+        }
+        lept_mem_free(c.allocator, c.stack);
+        c.stack = NULL;
+    }
+    s->elements = (lept_value*)c.stack;
+}
+
+/*
+ * Parse @json into @v if it is a large array, on @threads threads. Returns 0
+ * with @v untouched when it is not, or when any slice fails; the serial
+ * parser then runs and reports the error exactly as it would have anyway.
+ */
+static int lept_parse_array_parallel(lept_value* v, const char* json, size_t len, size_t threads, size_t max_depth) {
+    lept_array_job job;
+    size_t* cuts;
+    size_t count, total, i;
+    const char* begin = lept_skip_whitespace(json, json + len);
+    const char* end = json + len;
+    int ok = 1;
+    while (end > begin && ISWHITESPACE(end[-1]))
+        end--;
+    if (threads == 0)
+        threads = lept_default_threads();
+    count = threads * 4; /* a few slices per thread even out their costs */
+    if (count > (size_t)(end - begin) / LEPT_PARALLEL_SLICE_SIZE)
+        count = (size_t)(end - begin) / LEPT_PARALLEL_SLICE_SIZE;
+    if (threads < 2 || count < 2 || *begin != '[' || end[-1] != ']')
+        return 0;
+    assert(max_depth > 0);
+    cuts = (size_t*)MALLOC(count * sizeof(size_t));
+    count = lept_split_array(begin, end - 1, (end - begin) / count, cuts, count) + 1;
+    job.json = begin;
+    job.slices = (lept_array_slice*)MALLOC(count * sizeof(lept_array_slice));
+    job.max_depth = max_depth == (size_t)-1 ? max_depth : max_depth - 1;
+    for (i = 0; i < count; i++) {
+        job.slices[i].begin = i == 0 ? 1 : cuts[i - 1] + 1;
+        job.slices[i].end = i == count - 1 ? (size_t)(end - 1 - begin) : cuts[i];
+    }
+    FREE(cuts);
+    lept_run_parallel(threads, count, lept_array_slice_parse, &job);
+    for (i = 0, total = 0; i < count; i++) {
+        ok = ok && job.slices[i].result == LEPT_PARSE_OK;
+        total += job.slices[i].size;
+    }
+    if (ok) {
+        lept_init(v);
+        lept_set_array(v, total);
+        for (i = 0; i < count; i++) {
+            memcpy(v->u.a.e + A_SIZE(v), job.slices[i].elements, job.slices[i].size * sizeof(lept_value));
+            A_SIZE(v) += job.slices[i].size;
+        }
+    }
+    for (i = 0; i < count; i++) {
+        lept_array_slice* s = &job.slices[i];
+        if (!ok)
+            while (s->size > 0)
+                lept_free(&s->elements[--s->size]);
+        if (s->elements)
+            FREE(s->elements);
+    }
+    FREE(job.slices);
+    return ok;
+}
+
+/*
+ * Shortest round-trip number formatting (Grisu2). The double is scaled by a
+ * cached power of ten into a 64-bit fixed-point window and digits are
+ * generated until they fall inside the rounding interval of the input, so
+ * parsing the output always gives back the same double.
+ */
+
+typedef struct { uint64_t f; int e; } lept_diyfp;
+
+#define LEPT_DP_HIDDEN_BIT ((uint64_t)1 << 52)
+
+/* 10^k for k = -348, -340, ..., 340 as normalized 64-bit significands */
+static const uint64_t lept_cached_f[] = {
+    UINT64_C(0xfa8fd5a0081c0288), UINT64_C(0xbaaee17fa23ebf76), UINT64_C(0x8b16fb203055ac76),
+    UINT64_C(0xcf42894a5dce35ea), UINT64_C(0x9a6bb0aa55653b2d), UINT64_C(0xe61acf033d1a45df),
+    UINT64_C(0xab70fe17c79ac6ca), UINT64_C(0xff77b1fcbebcdc4f), UINT64_C(0xbe5691ef416bd60c),
+    UINT64_C(0x8dd01fad907ffc3c), UINT64_C(0xd3515c2831559a83), UINT64_C(0x9d71ac8fada6c9b5),
+    UINT64_C(0xea9c227723ee8bcb), UINT64_C(0xaecc49914078536d), UINT64_C(0x823c12795db6ce57),
+    UINT64_C(0xc21094364dfb5637), UINT64_C(0x9096ea6f3848984f), UINT64_C(0xd77485cb25823ac7),
+    UINT64_C(0xa086cfcd97bf97f4), UINT64_C(0xef340a98172aace5), UINT64_C(0xb23867fb2a35b28e),
+    UINT64_C(0x84c8d4dfd2c63f3b), UINT64_C(0xc5dd44271ad3cdba), UINT64_C(0x936b9fcebb25c996),
+    UINT64_C(0xdbac6c247d62a584), UINT64_C(0xa3ab66580d5fdaf6), UINT64_C(0xf3e2f893dec3f126),
+    UINT64_C(0xb5b5ada8aaff80b8), UINT64_C(0x87625f056c7c4a8b), UINT64_C(0xc9bcff6034c13053),
+    UINT64_C(0x964e858c91ba2655), UINT64_C(0xdff9772470297ebd), UINT64_C(0xa6dfbd9fb8e5b88f),
+    UINT64_C(0xf8a95fcf88747d94), UINT64_C(0xb94470938fa89bcf), UINT64_C(0x8a08f0f8bf0f156b),
+    UINT64_C(0xcdb02555653131b6), UINT64_C(0x993fe2c6d07b7fac), UINT64_C(0xe45c10c42a2b3b06),
+    UINT64_C(0xaa242499697392d3), UINT64_C(0xfd87b5f28300ca0e), UINT64_C(0xbce5086492111aeb),
+    UINT64_C(0x8cbccc096f5088cc), UINT64_C(0xd1b71758e219652c), UINT64_C(0x9c40000000000000),
+    UINT64_C(0xe8d4a51000000000), UINT64_C(0xad78ebc5ac620000), UINT64_C(0x813f3978f8940984),
+    UINT64_C(0xc097ce7bc90715b3), UINT64_C(0x8f7e32ce7bea5c70), UINT64_C(0xd5d238a4abe98068),
+    UINT64_C(0x9f4f2726179a2245), UINT64_C(0xed63a231d4c4fb27), UINT64_C(0xb0de65388cc8ada8),
+    UINT64_C(0x83c7088e1aab65db), UINT64_C(0xc45d1df942711d9a), UINT64_C(0x924d692ca61be758),
+    UINT64_C(0xda01ee641a708dea), UINT64_C(0xa26da3999aef774a), UINT64_C(0xf209787bb47d6b85),
+    UINT64_C(0xb454e4a179dd1877), UINT64_C(0x865b86925b9bc5c2), UINT64_C(0xc83553c5c8965d3d),
+    UINT64_C(0x952ab45cfa97a0b3), UINT64_C(0xde469fbd99a05fe3), UINT64_C(0xa59bc234db398c25),
+    UINT64_C(0xf6c69a72a3989f5c), UINT64_C(0xb7dcbf5354e9bece), UINT64_C(0x88fcf317f22241e2),
+    UINT64_C(0xcc20ce9bd35c78a5), UINT64_C(0x98165af37b2153df), UINT64_C(0xe2a0b5dc971f303a),
+    UINT64_C(0xa8d9d1535ce3b396), UINT64_C(0xfb9b7cd9a4a7443c), UINT64_C(0xbb764c4ca7a44410),
+    UINT64_C(0x8bab8eefb6409c1a), UINT64_C(0xd01fef10a657842c), UINT64_C(0x9b10a4e5e9913129),
+    UINT64_C(0xe7109bfba19c0c9d), UINT64_C(0xac2820d9623bf429), UINT64_C(0x80444b5e7aa7cf85),
+    UINT64_C(0xbf21e44003acdd2d), UINT64_C(0x8e679c2f5e44ff8f), UINT64_C(0xd433179d9c8cb841),
+    UINT64_C(0x9e19db92b4e31ba9), UINT64_C(0xeb96bf6ebadf77d9), UINT64_C(0xaf87023b9bf0ee6b)
+};
+
+static const short lept_cached_e[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+    -954, -927, -901, -874, -847, -821, -794, -768, -741, -715,
+    -688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+    -422, -396, -369, -343, -316, -289, -263, -236, -210, -183,
+    -157, -130, -103, -77, -50, -24, 3, 30, 56, 83,
+    109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+    375, 402, 428, 455, 481, 508, 534, 561, 588, 614,
+    641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+    907, 933, 960, 986, 1013, 1039, 1066
+};
+
+static const uint64_t lept_pow10_u64[] = {
+    UINT64_C(1), UINT64_C(10), UINT64_C(100), UINT64_C(1000), UINT64_C(10000),
+    UINT64_C(100000), UINT64_C(1000000), UINT64_C(10000000), UINT64_C(100000000),
+    UINT64_C(1000000000), UINT64_C(10000000000), UINT64_C(100000000000),
+    UINT64_C(1000000000000), UINT64_C(10000000000000), UINT64_C(100000000000000),
+    UINT64_C(1000000000000000), UINT64_C(10000000000000000),
+    UINT64_C(100000000000000000), UINT64_C(1000000000000000000),
+    UINT64_C(10000000000000000000)
+};
+
+static lept_diyfp lept_diyfp_make(uint64_t f, int e) {
+    lept_diyfp r;
+    r.f = f;
+    r.e = e;
+    return r;
+}
+
+static lept_diyfp lept_diyfp_mul(lept_diyfp a, lept_diyfp b) {
+    uint64_t hi, lo = lept_mul128(a.f, b.f, &hi);
+    return lept_diyfp_make(hi + (lo >> 63), a.e + b.e + 64); /* rounded */
+}
+
+static lept_diyfp lept_diyfp_normalize(lept_diyfp a) {
+    int s = lept_clz64(a.f);
+    return lept_diyfp_make(a.f << s, a.e - s);
+}
+
+static void lept_grisu_round(char* buffer, int len, uint64_t delta, uint64_t rest, uint64_t ten_kappa, uint64_t wp_w) {
+    while (rest < wp_w && delta - rest >= ten_kappa &&
+        (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w)) {
+        buffer[len - 1]--;
+        rest += ten_kappa;
+    }
+}
+
+/* Generates the digits of Mp until they are within delta, adjusting the decimal exponent *k */
+static int lept_grisu_digits(lept_diyfp w, lept_diyfp mp, uint64_t delta, char* buffer, int* k) {
+    lept_diyfp one = lept_diyfp_make((uint64_t)1 << -mp.e, mp.e);
+    uint64_t wp_w = mp.f - w.f;
+    uint32_t p1 = (uint32_t)(mp.f >> -one.e);
+    uint64_t p2 = mp.f & (one.f - 1);
+    int kappa = 1, len = 0;
+    while (kappa < 10 && p1 >= lept_pow10_u64[kappa])
+        kappa++;
+    while (kappa > 0) {
+        uint32_t d = (uint32_t)(p1 / lept_pow10_u64[kappa - 1]);
+        uint64_t rest;
+        p1 = (uint32_t)(p1 % lept_pow10_u64[kappa - 1]);
+        if (d || len)
+            buffer[len++] = (char)('0' + d);
+        kappa--;
+        rest = ((uint64_t)p1 << -one.e) + p2;
+        if (rest <= delta) {
+            *k += kappa;
+            lept_grisu_round(buffer, len, delta, rest, lept_pow10_u64[kappa] << -one.e, wp_w);
+            return len;
+        }
+    }
+    for (;;) {
+        char d;
+        p2 *= 10;
+        delta *= 10;
+        d = (char)(p2 >> -one.e);
+        if (d || len)
+            buffer[len++] = (char)('0' + d);
+        p2 &= one.f - 1;
+        kappa--;
+        if (p2 < delta) {
+            *k += kappa;
+            lept_grisu_round(buffer, len, delta, p2, one.f, wp_w * (-kappa < 20 ? lept_pow10_u64[-kappa] : 0));
+            return len;
+        }
     }
-    return ret;
 }
 
-static int lept_parse_value(lept_context* c, lept_value* v) {
-    switch (*c->json) {
-    case 'n': return lept_parse_literal(c, v, "null", LEPT_NULL);
-    case 't': return lept_parse_literal(c, v, "true", LEPT_TRUE);
-    case 'f': return lept_parse_literal(c, v, "false", LEPT_FALSE);
-    default:  return lept_parse_number(c, v);
-    case '"': return lept_parse_string(c, v);
-    case '[': return lept_parse_array(c, v);
-    case '{': return lept_parse_object(c, v);
-    case '\0': return LEPT_PARSE_EXPECT_VALUE;
+/* Shortest digits of a positive finite d: d == digits * 10^*k */
+static int lept_grisu2(double d, char* buffer, int* k) {
+    lept_diyfp v, pl, mi, c_mk, w, wp, wm;
+    uint64_t bits;
+    int biased_e, index;
+    double dk;
+    memcpy(&bits, &d, sizeof(d));
+    biased_e = (int)((bits >> 52) & 0x7FF);
+    v.f = bits & (LEPT_DP_HIDDEN_BIT - 1);
+    if (biased_e) {
+        v.f += LEPT_DP_HIDDEN_BIT;
+        v.e = biased_e - 1075;
     }
+    else
+        v.e = -1074;
+
+    /* boundaries m- and m+ halfway to the neighbouring doubles, sharing m+'s exponent */
+    pl = lept_diyfp_normalize(lept_diyfp_make((v.f << 1) + 1, v.e - 1));
+    mi = v.f == LEPT_DP_HIDDEN_BIT ? lept_diyfp_make((v.f << 2) - 1, v.e - 2) : lept_diyfp_make((v.f << 1) - 1, v.e - 1);
+    mi.f <<= mi.e - pl.e;
+    mi.e = pl.e;
+
+    /* a cached power 10^-k that brings the exponent into [-60, -32] */
+    dk = (-61 - pl.e) * 0.30102999566398114 + 347;
+    index = (int)dk;
+    if (dk - index > 0.0)
+        index++;
+    index = (index >> 3) + 1;
+    *k = -(-348 + index * 8);
+    c_mk = lept_diyfp_make(lept_cached_f[index], lept_cached_e[index]);
+
+    w = lept_diyfp_mul(lept_diyfp_normalize(v), c_mk);
+    wp = lept_diyfp_mul(pl, c_mk);
+    wm = lept_diyfp_mul(mi, c_mk);
+    wm.f++;
+    wp.f--;
+    return lept_grisu_digits(w, wp, wp.f - wm.f, buffer, k);
 }
 
-int lept_parse(lept_value *v, const char *json) {
-    lept_context c;
-    int result;
-    assert(v != NULL);
+static char* lept_write_uint64(char* p, uint64_t u) {
+    char tmp[20];
+    int n = 0;
+    do {
+        tmp[n++] = (char)('0' + u % 10);
+        u /= 10;
+    } while (u);
+    while (n)
+        *p++ = tmp[--n];
+    return p;
+}
 
-    c.json = json;
-    c.stack = NULL;
-    c.size = c.top = 0;
-    lept_init(v);
-    lept_parse_whitespace(&c);
+/*
+ * Formats a finite double in at most 25 bytes (not terminated) and returns the end.
+ * Like "%.17g", but with the fewest digits that read back as the same value.
+ */
+static char* lept_dtoa(double d, char* p) {
+    char digits[20];
+    int len, k, x, i;
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(d));
+    if (bits >> 63) {
+        *p++ = '-';
+        d = -d;
+    }
+    if (d == 0.0) {
+        *p++ = '0';
+        return p;
+    }
+    /*
+     * Integers below 1e17 are written exactly: they read back as exact
+     * integers, so shortest digits padded with zeros would be another value.
+     * Larger ones take the exponent form below, which reads back as a double.
+     */
+    if (d < 1e17 && d == (double)(uint64_t)d)
+        return lept_write_uint64(p, (uint64_t)d);
 
-    if ((result = lept_parse_value(&c, v)) == LEPT_PARSE_OK) {
-        lept_parse_whitespace(&c);
-        if (*c.json != '\0') {
-            v->type = LEPT_NULL;
-            return LEPT_PARSE_ROOT_NOT_SINGULAR;
+    len = lept_grisu2(d, digits, &k);
+    x = len + k - 1; /* exponent of the first digit */
+    if (x >= -4 && x < 17) {
+        if (k >= 0) {
+            memcpy(p, digits, len);
+            memset(p + len, '0', k);
+            return p + len + k;
+        }
+        if (x >= 0) {
+            memcpy(p, digits, x + 1);
+            p += x + 1;
+            *p++ = '.';
+            memcpy(p, digits + x + 1, len - x - 1);
+            return p + len - x - 1;
         }
+        *p++ = '0';
+        *p++ = '.';
+        for (i = -1; i > x; i--)
+            *p++ = '0';
+        memcpy(p, digits, len);
+        return p + len;
     }
-    assert(c.top == 0);
-    free(c.stack);
-    return result;
+    *p++ = digits[0];
+    if (len > 1) {
+        *p++ = '.';
+        memcpy(p, digits + 1, len - 1);
+        p += len - 1;
+    }
+    *p++ = 'e';
+    if (x < 0) {
+        *p++ = '-';
+        x = -x;
+    }
+    else
+        *p++ = '+';
+    if (x < 10)
+        *p++ = '0';
+    return lept_write_uint64(p, (uint64_t)x);
 }
 
-static void lept_stringify_string(lept_context* c, const char* s, size_t len) {
+/* Format a number in at most 32 bytes (not terminated) and return the end */
+static char* lept_format_number(char* p, const lept_value* v) {
+    if (v->flags & LEPT_UINT64)
+        return lept_write_uint64(p, v->u.ui);
+    if (v->flags & LEPT_INT64) {
+        if (v->u.i < 0) {
+            *p++ = '-';
+            return lept_write_uint64(p, (uint64_t)0 - (uint64_t)v->u.i);
+        }
+        return lept_write_uint64(p, (uint64_t)v->u.i);
+    }
+    return lept_dtoa(v->u.n, p);
+}
+
+/* Hand the output gathered so far to the writer once there is enough of it */
+static void lept_stringify_flush(lept_context* c, size_t threshold) {
+    if (c->top >= threshold && c->top > 0) {
+        if (!c->write_failed && !c->write(c->write_ctx, c->stack, c->top))
+            c->write_failed = 1;
+        c->top = 0;
+    }
+}
+
+/* Escape the string contents [s, s + len) at @p, at most len * 6 bytes */
+static char* lept_escape_chars(char* p, const char* s, size_t len) {
     static const char* hex_digits = "0123456789ABCDEF";
-    size_t i, size;
-    char *head, *p;
-    assert(s != NULL);
-    p = head = lept_context_push(c, size = len * 6 + 2);
-    *p++ = '"';
+    size_t i;
     for (i = 0; i < len; ++i) {
         unsigned char u = (unsigned char)s[i];
         switch (u) {
@@ -397,47 +3651,87 @@ static void lept_stringify_string(lept_context* c, const char* s, size_t len) {
             }
         }
     }
+    return p;
+}
+
+#define LEPT_WRITE_CHUNK (LEPT_WRITE_BUFFER_SIZE / 8)
+
+static void lept_stringify_string(lept_context* c, const char* s, size_t len) {
+    size_t size, n;
+    char *head, *p;
+    assert(s != NULL);
+    if (c->write && len > LEPT_WRITE_CHUNK) {
+        /* a long string is escaped a piece at a time so the buffer stays bounded */
+        PUTC(c, '"');
+        for (; len > 0; s += n, len -= n) {
+            n = len < LEPT_WRITE_CHUNK ? len : LEPT_WRITE_CHUNK;
+            p = head = lept_context_push(c, size = n * 6);
+            c->top -= size - (lept_escape_chars(p, s, n) - head);
+            lept_stringify_flush(c, LEPT_WRITE_BUFFER_SIZE);
+        }
+        PUTC(c, '"');
+        return;
+    }
+    p = head = lept_context_push(c, size = len * 6 + 2);
+    *p++ = '"';
+    p = lept_escape_chars(p, s, len);
     *p++ = '"';
     c->top -= size - (p - head);
 }
 
 static void lept_stringify_value(lept_context* c, const lept_value* v) {
-    size_t i;
-    switch (v->type) {
-    case LEPT_NULL:  PUTS(c, "null",  4); break;
-    case LEPT_FALSE: PUTS(c, "false", 5); break;
-    case LEPT_TRUE:  PUTS(c, "true",  4); break;
-    case LEPT_NUMBER: c->top -= 32 - sprintf(lept_context_push(c, 32), "%.17g", v->u.n); break;
-    case LEPT_STRING: lept_stringify_string(c, v->u.s.s, v->u.s.len); break;
-    case LEPT_ARRAY:
-        PUTC(c, '[');
-        for (i = 0; i < v->u.a.size; i++) {
-            lept_stringify_value(c, &v->u.a.e[i]);
-            if (i != v->u.a.size - 1)
-                PUTC(c, ',');
+    lept_walk w;
+    lept_walk_init(&w);
+    while (v) {
+        if (c->write) {
+            if (c->write_failed)
+                break;
+            lept_stringify_flush(c, LEPT_WRITE_BUFFER_SIZE);
+        }
+        switch (v->type) {
+        case LEPT_NULL:  PUTS(c, "null",  4); break;
+        case LEPT_FALSE: PUTS(c, "false", 5); break;
+        case LEPT_TRUE:  PUTS(c, "true",  4); break;
+        case LEPT_NUMBER:
+            {
+                char* p = lept_context_push(c, 32);
+                c->top -= 32 - (lept_format_number(p, v) - p);
+            }
+            break;
+        case LEPT_STRING: lept_stringify_string(c, lept_get_string(v), lept_get_string_length(v)); break;
+        case LEPT_ARRAY:  PUTC(c, '['); lept_walk_push(&w, v); break;
+        case LEPT_OBJECT: PUTC(c, '{'); lept_walk_push(&w, v); break;
+        default: assert(0 && "invalid type");
+        }
+        /* the next value: the next element or member, once finished containers are closed */
+        for (v = NULL; w.depth > 0; w.depth--) {
+            lept_walk_frame* f = WALK_TOP(&w);
+            if (f->i < CHILD_COUNT(f->v)) {
+                if (f->i > 0)
+                    PUTC(c, ',');
+                if (f->v->type == LEPT_OBJECT) {
+                    lept_stringify_string(c, f->v->u.o.m[f->i].k, f->v->u.o.m[f->i].klen);
+                    PUTC(c, ':');
+                }
+                v = CHILD(f->v, f->i);
+                f->i++;
+                break;
+            }
+            PUTC(c, f->v->type == LEPT_ARRAY ? ']' : '}');
         }
-        PUTC(c, ']');
-        break;
-    case LEPT_OBJECT:
-        PUTC(c, '{');
-        for (i = 0; i < v->u.o.size; i++) {
-            lept_stringify_string(c, v->u.o.m[i].k, v->u.o.m[i].klen);
-            PUTC(c, ':');
-            lept_stringify_value(c, &v->u.o.m[i].v);
-            if (i != v->u.o.size - 1)
-                PUTC(c, ',');
-        }
-        PUTC(c, '}');
-        break;
-    default: assert(0 && "invalid type");
     }
+    lept_walk_free(&w);
 }
 
 char* lept_stringify(const lept_value* v, size_t* length) {
+    return lept_stringify_with(v, length, NULL);
+}
+
+char* lept_stringify_with(const lept_value* v, size_t* length, const lept_allocator *allocator) {
     lept_context c;
     assert(v != NULL);
-    c.stack = (char*)malloc(c.size = LEPT_PARSE_STRINGIFY_INIT_SIZE);
-    c.top = 0;
+    lept_context_init(&c, NULL, 0, allocator);
+    c.stack = (char*)lept_mem_alloc(c.allocator, c.size = LEPT_PARSE_STRINGIFY_INIT_SIZE);
     lept_stringify_value(&c, v);
     if (length)
         *length = c.top;
@@ -445,26 +3739,348 @@ char* lept_stringify(const lept_value* v, size_t* length) {
     return c.stack;
 }
 
-void lept_copy(lept_value *dst, const lept_value *src) {
+/*
+ * Parallel stringify: the elements or members of one container are cut into
+ * runs that are stringified side by side, each into a stack of its own, and
+ * the pieces are joined in order. Every run but the first starts with its
+ * comma. The split starts at the root and moves down into a child that is
+ * worth more runs than its container, so that a large array in a small
+ * wrapper is still split; what surrounds it is written on the calling thread.
+ */
+typedef struct {
+    size_t begin, end; /* elements or members of the container */
+    char* json;        /* the run's stack, holding @len bytes */
+    size_t len;
+} lept_stringify_slice;
+
+typedef struct {
+    const lept_value* v;
+    lept_stringify_slice* slices;
+} lept_stringify_job;
+
+typedef struct {
+    const lept_value* v; /* a container around the split one */
+    size_t i;            /* the child of @v it is in */
+} lept_stringify_level;
+
+/* Element @i of @v with the comma before it, and its key in an object */
+static void lept_stringify_child(lept_context* c, const lept_value* v, size_t i) {
+    if (i > 0)
+        PUTC(c, ',');
+    if (v->type == LEPT_OBJECT) {
+        lept_stringify_string(c, v->u.o.m[i].k, v->u.o.m[i].klen);
+        PUTC(c, ':');
+    }
+}
+
+static void lept_stringify_slice_run(void* ctx, size_t task) {
+    lept_stringify_job* job = (lept_stringify_job*)ctx;
+    lept_stringify_slice* s = &job->slices[task];
+    lept_context c;
     size_t i;
-    assert(src != NULL && dst != NULL && src != dst);
+    lept_context_init(&c, NULL, 0, NULL);
+    c.stack = (char*)lept_mem_alloc(c.allocator, c.size = LEPT_PARSE_STRINGIFY_INIT_SIZE);
+    for (i = s->begin; i < s->end; i++) {
+        lept_stringify_child(&c, job->v, i);
+        lept_stringify_value(&c, CHILD(job->v, i));
+    }
+    s->json = c.stack;
+    s->len = c.top;
+}
+
+/* The values of @v and of its children, a cheap measure of the work under it */
+static size_t lept_stringify_work(const lept_value* v) {
+    size_t size, work, i;
+    if (v->type != LEPT_ARRAY && v->type != LEPT_OBJECT)
+        return 0;
+    size = work = CHILD_COUNT(v);
+    for (i = 0; i < size; i++) {
+        const lept_value* e = CHILD(v, i);
+        if (e->type == LEPT_ARRAY || e->type == LEPT_OBJECT)
+            work += CHILD_COUNT(e);
+    }
+    return work;
+}
+
+/* How many runs @v is worth on @threads threads, by LEPT_PARALLEL_RUN_SIZE */
+static size_t lept_stringify_runs(const lept_value* v, size_t threads) {
+    size_t work = lept_stringify_work(v), count = threads * 4; /* a few runs per thread even out their costs */
+    if (count > work / LEPT_PARALLEL_RUN_SIZE)
+        count = work / LEPT_PARALLEL_RUN_SIZE;
+    if (work > 0 && count > CHILD_COUNT(v))
+        count = CHILD_COUNT(v);
+    return count;
+}
+
+char* lept_stringify_parallel(const lept_value* v, size_t* length, size_t threads) {
+    lept_stringify_job job;
+    lept_stringify_level* path = NULL;
+    size_t depth = 0, capacity = 0, count, size, len, i, j;
+    const lept_value* target = v;
+    lept_context head, tail;
+    char* json;
+    assert(v != NULL);
+    if (threads == 0)
+        threads = lept_default_threads();
+    if (threads < 2)
+        return lept_stringify(v, length);
+    /* descend while one child is worth more runs than its container */
+    for (count = lept_stringify_runs(target, threads); count < threads * 4;) {
+        size_t best = 0, best_count = 0;
+        size = target->type == LEPT_ARRAY || target->type == LEPT_OBJECT ? CHILD_COUNT(target) : 0;
+        for (i = 0; i < size; i++) {
+            size_t n = lept_stringify_runs(CHILD(target, i), threads);
+            if (n > best_count) {
+                best = i;
+                best_count = n;
+            }
+        }
+        if (best_count <= count)
+            break;
+        if (depth == capacity) {
+            capacity = capacity ? capacity * 2 : 4;
+            path = (lept_stringify_level*)REALLOC(path, capacity * sizeof(lept_stringify_level));
+        }
+        path[depth].v = target;
+        path[depth++].i = best;
+        target = CHILD(target, best);
+        count = best_count;
+    }
+    if (count < 2) {
+        if (path)
+            FREE(path);
+        return lept_stringify(v, length);
+    }
+
+    /* the wrappers before and after the split container */
+    lept_context_init(&head, NULL, 0, NULL);
+    lept_context_init(&tail, NULL, 0, NULL);
+    head.stack = (char*)lept_mem_alloc(head.allocator, head.size = LEPT_PARSE_STRINGIFY_INIT_SIZE);
+    tail.stack = (char*)lept_mem_alloc(tail.allocator, tail.size = LEPT_PARSE_STRINGIFY_INIT_SIZE);
+    for (i = 0; i < depth; i++) {
+        const lept_value* w = path[i].v;
+        PUTC(&head, w->type == LEPT_ARRAY ? '[' : '{');
+        for (j = 0; j < path[i].i; j++) {
+            lept_stringify_child(&head, w, j);
+            lept_stringify_value(&head, CHILD(w, j));
+        }
+        lept_stringify_child(&head, w, path[i].i);
+    }
+    PUTC(&head, target->type == LEPT_ARRAY ? '[' : '{');
+    PUTC(&tail, target->type == LEPT_ARRAY ? ']' : '}');
+    for (i = depth; i-- > 0;) {
+        const lept_value* w = path[i].v;
+        for (j = path[i].i + 1; j < CHILD_COUNT(w); j++) {
+            lept_stringify_child(&tail, w, j);
+            lept_stringify_value(&tail, CHILD(w, j));
+        }
+        PUTC(&tail, w->type == LEPT_ARRAY ? ']' : '}');
+    }
+    if (path)
+        FREE(path);
+
+    size = CHILD_COUNT(target);
+    job.v = target;
+    job.slices = (lept_stringify_slice*)MALLOC(count * sizeof(lept_stringify_slice));
+    for (i = 0; i < count; i++) {
+        job.slices[i].begin = size / count * i + (i < size % count ? i : size % count);
+        job.slices[i].end = job.slices[i].begin + size / count + (i < size % count);
+    }
+    lept_run_parallel(threads, count, lept_stringify_slice_run, &job);
+    for (i = 0, len = head.top + tail.top; i < count; i++)
+        len += job.slices[i].len;
+    json = (char*)MALLOC(len + 1);
+    memcpy(json, head.stack, len = head.top);
+    for (i = 0; i < count; i++) {
+        memcpy(json + len, job.slices[i].json, job.slices[i].len);
+        len += job.slices[i].len;
+        FREE(job.slices[i].json);
+    }
+    memcpy(json + len, tail.stack, tail.top);
+    len += tail.top;
+    json[len] = '\0';
+    lept_mem_free(head.allocator, head.stack);
+    lept_mem_free(tail.allocator, tail.stack);
+    FREE(job.slices);
+    if (length)
+        *length = len;
+    return json;
+}
+
+/*
+ * Exact-size output for lept_stringify_length() and lept_stringify_buffer():
+ * bytes are written straight to their place while they fit and counted in
+ * any case, so nothing is reserved ahead and nothing is allocated.
+ */
+typedef struct {
+    char* p;
+    char* end;
+    size_t size;
+} lept_output;
+
+static void lept_output_write(lept_output* out, const char* s, size_t len) {
+    out->size += len;
+    if (out->p && len <= (size_t)(out->end - out->p)) {
+        memcpy(out->p, s, len);
+        out->p += len;
+    }
+    else
+        out->p = out->end; /* once a piece did not fit the rest is only counted */
+}
+
+static void lept_output_string(lept_output* out, const char* s, size_t len) {
+    const char *end = s + len, *q;
+    char escaped[6];
+    lept_output_write(out, "\"", 1);
+    for (;;) {
+        q = lept_scan_string(s, end);
+        lept_output_write(out, s, q - s);
+        if (q == end)
+            break;
+        lept_output_write(out, escaped, lept_escape_chars(escaped, q, 1) - escaped);
+        s = q + 1;
+    }
+    lept_output_write(out, "\"", 1);
+}
+
+static void lept_output_value(lept_output* out, const lept_value* v) {
+    char number[32];
+    lept_walk w;
+    lept_walk_init(&w);
+    while (v) {
+        switch (v->type) {
+        case LEPT_NULL:   lept_output_write(out, "null",  4); break;
+        case LEPT_FALSE:  lept_output_write(out, "false", 5); break;
+        case LEPT_TRUE:   lept_output_write(out, "true",  4); break;
+        case LEPT_NUMBER:
+            if (out->p && out->end - out->p >= 32) { /* format in place when it surely fits */
+                char* e = lept_format_number(out->p, v);
+                out->size += e - out->p;
+                out->p = e;
+            }
+            else
+                lept_output_write(out, number, lept_format_number(number, v) - number);
+            break;
+        case LEPT_STRING: lept_output_string(out, lept_get_string(v), lept_get_string_length(v)); break;
+        case LEPT_ARRAY:  lept_output_write(out, "[", 1); lept_walk_push(&w, v); break;
+        case LEPT_OBJECT: lept_output_write(out, "{", 1); lept_walk_push(&w, v); break;
+        default: assert(0 && "invalid type");
+        }
+        for (v = NULL; w.depth > 0; w.depth--) {
+            lept_walk_frame* f = WALK_TOP(&w);
+            if (f->i < CHILD_COUNT(f->v)) {
+                if (f->i > 0)
+                    lept_output_write(out, ",", 1);
+                if (f->v->type == LEPT_OBJECT) {
+                    lept_output_string(out, f->v->u.o.m[f->i].k, f->v->u.o.m[f->i].klen);
+                    lept_output_write(out, ":", 1);
+                }
+                v = CHILD(f->v, f->i);
+                f->i++;
+                break;
+            }
+            lept_output_write(out, f->v->type == LEPT_ARRAY ? "]" : "}", 1);
+        }
+    }
+    lept_walk_free(&w);
+}
+
+size_t lept_stringify_length(const lept_value* v) {
+    lept_output out;
+    assert(v != NULL);
+    out.p = out.end = NULL;
+    out.size = 0;
+    lept_output_value(&out, v);
+    return out.size;
+}
+
+size_t lept_stringify_buffer(const lept_value* v, char* buffer, size_t capacity) {
+    lept_output out;
+    assert(v != NULL && (buffer != NULL || capacity == 0));
+    out.p = buffer;
+    out.end = capacity > 0 ? buffer + capacity - 1 : buffer; /* room for the NUL */
+    out.size = 0;
+    lept_output_value(&out, v);
+    if (out.size < capacity)
+        buffer[out.size] = '\0';
+    return out.size;
+}
+
+int lept_stringify_to(const lept_value* v, lept_write_func write, void* ctx) {
+    lept_context c;
+    assert(v != NULL && write != NULL);
+    lept_context_init(&c, NULL, 0, NULL);
+    c.write = write;
+    c.write_ctx = ctx;
+    lept_stringify_value(&c, v);
+    lept_stringify_flush(&c, 0);
+    lept_mem_free(c.allocator, c.stack);
+    return c.write_failed ? LEPT_STRINGIFY_WRITE_ERROR : LEPT_STRINGIFY_OK;
+}
+
+static int lept_write_file(void* ctx, const char* data, size_t len) {
+    return fwrite(data, 1, len, (FILE*)ctx) == len;
+}
+
+int lept_stringify_file(const lept_value* v, FILE* fp) {
+    assert(fp != NULL);
+    return lept_stringify_to(v, lept_write_file, fp);
+}
+
+#if defined(LEPT_HAVE_FD)
+static int lept_write_fd(void* ctx, const char* data, size_t len) {
+    int fd = *(const int*)ctx;
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return 0;
+        data += n;
+        len -= n;
+    }
+    return 1;
+}
+
+int lept_stringify_fd(const lept_value* v, int fd) {
+    assert(fd >= 0);
+    return lept_stringify_to(v, lept_write_fd, &fd);
+}
+#endif
+
+int lept_stringify_path(const lept_value* v, const char* path) {
+    int result;
+#if defined(LEPT_HAVE_FD)
+    int fd;
+    assert(path != NULL);
+    if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666)) < 0)
+        return LEPT_STRINGIFY_WRITE_ERROR;
+    result = lept_stringify_fd(v, fd);
+    if (close(fd) != 0 && errno != EINTR)
+        result = LEPT_STRINGIFY_WRITE_ERROR;
+#else
+    FILE* fp;
+    assert(path != NULL);
+    if ((fp = fopen(path, "wb")) == NULL)
+        return LEPT_STRINGIFY_WRITE_ERROR;
+    result = lept_stringify_file(v, fp);
+    if (fclose(fp) != 0)
+        result = LEPT_STRINGIFY_WRITE_ERROR;
+#endif
+    return result;
+}
+
+/* Copy @src into @dst, arrays and objects as empty ones of the right capacity */
+static void lept_copy_shallow(lept_value* dst, const lept_value* src) {
     switch (src->type) {
     case LEPT_STRING:
-        lept_set_string(dst, src->u.s.s, src->u.s.len);
+        lept_set_string(dst, lept_get_string(src), lept_get_string_length(src));
         break;
     case LEPT_ARRAY:
-        lept_set_array(dst, src->u.a.size);
-        for (i = 0; i < src->u.o.size; i++) {
-            lept_copy(lept_pushback_array_element(dst), &src->u.a.e[i]);
-        }
+        lept_set_array(dst, A_SIZE(src));
         break;
     case LEPT_OBJECT:
-        lept_set_object(dst, src->u.o.size);
-        for (i = 0; i < src->u.o.size; i++) {
-            lept_copy(
-                lept_set_object_value(dst, src->u.o.m[i].k, src->u.o.m[i].klen),
-                &src->u.o.m[i].v);
-        }
+        lept_set_object(dst, O_SIZE(src));
         break;
     default:
         lept_free(dst);
@@ -473,6 +4089,32 @@ void lept_copy(lept_value *dst, const lept_value *src) {
     }
 }
 
+void lept_copy(lept_value *dst, const lept_value *src) {
+    lept_walk w;
+    lept_walk_frame* f;
+    assert(src != NULL && dst != NULL && src != dst);
+    lept_copy_shallow(dst, src);
+    if (!IS_CONTAINER(src))
+        return;
+    lept_walk_init(&w);
+    lept_walk_push(&w, src)->dst = dst;
+    while (w.depth > 0) {
+        f = WALK_TOP(&w);
+        if (f->i < CHILD_COUNT(f->v)) {
+            const lept_value* s = CHILD(f->v, f->i);
+            lept_value* d = f->v->type == LEPT_ARRAY ? lept_pushback_array_element(f->dst) :
+                lept_set_object_value(f->dst, f->v->u.o.m[f->i].k, f->v->u.o.m[f->i].klen);
+            f->i++;
+            lept_copy_shallow(d, s);
+            if (IS_CONTAINER(s))
+                lept_walk_push(&w, s)->dst = d;
+        }
+        else
+            w.depth--;
+    }
+    lept_walk_free(&w);
+}
+
 void lept_move(lept_value *dst, lept_value *src) {
     assert(dst != NULL && src != NULL && src != dst);
     lept_free(dst);
@@ -490,32 +4132,65 @@ void lept_swap(lept_value *lhs, lept_value *rhs) {
     }
 }
 
-void lept_free(lept_value* v) {
+/* Release what @v itself owns, once its elements or member values are freed */
+static void lept_free_shallow(lept_value* v) {
     size_t i;
-    assert(v != NULL);
     switch (v->type) {
     case LEPT_STRING:
-        free(v->u.s.s);
+        if (!(v->flags & (LEPT_BORROWED_BUFFER | LEPT_SHORT_STRING)))
+            FREE(v->u.s.s);
         break;
     case LEPT_ARRAY:
-        for (i = 0; i < v->u.a.size; i++) {
-            lept_free(lept_get_array_element(v, i));
-        }
-        if (v->u.a.size > 0)
-            free(v->u.a.e);
+        if (!(v->flags & LEPT_BORROWED_BUFFER))
+            lept_buffer_free(v->u.a.e);
         break;
     case LEPT_OBJECT:
-        for (i = 0; i < v->u.o.size; i++) {
-            free(v->u.o.m[i].k);
-            lept_free(&v->u.o.m[i].v);
-        }
-        if (v->u.o.size > 0)
-            free(v->u.o.m);
+        for (i = 0; i < O_SIZE(v) && !(v->flags & LEPT_BORROWED_KEYS); i++)
+            FREE(v->u.o.m[i].k);
+        if (!(v->flags & LEPT_BORROWED_BUFFER))
+            lept_buffer_free(v->u.o.m);
         break;
     default:
         break;
     }
     v->type = LEPT_NULL;
+    v->flags = 0;
+}
+
+void lept_free(lept_value* v) {
+    lept_walk w;
+    lept_walk_frame* f;
+    size_t i = 0, n;
+    assert(v != NULL);
+    if (!IS_CONTAINER(v)) {
+        lept_free_shallow(v);
+        return;
+    }
+    /* @v is the container being emptied and @i its next child; frames hold the ones above it */
+    lept_walk_init(&w);
+    for (;;) {
+        n = CHILD_COUNT(v);
+        while (i < n) {
+            lept_value* e = CHILD(v, i);
+            i++;
+            if (IS_CONTAINER(e)) {
+                f = lept_walk_push(&w, v);
+                f->i = i;
+                v = e;
+                i = 0;
+                n = CHILD_COUNT(v);
+            }
+            else if (e->type == LEPT_STRING && !(e->flags & (LEPT_BORROWED_BUFFER | LEPT_SHORT_STRING)))
+                FREE(e->u.s.s); /* other scalars own nothing */
+        }
+        lept_free_shallow(v);
+        if (w.depth == 0)
+            break;
+        f = &w.frames[--w.depth];
+        v = (lept_value*)f->v;
+        i = f->i;
+    }
+    lept_walk_free(&w);
 }
 
 lept_type lept_get_type(const lept_value *v) {
@@ -523,41 +4198,72 @@ lept_type lept_get_type(const lept_value *v) {
     return v->type;
 }
 
-int lept_is_equal(const lept_value *lhs, const lept_value *rhs) {
-    size_t i;
-    assert(lhs != NULL && rhs != NULL);
+/* Integer and double storage compare by exact value */
+static int lept_integer_equal_double(const lept_value* i, double d) {
+    if (i->flags & LEPT_UINT64)
+        return d >= 9223372036854775808.0 && d < 18446744073709551616.0 && (uint64_t)d == i->u.ui;
+    return d >= -9223372036854775808.0 && d < 9223372036854775808.0 && (int64_t)d == i->u.i;
+}
+
+static int lept_number_equal(const lept_value* lhs, const lept_value* rhs) {
+    int lint = (lhs->flags & (LEPT_INT64 | LEPT_UINT64)) != 0;
+    int rint = (rhs->flags & (LEPT_INT64 | LEPT_UINT64)) != 0;
+    if (lint && rint)
+        return (lhs->flags & LEPT_UINT64) == (rhs->flags & LEPT_UINT64) && lhs->u.ui == rhs->u.ui;
+    if (lint)
+        return lept_integer_equal_double(lhs, rhs->u.n);
+    if (rint)
+        return lept_integer_equal_double(rhs, lhs->u.n);
+    return lhs->u.n == rhs->u.n;
+}
+
+/* Equality of everything but the elements or member values */
+static int lept_is_equal_shallow(const lept_value* lhs, const lept_value* rhs) {
     if (lhs->type != rhs->type)
         return 0;
     switch (lhs->type) {
     case LEPT_STRING:
-        return lhs->u.s.len == rhs->u.s.len &&
-            memcmp(lhs->u.s.s, rhs->u.s.s, lhs->u.s.len) == 0;
+        return lept_get_string_length(lhs) == lept_get_string_length(rhs) &&
+            memcmp(lept_get_string(lhs), lept_get_string(rhs), lept_get_string_length(lhs)) == 0;
     case LEPT_NUMBER:
-        return lhs->u.n == rhs->u.n;
+        return lept_number_equal(lhs, rhs);
     case LEPT_ARRAY:
-        if (lhs->u.a.size != rhs->u.a.size)
-            return 0;
-        for (i = 0; i < lhs->u.a.size; i++)
-            if (!lept_is_equal(&lhs->u.a.e[i], &rhs->u.a.e[i]))
-                return 0;
-        return 1;
+        return A_SIZE(lhs) == A_SIZE(rhs);
     case LEPT_OBJECT:
-        if (lhs->u.o.size != rhs->u.o.size)
-            return 0;
-        for (i = 0; i < lhs->u.o.size; i++) {
-            const char *key = lept_get_object_key(lhs, i);
-            size_t klen = lept_get_object_key_length(lhs, i);
-            if (lept_find_object_index(rhs, key, klen) == LEPT_KEY_NOT_EXIST)
-                return 0;
-            if (!lept_is_equal(lept_get_object_value(lhs, i), lept_find_object_value(rhs, key, klen)))
-                return 0;
-        }
-        return 1;
+        return O_SIZE(lhs) == O_SIZE(rhs);
     default:
         return 1;
     }
 }
 
+int lept_is_equal(const lept_value *lhs, const lept_value *rhs) {
+    lept_walk w;
+    int equal;
+    assert(lhs != NULL && rhs != NULL);
+    if (!lept_is_equal_shallow(lhs, rhs))
+        return 0;
+    if (!IS_CONTAINER(lhs))
+        return 1;
+    lept_walk_init(&w);
+    lept_walk_push(&w, lhs)->rhs = rhs;
+    for (equal = 1; equal && w.depth > 0; ) {
+        lept_walk_frame* f = WALK_TOP(&w);
+        if (f->i < CHILD_COUNT(f->v)) {
+            const lept_value* l = CHILD(f->v, f->i);
+            const lept_value* r = f->v->type == LEPT_ARRAY ? &f->rhs->u.a.e[f->i] :
+                lept_find_object_value(f->rhs, f->v->u.o.m[f->i].k, f->v->u.o.m[f->i].klen);
+            f->i++;
+            equal = r != NULL && lept_is_equal_shallow(l, r);
+            if (equal && IS_CONTAINER(l))
+                lept_walk_push(&w, l)->rhs = r;
+        }
+        else
+            w.depth--;
+    }
+    lept_walk_free(&w);
+    return equal;
+}
+
 int lept_get_boolean(const lept_value *v) {
     assert(v != NULL && (v->type == LEPT_TRUE || v->type == LEPT_FALSE));
     return v->type == LEPT_TRUE;
@@ -571,6 +4277,10 @@ void lept_set_boolean(lept_value *v, int b) {
 
 double lept_get_number(const lept_value* v) {
     assert(v != NULL && v->type == LEPT_NUMBER);
+    if (v->flags & LEPT_INT64)
+        return (double)v->u.i;
+    if (v->flags & LEPT_UINT64)
+        return (double)v->u.ui;
     return v-> u.n;
 }
 
@@ -581,98 +4291,161 @@ void lept_set_number(lept_value *v, double n) {
     v->type = LEPT_NUMBER;
 }
 
+int lept_is_int64(const lept_value *v) {
+    assert(v != NULL && v->type == LEPT_NUMBER);
+    if (v->flags & LEPT_INT64)
+        return 1;
+    if (v->flags & LEPT_UINT64)
+        return 0;
+    return v->u.n >= -9223372036854775808.0 && v->u.n < 9223372036854775808.0 && v->u.n == (double)(int64_t)v->u.n;
+}
+
+int lept_is_uint64(const lept_value *v) {
+    assert(v != NULL && v->type == LEPT_NUMBER);
+    if (v->flags & LEPT_INT64)
+        return v->u.i >= 0;
+    if (v->flags & LEPT_UINT64)
+        return 1;
+    return v->u.n >= 0.0 && v->u.n < 18446744073709551616.0 && v->u.n == (double)(uint64_t)v->u.n;
+}
+
+int64_t lept_get_int64(const lept_value *v) {
+    assert(v != NULL && lept_is_int64(v));
+    return (v->flags & LEPT_INT64) ? v->u.i : (int64_t)v->u.n;
+}
+
+uint64_t lept_get_uint64(const lept_value *v) {
+    assert(v != NULL && lept_is_uint64(v));
+    if (v->flags & LEPT_INT64)
+        return (uint64_t)v->u.i;
+    return (v->flags & LEPT_UINT64) ? v->u.ui : (uint64_t)v->u.n;
+}
+
+void lept_set_int64(lept_value *v, int64_t i) {
+    assert(v != NULL);
+    lept_free(v);
+    v->u.i = i;
+    v->type = LEPT_NUMBER;
+    v->flags = LEPT_INT64;
+}
+
+void lept_set_uint64(lept_value *v, uint64_t u) {
+    assert(v != NULL);
+    lept_free(v);
+    if (u <= INT64_MAX)
+        lept_set_int64(v, (int64_t)u);
+    else {
+        v->u.ui = u;
+        v->type = LEPT_NUMBER;
+        v->flags = LEPT_UINT64;
+    }
+}
+
 const char* lept_get_string(const lept_value* v) {
     assert(v != NULL && v->type == LEPT_STRING);
-    return v->u.s.s;
+    return v->flags & LEPT_SHORT_STRING ? SHORT_STRING(v) : v->u.s.s;
 }
 
 size_t lept_get_string_length(const lept_value *v) {
     assert(v != NULL && v->type == LEPT_STRING);
-    return v->u.s.len;
+    if (v->flags & LEPT_SHORT_STRING)
+        return LEPT_SHORT_MAX - (unsigned char)SHORT_STRING(v)[LEPT_SHORT_MAX];
+    return S_LENGTH(v);
 }
 
 void lept_set_string(lept_value* v, const char* s, size_t len) {
     assert(v != NULL && (s != NULL || len == 0));
     lept_free(v);
-    v->u.s.s = (char*)malloc(len + 1);
-    memcpy(v->u.s.s, s, len);
-    v->u.s.s[len] = '\0';
-    v->u.s.len = len;
-    v->type = LEPT_STRING;
+    memcpy(lept_set_string_storage(v, len, NULL), s, len);
 }
 
 void lept_set_array(lept_value *v, size_t capacity) {
     assert(v != NULL);
+    assert(capacity <= LEPT_SIZE_MAX);
     lept_free(v);
     v->type = LEPT_ARRAY;
-    v->u.a.size = 0;
-    v->u.a.capacity = capacity;
-    v->u.a.e = capacity > 0 ? (lept_value*)malloc(capacity * sizeof(lept_value)) : NULL;
+    A_SIZE(v) = 0;
+    v->u.a.e = capacity > 0 ? (lept_value*)lept_buffer_alloc(NULL, capacity * sizeof(lept_value)) : NULL;
+    SET_A_CAPACITY(v, capacity);
 }
 
 size_t lept_get_array_size(const lept_value *v) {
     assert(v != NULL && v->type == LEPT_ARRAY);
-    return v->u.a.size;
+    return A_SIZE(v);
 }
 
 size_t lept_get_array_capacity(const lept_value *v) {
     assert(v != NULL && v->type == LEPT_ARRAY);
-    return v->u.a.capacity;
+    return A_CAPACITY(v);
+}
+
+/* Move the elements to owned storage for @capacity elements */
+static void lept_array_resize(lept_value* v, size_t capacity) {
+    assert(capacity <= LEPT_SIZE_MAX);
+    if (capacity == 0) {
+        if (!(v->flags & LEPT_BORROWED_BUFFER))
+            lept_buffer_free(v->u.a.e);
+        v->u.a.e = NULL;
+        v->flags &= ~LEPT_BORROWED_BUFFER;
+    }
+    else if (v->flags & LEPT_BORROWED_BUFFER) {
+        /* copy out of the arena on first growth */
+        lept_value* e = (lept_value*)lept_buffer_alloc(NULL, capacity * sizeof(lept_value));
+        if (A_SIZE(v) > 0)
+            memcpy(e, v->u.a.e, A_SIZE(v) * sizeof(lept_value));
+        v->u.a.e = e;
+        v->flags &= ~LEPT_BORROWED_BUFFER;
+    }
+    else
+        v->u.a.e = (lept_value*)lept_buffer_realloc(v->u.a.e, capacity * sizeof(lept_value));
+    SET_A_CAPACITY(v, capacity);
 }
 
 void lept_reserve_array(lept_value *v, size_t capacity) {
     assert(v != NULL && v->type == LEPT_ARRAY);
-    if (v->u.a.capacity < capacity) {
-        if (v->u.a.capacity == 0) {
-            v->u.a.e = (lept_value*)malloc(capacity * sizeof(lept_value));
-        } else {
-            v->u.a.e = (lept_value*)realloc(v->u.a.e, capacity * sizeof(lept_value));
-        }
-        v->u.a.capacity = capacity;
-    }
+    if (A_CAPACITY(v) < capacity)
+        lept_array_resize(v, capacity);
 }
 
 void lept_shrink_array(lept_value *v) {
     assert(v != NULL && v->type == LEPT_ARRAY);
-    if (v->u.a.capacity > v->u.a.size) {
-        v->u.a.capacity = v->u.a.size;
-        if (v->u.a.size != 0) {
-            v->u.a.e = (lept_value*)realloc(v->u.a.e, v->u.a.capacity * sizeof(lept_value));
-        } else {
-            free(v->u.a.e);
-        }
+    if (A_CAPACITY(v) > A_SIZE(v)) {
+        if ((v->flags & LEPT_BORROWED_BUFFER) && A_SIZE(v) > 0)
+            SET_A_CAPACITY(v, A_SIZE(v)); /* arena storage is released with the arena */
+        else
+            lept_array_resize(v, A_SIZE(v));
     }
 }
 
 void lept_clear_array(lept_value *v) {
     assert(v != NULL && v->type == LEPT_ARRAY);
-    lept_erase_array_element(v, 0, v->u.a.size);
+    lept_erase_array_element(v, 0, A_SIZE(v));
 }
 
 lept_value* lept_get_array_element(const lept_value* v, size_t index) {
     assert(v != NULL && v->type == LEPT_ARRAY);
-    assert(index < v->u.a.size);
+    assert(index < A_SIZE(v));
     return &v->u.a.e[index];
 }
 
 lept_value* lept_pushback_array_element(lept_value *v) {
     assert(v != NULL && v->type == LEPT_ARRAY);
-    if (v->u.a.size == v->u.a.capacity)
-        lept_reserve_array(v, v->u.a.capacity == 0 ? 1 : v->u.a.capacity * 2);
-    lept_init(&v->u.a.e[v->u.a.size]);
-    return &v->u.a.e[v->u.a.size++];
+    if (A_SIZE(v) == A_CAPACITY(v))
+        lept_reserve_array(v, A_CAPACITY(v) == 0 ? 1 : A_CAPACITY(v) * 2);
+    lept_init(&v->u.a.e[A_SIZE(v)]);
+    return &v->u.a.e[A_SIZE(v)++];
 }
 
 void lept_popback_array_element(lept_value *v) {
-    assert(v != NULL && v->type == LEPT_ARRAY && v->u.a.size > 0);
-    lept_free(&v->u.a.e[--v->u.a.size]);
+    assert(v != NULL && v->type == LEPT_ARRAY && A_SIZE(v) > 0);
+    lept_free(&v->u.a.e[--A_SIZE(v)]);
 }
 
 lept_value* lept_insert_array_element(lept_value *v, size_t index) {
     size_t i;
-    assert(v != NULL && v->type == LEPT_ARRAY && index <= v->u.a.size);
+    assert(v != NULL && v->type == LEPT_ARRAY && index <= A_SIZE(v));
     lept_pushback_array_element(v);
-    for (i = v->u.a.size-1; i > index; i--) {
+    for (i = A_SIZE(v)-1; i > index; i--) {
         lept_move(&v->u.a.e[i], &v->u.a.e[i-1]);
     }
     lept_init(&v->u.a.e[index]);
@@ -682,94 +4455,96 @@ lept_value* lept_insert_array_element(lept_value *v, size_t index) {
 
 void lept_erase_array_element(lept_value *v, size_t index, size_t count) {
     size_t i;
-    assert(v != NULL && v->type == LEPT_ARRAY && index + count <= v->u.a.size);
+    assert(v != NULL && v->type == LEPT_ARRAY && index + count <= A_SIZE(v));
     if (count == 0)
         return;
     for (i = 0; i < count; i++) {
         lept_free(&v->u.a.e[index+i]);
     }
-    for (i = index; i + count < v->u.a.size; i++) {
+    for (i = index; i + count < A_SIZE(v); i++) {
         lept_move(&v->u.a.e[i], &v->u.a.e[count+i]);
     }
-    v->u.a.size -= count;
+    A_SIZE(v) -= count;
 }
 
 void lept_set_object(lept_value *v, size_t capacity) {
     assert(v != NULL);
+    assert(capacity <= LEPT_SIZE_MAX);
     lept_free(v);
     v->type = LEPT_OBJECT;
-    v->u.o.size = 0;
-    v->u.o.capacity = capacity;
-    v->u.o.m = capacity > 0 ? (lept_member*)malloc(capacity * sizeof(lept_member)) : NULL;
+    O_SIZE(v) = 0;
+    v->u.o.m = capacity > 0 ? (lept_member*)lept_buffer_alloc(NULL, capacity * sizeof(lept_member)) : NULL;
+    SET_O_CAPACITY(v, capacity);
 }
 
 size_t lept_get_object_size(const lept_value *v) {
     assert(v != NULL && v->type == LEPT_OBJECT);
-    return v->u.o.size;
+    return O_SIZE(v);
 }
 
 size_t lept_get_object_capacity(const lept_value *v) {
     assert(v != NULL && v->type == LEPT_OBJECT);
-    return v->u.o.capacity;
+    return O_CAPACITY(v);
 }
 
 void lept_reserve_object(lept_value *v, size_t capacity) {
     assert(v != NULL && v->type == LEPT_OBJECT);
-    if (v->u.o.capacity < capacity) {
-        if (v->u.o.capacity == 0) {
-            v->u.o.m = (lept_member*)malloc(capacity * sizeof(lept_member));
-        } else {
-            v->u.o.m = (lept_member*)realloc(v->u.o.m, capacity * sizeof(lept_member));
-        }
-        v->u.o.capacity = capacity;
-    }
+    if (O_CAPACITY(v) < capacity)
+        lept_object_resize(v, capacity, (v->flags & LEPT_HASH_INDEX) != 0);
 }
 
 void lept_shrink_object(lept_value *v) {
     assert(v != NULL && v->type == LEPT_OBJECT);
-    if (v->u.o.capacity > v->u.o.size) {
-        v->u.o.capacity = v->u.o.size;
-        if (v->u.o.size != 0) {
-            v->u.o.m = (lept_member*)realloc(v->u.o.m, v->u.o.capacity * sizeof(lept_member));
-        } else {
-            free(v->u.o.m);
+    if (O_CAPACITY(v) > O_SIZE(v)) {
+        if (v->flags & LEPT_BORROWED_BUFFER) {
+            /* arena storage is released with the arena; a smaller index still fits in it */
+            SET_O_CAPACITY(v, O_SIZE(v));
+            if (v->flags & LEPT_HASH_INDEX)
+                lept_hash_rebuild(v);
         }
+        else
+            lept_object_resize(v, O_SIZE(v), (v->flags & LEPT_HASH_INDEX) != 0);
     }
 }
 
 void lept_clear_object(lept_value *v) {
     size_t i;
     assert(v != NULL && v->type == LEPT_OBJECT);
-    for (i = 0; i < v->u.o.size; i++) {
-        free(v->u.o.m[i].k);
+    for (i = 0; i < O_SIZE(v); i++) {
+        if (!(v->flags & LEPT_BORROWED_KEYS))
+            FREE(v->u.o.m[i].k);
         lept_free(&v->u.o.m[i].v);
     }
-    v->u.o.size = 0;
+    O_SIZE(v) = 0;
+    if (v->flags & LEPT_HASH_INDEX)
+        lept_hash_rebuild(v);
 }
 
 const char* lept_get_object_key(const lept_value *v, size_t index) {
     assert(v != NULL && v->type == LEPT_OBJECT);
-    assert(index < v->u.o.size);
+    assert(index < O_SIZE(v));
     return v->u.o.m[index].k;
 }
 
 size_t lept_get_object_key_length(const lept_value *v, size_t index) {
     assert(v != NULL && v->type == LEPT_OBJECT);
-    assert(index < v->u.o.size);
+    assert(index < O_SIZE(v));
     return v->u.o.m[index].klen;
 }
 
 lept_value* lept_get_object_value(const lept_value *v, size_t index) {
     assert(v != NULL && v->type == LEPT_OBJECT);
-    assert(index < v->u.o.size);
+    assert(index < O_SIZE(v));
     return &v->u.o.m[index].v;
 }
 
 size_t lept_find_object_index(const lept_value *v, const char *key, size_t klen) {
     size_t i;
     assert(v != NULL && v->type == LEPT_OBJECT && key != NULL);
-    for (i = 0; i < v->u.o.size; ++i)
-        if (v->u.o.m[i].klen == klen && memcmp(v->u.o.m[i].k, key, klen) == 0)
+    if (v->flags & LEPT_HASH_INDEX)
+        return lept_hash_find(v, key, klen);
+    for (i = 0; i < O_SIZE(v); ++i)
+        if (v->u.o.m[i].klen == klen && (v->u.o.m[i].k == key || memcmp(v->u.o.m[i].k, key, klen) == 0))
             return i;
     return LEPT_KEY_NOT_EXIST;
 }
@@ -779,33 +4554,87 @@ lept_value* lept_find_object_value(const lept_value *v, const char *key, size_t
     return index != LEPT_KEY_NOT_EXIST ? &v->u.o.m[index].v : NULL;
 }
 
+/* Add a member with key @k (already owned as the object owns its keys) */
+static lept_value* lept_object_append(lept_value* v, char* k, size_t klen) {
+    size_t size;
+    if (O_SIZE(v) == O_CAPACITY(v))
+        lept_reserve_object(v, O_CAPACITY(v) == 0 ? 1 : O_CAPACITY(v) * 2);
+    size = O_SIZE(v)++;
+    v->u.o.m[size].k = k;
+    v->u.o.m[size].klen = klen;
+    lept_init(&v->u.o.m[size].v);
+    if (v->flags & LEPT_HASH_INDEX)
+        lept_hash_insert(v, size);
+    else if (O_SIZE(v) >= LEPT_OBJECT_HASH_THRESHOLD)
+        lept_object_resize(v, O_CAPACITY(v), 1);
+    return &v->u.o.m[size].v;
+}
+
 lept_value* lept_set_object_value(lept_value *v, const char *key, size_t klen) {
-    size_t index, size;
+    size_t index;
+    char* k;
     assert(v != NULL && v->type == LEPT_OBJECT && key != NULL);
     if ((index = lept_find_object_index(v, key, klen)) != LEPT_KEY_NOT_EXIST) {
-        lept_init(&v->u.o.m[index].v);
+        lept_free(&v->u.o.m[index].v);
         return &v->u.o.m[index].v;
     }
 
-    lept_reserve_object(v, v->u.o.capacity == 0 ? 1 : v->u.o.capacity * 2);
-    size = v->u.o.size++;
-    v->u.o.m[size].k = (char*)malloc(klen + 1);
-    memcpy(v->u.o.m[size].k, key, klen);
-    v->u.o.m[size].k[klen] = '\0';
-    v->u.o.m[size].klen = klen;
-    lept_init(&v->u.o.m[size].v);
-    return &v->u.o.m[size].v;
+    if (v->flags & LEPT_BORROWED_KEYS) {
+        /* keys are owned all-or-nothing: take copies before adding a heap key */
+        for (index = 0; index < O_SIZE(v); index++) {
+            k = (char*)MALLOC(v->u.o.m[index].klen + 1);
+            memcpy(k, v->u.o.m[index].k, v->u.o.m[index].klen + 1);
+            v->u.o.m[index].k = k;
+        }
+        v->flags &= ~(LEPT_BORROWED_KEYS | LEPT_POOLED_KEYS);
+    }
+    k = (char*)MALLOC(klen + 1);
+    memcpy(k, key, klen);
+    k[klen] = '\0';
+    return lept_object_append(v, k, klen);
+}
+
+lept_value* lept_set_object_value_pooled(lept_value *v, lept_key_pool *pool, const char *key, size_t klen) {
+    size_t index;
+    assert(v != NULL && v->type == LEPT_OBJECT && pool != NULL && key != NULL);
+    key = lept_key_pool_intern(pool, key, klen);
+    if ((index = lept_find_object_index(v, key, klen)) != LEPT_KEY_NOT_EXIST) {
+        lept_free(&v->u.o.m[index].v);
+        return &v->u.o.m[index].v;
+    }
+
+    if (!(v->flags & LEPT_POOLED_KEYS)) {
+        /* keys are owned all-or-nothing: move the existing ones into the pool */
+        for (index = 0; index < O_SIZE(v); index++) {
+            const char* k = lept_key_pool_intern(pool, v->u.o.m[index].k, v->u.o.m[index].klen);
+            if (!(v->flags & LEPT_BORROWED_KEYS))
+                FREE(v->u.o.m[index].k);
+            v->u.o.m[index].k = (char*)k;
+        }
+        v->flags |= LEPT_BORROWED_KEYS | LEPT_POOLED_KEYS;
+    }
+    return lept_object_append(v, (char*)key, klen);
+}
+
+void lept_index_object(lept_value *v) {
+    assert(v != NULL && v->type == LEPT_OBJECT);
+    if (!(v->flags & LEPT_HASH_INDEX))
+        lept_object_resize(v, O_CAPACITY(v) > 0 ? O_CAPACITY(v) : 1, 1);
 }
 
 void lept_remove_object_value(lept_value *v, size_t index) {
     size_t i;
-    assert(v != NULL && v->type == LEPT_OBJECT && index < v->u.o.size);
-    free(v->u.o.m[index].k);
+    assert(v != NULL && v->type == LEPT_OBJECT && index < O_SIZE(v));
+    if (!(v->flags & LEPT_BORROWED_KEYS))
+        FREE(v->u.o.m[index].k);
     lept_free(&v->u.o.m[index].v);
 
-    for (i = index; i < v->u.o.size - 1; i++) {
+    for (i = index; i < O_SIZE(v) - 1; i++) {
         v->u.o.m[i].k = v->u.o.m[i+1].k;
+        v->u.o.m[i].klen = v->u.o.m[i+1].klen;
         lept_move(&v->u.o.m[i].v, &v->u.o.m[i+1].v);
     }
-    v->u.o.size--;
+    O_SIZE(v)--;
+    if (v->flags & LEPT_HASH_INDEX)
+        lept_hash_rebuild(v);
 }
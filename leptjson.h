@@ -2,6 +2,8 @@
 #define LEPTJSON_H__
 
 #include <stddef.h> /* size_t */
+#include <stdio.h>  /* FILE */
+#include <stdint.h> /* int64_t, uint64_t */
 
 typedef enum { LEPT_NULL, LEPT_FALSE, LEPT_TRUE, LEPT_NUMBER, LEPT_STRING, LEPT_ARRAY, LEPT_OBJECT } lept_type;
 
@@ -10,15 +12,39 @@ extern const char* LEPT_TYPES[];
 typedef struct lept_value lept_value;
 typedef struct lept_member lept_member;
 
+#ifdef LEPT_COMPACT
+/*
+ * Compact layout, 16 bytes on 64-bit targets: the capacity of an array or
+ * object is kept in front of its element buffer and sizes are 32 bits wide.
+ * Define LEPT_COMPACT for the library and its users alike.
+ */
+struct lept_value {
+    union {
+        struct { lept_member* m; } o; /* object */
+        struct { lept_value* e; } a;  /* array */
+        struct { char* s; } s;        /* string: null-terminated string */
+        double n;                     /* number */
+        int64_t i;                    /* number stored as an integer, see lept_is_int64() */
+        uint64_t ui;                  /* number stored as an integer above INT64_MAX */
+    } u;
+    uint32_t size;       /* string length, array/object size */
+    unsigned char type;  /* lept_type */
+    unsigned char flags; /* ownership of the storage, see leptjson.c */
+};
+#else
 struct lept_value {
     union {
         struct { lept_member* m; size_t size, capacity; } o; /* object */
         struct { lept_value* e; size_t size, capacity; } a;   /* array */
         struct { char* s; size_t len; } s; /* string: null-terminated string, string length */
         double n;                          /* number */
+        int64_t i;                         /* number stored as an integer, see lept_is_int64() */
+        uint64_t ui;                       /* number stored as an integer above INT64_MAX */
     } u;
     lept_type type;
+    unsigned char flags; /* ownership of the storage, see leptjson.c */
 };
+#endif
 
 struct lept_member {
     char* k; size_t klen; /* member key string, key string length */
@@ -39,18 +65,294 @@ enum {
     LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET,
     LEPT_PARSE_MISS_KEY,
     LEPT_PARSE_MISS_COLON,
-    LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET
+    LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET,
+    LEPT_PARSE_ABORTED,
+    LEPT_PARSE_WRONG_TYPE,
+    LEPT_PARSE_TOO_DEEP,
+    LEPT_PARSE_FILE_ERROR
 };
 
 #define LEPT_KEY_NOT_EXIST ((size_t)-1)
 
-#define lept_init(v) do { (v)->type = LEPT_NULL; } while(0)
+#define lept_init(v) do { (v)->type = LEPT_NULL; (v)->flags = 0; } while(0)
 
 extern const char* PARSE_RESULTS[];
 
 int lept_parse(lept_value *v, const char *json);
+/*
+ * Parse exactly @len bytes, which need not be NUL-terminated; nothing past
+ * json[len - 1] is read. @consumed (may be NULL) receives the offset at which
+ * parsing stopped: @len on success, the position of the problem otherwise.
+ */
+int lept_parse_n(lept_value *v, const char *json, size_t len, size_t *consumed);
+
+/* Parse engines; both build the same tree and report the same errors */
+enum {
+    LEPT_ENGINE_RECURSIVE = 0, /* recursive descent, one token at a time */
+    LEPT_ENGINE_INDEXED        /* SIMD structural index first, then the tree from the index */
+};
+
+typedef struct lept_key_pool lept_key_pool;
+
+typedef struct {
+    int engine;
+    lept_key_pool* keys; /* intern member keys into this pool, NULL to copy them */
+    /*
+     * A large root array is parsed on this many threads (0 for one per CPU):
+     * it is cut between elements and the slices are parsed side by side. The
+     * tree and the errors are those of the serial parser. 1, the default,
+     * stays on the calling thread; so do parses into a key pool.
+     */
+    size_t threads;
+    /*
+     * Arrays and objects nested deeper than this fail with
+     * LEPT_PARSE_TOO_DEEP; 0, the default, sets no limit. Nesting never
+     * uses C stack, so the limit is about the size of the tree only.
+     */
+    size_t max_depth;
+} lept_parse_options;
+
+void lept_parse_options_init(lept_parse_options *options);
+/* Parse @len bytes with @options (NULL for the defaults) */
+int lept_parse_ex(lept_value *v, const char *json, size_t len, const lept_parse_options *options);
+
+/*
+ * Parser handle: lept_parse_ex() with options of its own and a scratch stack
+ * that is kept from one parse to the next, so a stream of small documents
+ * does not grow and free a stack each time. A stack that grew past
+ * @stack_limit bytes (0 for the default) is cut back to it after the parse.
+ * One handle serves one thread at a time.
+ */
+typedef struct lept_parser lept_parser;
+
+lept_parser* lept_parser_new(const lept_parse_options *options, size_t stack_limit); /* NULL for the defaults */
+lept_parse_options* lept_parser_options(lept_parser *p); /* may be changed between parses */
+size_t lept_parser_stack_size(const lept_parser *p);
+int lept_parser_parse(lept_parser *p, lept_value *v, const char *json, size_t len);
+void lept_parser_free(lept_parser *p);
+
+/*
+ * lept_parse_ex() of the whole file at @path. A regular file is mapped
+ * read-only with a sequential-access hint and parsed in place, so loading
+ * is bound by the page cache rather than by copying; it must not shrink
+ * during the call. Other files are read into a temporary buffer.
+ * LEPT_PARSE_FILE_ERROR when the file cannot be opened or read.
+ */
+int lept_parse_file(lept_value *v, const char *path, const lept_parse_options *options);
 char* lept_stringify(const lept_value* v, size_t* length);
 
+/* Exact length of the lept_stringify() output, not counting the NUL */
+size_t lept_stringify_length(const lept_value* v);
+/*
+ * Stringify into @buffer without allocating. Returns the length of the whole
+ * output like snprintf(): when it is less than @capacity the output is in
+ * @buffer, NUL-terminated; otherwise the buffer was too small and its
+ * contents are unspecified. @buffer may be NULL when @capacity is 0.
+ */
+size_t lept_stringify_buffer(const lept_value* v, char* buffer, size_t capacity);
+
+/*
+ * Streaming stringify: the output is handed to @write in pieces of about
+ * LEPT_WRITE_BUFFER_SIZE bytes as it is produced, so memory use does not grow
+ * with the document. @write returns non-zero on success; after a failure
+ * nothing more is written and LEPT_STRINGIFY_WRITE_ERROR is returned.
+ */
+typedef int (*lept_write_func)(void* ctx, const char* data, size_t len);
+
+enum {
+    LEPT_STRINGIFY_OK = 0,
+    LEPT_STRINGIFY_WRITE_ERROR
+};
+
+int lept_stringify_to(const lept_value* v, lept_write_func write, void* ctx);
+int lept_stringify_file(const lept_value* v, FILE* fp);
+/*
+ * Create or truncate the file at @path and stream the output into it through
+ * the LEPT_WRITE_BUFFER_SIZE buffer. LEPT_STRINGIFY_WRITE_ERROR also when the
+ * file cannot be opened or closed.
+ */
+int lept_stringify_path(const lept_value* v, const char* path);
+#if defined(__unix__) || defined(__APPLE__)
+#define LEPT_HAVE_FD
+int lept_stringify_fd(const lept_value* v, int fd); /* retries short writes and EINTR */
+#endif
+
+/*
+ * Allocator hooks. The global allocator backs every value and, unless a call
+ * is given its own, every parse stack and stringify buffer. It must not be
+ * changed while values allocated with the previous one are alive.
+ * realloc() and free() are never called with NULL.
+ */
+typedef struct {
+    void* (*alloc)(void* ctx, size_t size);
+    void* (*realloc)(void* ctx, void* ptr, size_t size);
+    void (*free)(void* ctx, void* ptr);
+    void* ctx; /* user context passed to the hooks */
+} lept_allocator;
+
+void lept_set_allocator(const lept_allocator *allocator); /* NULL restores malloc() */
+const lept_allocator* lept_get_allocator(void);
+
+/* Per-call allocator for the scratch stack; the tree uses the global allocator */
+int lept_parse_with(lept_value *v, const char *json, const lept_allocator *allocator);
+/* Output is allocated with (and must be released through) the given allocator */
+char* lept_stringify_with(const lept_value* v, size_t* length, const lept_allocator *allocator);
+
+/*
+ * Arena: a bump allocator that owns every string, key and array/object buffer
+ * parsed into it. lept_arena_free() releases the whole region at once, so a
+ * tree parsed with lept_parse_arena() can be dropped without lept_free().
+ * Values still support the mutation API; storage they acquire afterwards comes
+ * from the heap, so call lept_free() on the root first if the tree was changed.
+ */
+typedef struct lept_arena_block lept_arena_block;
+
+typedef struct {
+    lept_arena_block* blocks; /* current block first */
+    size_t block_size;        /* size of a regular block */
+    lept_allocator allocator; /* where blocks come from */
+} lept_arena;
+
+/* 0 for the default block size, NULL for the global allocator */
+void lept_arena_init(lept_arena *a, size_t block_size, const lept_allocator *allocator);
+void lept_arena_free(lept_arena *a);
+int lept_parse_arena(lept_arena *a, lept_value *v, const char *json);
+
+/*
+ * Key pool: stores each distinct member key once, with its length and hash,
+ * until lept_key_pool_free(). Objects parsed with lept_parse_options.keys or
+ * filled through lept_set_object_value_pooled() point at the pooled keys
+ * instead of owning copies. Any number of documents may share one pool, but
+ * it must outlive every value that points into it, and it is not thread-safe:
+ * parses into a pool stay on the calling thread. Lookups match keys by
+ * pointer before comparing their bytes.
+ */
+struct lept_key_pool {
+    lept_arena arena;   /* key storage */
+    const char** slots; /* open-addressing table of the pooled keys */
+    size_t buckets, count;
+};
+
+/* NULL for the global allocator */
+void lept_key_pool_init(lept_key_pool *pool, const lept_allocator *allocator);
+void lept_key_pool_free(lept_key_pool *pool);
+/* The pooled, NUL-terminated copy of @key, added if it is new */
+const char* lept_key_pool_intern(lept_key_pool *pool, const char *key, size_t klen);
+
+/*
+ * In-situ parsing: strings and member keys are unescaped in place inside
+ * @json, NUL-terminated there and referenced by the tree without being
+ * copied. The buffer must outlive the tree; its contents are unspecified
+ * after the call.
+ */
+int lept_parse_insitu(lept_value *v, char *json);
+
+/*
+ * Newline-delimited JSON (NDJSON, JSON Lines): every line of @json is parsed
+ * as a document of its own, spread over @threads worker threads (0 for one
+ * per CPU, 1 to stay on the calling thread). Blank lines are skipped. The
+ * records come back in input order in *@records, each with its own result;
+ * the global allocator must be safe to call from several threads.
+ */
+typedef struct {
+    lept_value v;  /* the document, LEPT_NULL when the line failed */
+    int result;    /* LEPT_PARSE_OK or the error of the line */
+    size_t offset; /* where the line starts in @json */
+} lept_record;
+
+/* Returns the number of records; release them with lept_free_records() */
+size_t lept_parse_ndjson(const char *json, size_t len, size_t threads, lept_record **records);
+/*
+ * Every line parsed with @options (NULL for the defaults); their threads
+ * field is ignored, as the lines already run side by side. A batch into a
+ * key pool stays on the calling thread.
+ */
+size_t lept_parse_ndjson_ex(const char *json, size_t len, size_t threads, const lept_parse_options *options,
+                            lept_record **records);
+void lept_free_records(lept_record *records, size_t count);
+
+/*
+ * lept_stringify() of a large array or object on @threads threads (0 for one
+ * per CPU): its elements or members are stringified in runs side by side and
+ * joined in order, so the output is byte for byte that of lept_stringify().
+ * Only one container is split: the root, or a container below it that holds
+ * most of the work. Values too small to split stay on the calling thread.
+ */
+char* lept_stringify_parallel(const lept_value* v, size_t* length, size_t threads);
+
+/*
+ * Event (SAX) parsing: the document is validated and reported through
+ * callbacks in order, without building a tree. Every callback may be NULL and
+ * returns non-zero to continue; returning 0 stops the parse with
+ * LEPT_PARSE_ABORTED. Strings and keys are not NUL-terminated and are only
+ * valid during the call. Events already delivered stand even if the parse
+ * fails later on.
+ */
+typedef struct {
+    int (*null)(void* ctx);
+    int (*boolean)(void* ctx, int b);
+    int (*number)(void* ctx, const lept_value* n); /* a LEPT_NUMBER, see lept_is_int64() */
+    int (*string)(void* ctx, const char* s, size_t len);
+    int (*start_array)(void* ctx);
+    int (*end_array)(void* ctx, size_t count);
+    int (*start_object)(void* ctx);
+    int (*key)(void* ctx, const char* s, size_t len);
+    int (*end_object)(void* ctx, size_t count);
+} lept_sax_handler;
+
+int lept_parse_sax(const char *json, size_t len, const lept_sax_handler *handler, void *ctx);
+
+/*
+ * Push parsing: the document is fed in chunks that may split it anywhere.
+ * feed() returns the first error as soon as it is known and keeps returning
+ * it; finish() marks the end of input and moves the tree into @v. The parser
+ * is then ready for the next document.
+ */
+typedef struct lept_push_parser lept_push_parser;
+
+lept_push_parser* lept_push_parser_new(void);
+int lept_push_parser_feed(lept_push_parser *p, const char *json, size_t len);
+int lept_push_parser_finish(lept_push_parser *p, lept_value *v);
+void lept_push_parser_free(lept_push_parser *p);
+
+/*
+ * Pull cursor: reads the input in place and only converts what is asked for.
+ * The cursor stands before a value; a get/skip/enter call consumes it. Inside
+ * a container, next_element()/next_member() step to the next value (skipping
+ * the current one if it was not read) and report the end of the container
+ * with *more == 0 or *key == NULL. They always step in the innermost container
+ * entered and not yet ended: to go on with an outer one before the end of an
+ * inner one, leave_array()/leave_object() skip the rest of the inner one.
+ * find_key() searches forward for a member and leaves the object when there
+ * is none. Strings and keys handed out are not NUL-terminated and are only
+ * valid until the next call. Calls return LEPT_PARSE_OK, the lept_parse()
+ * error for malformed input, or LEPT_PARSE_WRONG_TYPE; finish() checks that
+ * nothing but whitespace is left. The fields are private.
+ */
+typedef struct {
+    const char* json;      /* position */
+    const char* end;
+    char* stack;           /* scratch for unescaped strings */
+    size_t size;
+    int first, pending;    /* just entered a container; a value is unread */
+} lept_cursor;
+
+void lept_cursor_init(lept_cursor *cur, const char *json, size_t len);
+void lept_cursor_free(lept_cursor *cur);
+int lept_cursor_peek(lept_cursor *cur, lept_type *type);
+int lept_cursor_enter_array(lept_cursor *cur);
+int lept_cursor_next_element(lept_cursor *cur, int *more);
+int lept_cursor_enter_object(lept_cursor *cur);
+int lept_cursor_next_member(lept_cursor *cur, const char **key, size_t *klen);
+int lept_cursor_find_key(lept_cursor *cur, const char *key, size_t klen, int *found);
+int lept_cursor_leave_array(lept_cursor *cur);
+int lept_cursor_leave_object(lept_cursor *cur);
+int lept_cursor_get_number(lept_cursor *cur, double *n);
+int lept_cursor_get_string(lept_cursor *cur, const char **s, size_t *len);
+int lept_cursor_get_value(lept_cursor *cur, lept_value *v);
+int lept_cursor_skip(lept_cursor *cur);
+int lept_cursor_finish(lept_cursor *cur);
+
 void lept_copy(lept_value *dst, const lept_value *src);
 void lept_move(lept_value *dst, lept_value *src);
 void lept_swap(lept_value *lhs, lept_value *rhs);
@@ -65,9 +367,26 @@ int lept_is_equal(const lept_value *lhs, const lept_value *rhs);
 int lept_get_boolean(const lept_value *v);
 void lept_set_boolean(lept_value *v, int b);
 
+/*
+ * Integer literals that fit are kept exactly as int64_t or uint64_t; every
+ * number can still be read as a double. lept_is_int64()/lept_is_uint64() tell
+ * whether the number is an integer representable in that type, whatever its
+ * storage; the integer getters require it.
+ */
 double lept_get_number(const lept_value* v);
 void lept_set_number(lept_value *v, double n);
+int lept_is_int64(const lept_value *v);
+int lept_is_uint64(const lept_value *v);
+int64_t lept_get_int64(const lept_value *v);
+uint64_t lept_get_uint64(const lept_value *v);
+void lept_set_int64(lept_value *v, int64_t i);
+void lept_set_uint64(lept_value *v, uint64_t u);
 
+/*
+ * Strings short enough to fit in the value itself are stored there without a
+ * separate allocation, so the pointer returned here moves with the value
+ * (lept_move(), lept_swap(), array/object growth).
+ */
 const char *lept_get_string(const lept_value *v);
 size_t lept_get_string_length(const lept_value *v);
 void lept_set_string(lept_value *v, const char* s, size_t len);
@@ -96,6 +415,14 @@ lept_value* lept_get_object_value(const lept_value *v, size_t index);
 size_t lept_find_object_index(const lept_value *v, const char *key, size_t klen);
 lept_value* lept_find_object_value(const lept_value *v, const char *key, size_t klen);
 lept_value* lept_set_object_value(lept_value *v, const char *key, size_t klen);
+/* Like lept_set_object_value(), with the keys of @v moved into @pool */
+lept_value* lept_set_object_value_pooled(lept_value *v, lept_key_pool *pool, const char *key, size_t klen);
 void lept_remove_object_value(lept_value *v, size_t index);
+/*
+ * Give @v a hash index for lept_find_object_index() now. Objects get one by
+ * themselves once they reach LEPT_OBJECT_HASH_THRESHOLD members; it is kept
+ * up to date by every object function and dropped with the member storage.
+ */
+void lept_index_object(lept_value *v);
 
 #endif /* LEPTJSON_H__ */
@@ -3,6 +3,10 @@
 #include <string.h>
 
 #include "leptjson.h"
+#if defined(LEPT_HAVE_FD)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 static int main_ret = 0;
 static int test_count = 0;
@@ -39,6 +43,197 @@ static int test_pass = 0;
 
 #define EXPECT_EQ_TYPE(expect, actual) EXPECT_EQ_BASE((expect) == (actual), LEPT_TYPES[expect], LEPT_TYPES[actual], "%s")
 
+/* The indexed engine must agree with lept_parse() on both the result and the tree */
+static int same_as_indexed(const char* json) {
+    lept_parse_options options;
+    lept_value v1, v2;
+    int same;
+    lept_parse_options_init(&options);
+    options.engine = LEPT_ENGINE_INDEXED;
+    lept_init(&v1);
+    lept_init(&v2);
+    same = lept_parse(&v1, json) == lept_parse_ex(&v2, json, strlen(json), &options) &&
+        lept_get_type(&v1) == lept_get_type(&v2) && lept_is_equal(&v1, &v2);
+    lept_free(&v1);
+    lept_free(&v2);
+    return same;
+}
+
+#define EXPECT_SAME_ENGINES(json) EXPECT_EQ_BASE(same_as_indexed(json), "same", "different", "%s")
+
+/* A SAX handler that writes the events back out as JSON */
+typedef struct {
+    char json[1024];
+    size_t len;
+    int first[64]; /* no element written yet at this depth */
+    int depth, after_key;
+    int events, abort_at; /* stop on event number abort_at (0 for never) */
+} sax_writer;
+
+static int sax_put(sax_writer* w, const char* s, size_t len, int value) {
+    if (value) {
+        if (!w->after_key && w->depth > 0 && !w->first[w->depth])
+            w->json[w->len++] = ',';
+        w->first[w->depth] = 0;
+        w->after_key = 0;
+    }
+    memcpy(w->json + w->len, s, len);
+    w->len += len;
+    return ++w->events != w->abort_at;
+}
+
+static int sax_put_value(sax_writer* w, const lept_value* v) {
+    size_t len;
+    char* json = lept_stringify(v, &len);
+    int ret = sax_put(w, json, len, 1);
+    free(json);
+    return ret;
+}
+
+static int sax_null(void* ctx) { return sax_put((sax_writer*)ctx, "null", 4, 1); }
+static int sax_boolean(void* ctx, int b) { return sax_put((sax_writer*)ctx, b ? "true" : "false", b ? 4 : 5, 1); }
+static int sax_number(void* ctx, const lept_value* n) { return sax_put_value((sax_writer*)ctx, n); }
+
+static int sax_string(void* ctx, const char* s, size_t len) {
+    lept_value v;
+    int ret;
+    lept_init(&v);
+    lept_set_string(&v, s, len);
+    ret = sax_put_value((sax_writer*)ctx, &v);
+    lept_free(&v);
+    return ret;
+}
+
+static int sax_start(sax_writer* w, const char* bracket) {
+    int ret = sax_put(w, bracket, 1, 1);
+    w->first[++w->depth] = 1;
+    return ret;
+}
+
+static int sax_start_array(void* ctx) { return sax_start((sax_writer*)ctx, "["); }
+static int sax_start_object(void* ctx) { return sax_start((sax_writer*)ctx, "{"); }
+static int sax_end_array(void* ctx, size_t count) { (void)count; ((sax_writer*)ctx)->depth--; return sax_put((sax_writer*)ctx, "]", 1, 0); }
+static int sax_end_object(void* ctx, size_t count) { (void)count; ((sax_writer*)ctx)->depth--; return sax_put((sax_writer*)ctx, "}", 1, 0); }
+
+static int sax_key(void* ctx, const char* s, size_t len) {
+    sax_writer* w = (sax_writer*)ctx;
+    int ret = sax_string(ctx, s, len);
+    w->json[w->len++] = ':';
+    w->after_key = 1;
+    return ret;
+}
+
+static const lept_sax_handler sax_writer_handler = {
+    sax_null, sax_boolean, sax_number, sax_string,
+    sax_start_array, sax_end_array, sax_start_object, sax_key, sax_end_object
+};
+
+/* The event parser must report the same result as lept_parse(), and events that rebuild the same tree */
+static int same_as_sax(const char* json) {
+    sax_writer w;
+    lept_value v;
+    char* expect;
+    size_t len;
+    int result, same;
+    memset(&w, 0, sizeof(w));
+    lept_init(&v);
+    result = lept_parse(&v, json);
+    same = result == lept_parse_sax(json, strlen(json), &sax_writer_handler, &w);
+    if (same && result == LEPT_PARSE_OK) {
+        expect = lept_stringify(&v, &len);
+        same = len == w.len && memcmp(expect, w.json, len) == 0;
+        free(expect);
+    }
+    lept_free(&v);
+    return same;
+}
+
+#define EXPECT_SAME_SAX(json) EXPECT_EQ_BASE(same_as_sax(json), "same", "different", "%s")
+
+/* Feed @json to the push parser in chunks of @step bytes, the first one @first bytes long */
+static int push_parse(lept_push_parser* p, lept_value* v, const char* json, size_t first, size_t step) {
+    size_t len = strlen(json), i = 0, n = first;
+    int ret = LEPT_PARSE_OK;
+    while (ret == LEPT_PARSE_OK && i < len) {
+        if (n > len - i)
+            n = len - i;
+        ret = lept_push_parser_feed(p, json + i, n);
+        i += n;
+        n = step;
+    }
+    return lept_push_parser_finish(p, v); /* repeats an error from feed() */
+}
+
+/* The push parser must agree with lept_parse() however the input is split */
+static int same_as_push(const char* json) {
+    lept_push_parser* p = lept_push_parser_new();
+    lept_value v1, v2;
+    size_t len = strlen(json), i;
+    int result, same = 1;
+    lept_init(&v1);
+    result = lept_parse(&v1, json);
+    for (i = 0; i <= len + 1 && same; i++) {
+        /* one split at i, or one byte at a time for the last round */
+        int ret = i <= len ? push_parse(p, &v2, json, i, len) : push_parse(p, &v2, json, 1, 1);
+        same = ret == result && (ret != LEPT_PARSE_OK || lept_is_equal(&v1, &v2));
+        lept_free(&v2);
+    }
+    lept_free(&v1);
+    lept_push_parser_free(p);
+    return same;
+}
+
+#define EXPECT_SAME_PUSH(json) EXPECT_EQ_BASE(same_as_push(json), "same", "different", "%s")
+
+/* Build the tree at the cursor through the iteration calls */
+static int cursor_build(lept_cursor* cur, lept_value* v) {
+    lept_type type;
+    const char* key;
+    size_t klen;
+    int ret, more;
+    if ((ret = lept_cursor_peek(cur, &type)) != LEPT_PARSE_OK)
+        return ret;
+    if (type == LEPT_ARRAY) {
+        lept_set_array(v, 0);
+        if ((ret = lept_cursor_enter_array(cur)) != LEPT_PARSE_OK)
+            return ret;
+        while ((ret = lept_cursor_next_element(cur, &more)) == LEPT_PARSE_OK && more)
+            if ((ret = cursor_build(cur, lept_pushback_array_element(v))) != LEPT_PARSE_OK)
+                return ret;
+        return ret;
+    }
+    if (type == LEPT_OBJECT) {
+        lept_set_object(v, 0);
+        if ((ret = lept_cursor_enter_object(cur)) != LEPT_PARSE_OK)
+            return ret;
+        while ((ret = lept_cursor_next_member(cur, &key, &klen)) == LEPT_PARSE_OK && key)
+            if ((ret = cursor_build(cur, lept_set_object_value(v, key, klen))) != LEPT_PARSE_OK)
+                return ret;
+        return ret;
+    }
+    return lept_cursor_get_value(cur, v);
+}
+
+/* Walking the whole document with a cursor must agree with lept_parse() */
+static int same_as_cursor(const char* json) {
+    lept_cursor cur;
+    lept_value v1, v2;
+    int result, ret, same;
+    lept_init(&v1);
+    lept_init(&v2);
+    result = lept_parse(&v1, json);
+    lept_cursor_init(&cur, json, strlen(json));
+    if ((ret = cursor_build(&cur, &v2)) == LEPT_PARSE_OK)
+        ret = lept_cursor_finish(&cur);
+    same = ret == result && (ret != LEPT_PARSE_OK || lept_is_equal(&v1, &v2));
+    lept_cursor_free(&cur);
+    lept_free(&v1);
+    lept_free(&v2);
+    return same;
+}
+
+#define EXPECT_SAME_CURSOR(json) EXPECT_EQ_BASE(same_as_cursor(json), "same", "different", "%s")
+
 static void test_parse_null() {
     lept_value v;
     lept_init(&v);
@@ -73,6 +268,8 @@ static void test_parse_false() {
         lept_value v;                                           \
         lept_init(&v);                                          \
         EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse(&v, json));  \
+        EXPECT_SAME_ENGINES(json);                              \
+        EXPECT_SAME_PUSH(json);                                 \
         EXPECT_EQ_TYPE(LEPT_NUMBER, lept_get_type(&v));         \
         EXPECT_EQ_DOUBLE(expect, lept_get_number(&v));          \
         lept_free(&v);                                          \
@@ -107,6 +304,18 @@ static void test_parse_number() {
     TEST_NUMBER(-2.2250738585072014E-308, "-2.2250738585072014E-308");
     TEST_NUMBER(1.7976931348623157E308, "1.7976931348623157E308");   /* max double */
     TEST_NUMBER(-1.7976931348623157E308, "-1.7976931348623157E308");
+    TEST_NUMBER(0.1, "0.1");
+    TEST_NUMBER(0.3, "0.3");
+    TEST_NUMBER(1e23, "1e23");
+    TEST_NUMBER(0.0, "0e1000000");
+    TEST_NUMBER(0.0, "1e-99999999999999999999");                     /* exponent overflows any integer */
+    TEST_NUMBER(2.2250738585072011E-308, "2.2250738585072011E-308");
+    TEST_NUMBER(9007199254740992.0, "9007199254740993");             /* halfway, round to even */
+    TEST_NUMBER(9007199254740994.0, "9007199254740993.0000000000000000001"); /* decided by a dropped digit */
+    TEST_NUMBER(1.2345678901234568E29, "123456789012345678901234567890");
+    TEST_NUMBER(-1.5041279056889391E19, "-15041279056889391104");    /* 20 digits, below INT64_MIN */
+    TEST_NUMBER(1.2345678901234568E-21, "0.0000000000000000000012345678901234567890");
+    TEST_NUMBER(1.7976931348623157E308, "179769313486231570000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000.0");
 }
 
 #define TEST_STRING(expect, json)                                       \
@@ -114,6 +323,8 @@ static void test_parse_number() {
         lept_value v;                                                   \
         lept_init(&v);                                                  \
         EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse(&v, json));          \
+        EXPECT_SAME_ENGINES(json);                                      \
+        EXPECT_SAME_PUSH(json);                                         \
         EXPECT_EQ_TYPE(LEPT_STRING, lept_get_type(&v));                 \
         EXPECT_EQ_STRING(expect, lept_get_string(&v), lept_get_string_length(&v)); \
         lept_free(&v);                                                  \
@@ -132,6 +343,36 @@ static void test_parse_string() {
     TEST_STRING("\xF0\x9D\x84\x9E", "\"\\ud834\\udd1e\"");  /* G clef sign U+1D11E */
 }
 
+/* Exercise the block-wise string scanner with specials at every offset */
+static void test_parse_long_string() {
+    char json[80], expect[80];
+    size_t i, j;
+    for (i = 0; i < 70; i++) {
+        lept_value v;
+        char* p = json;
+        *p++ = '"';
+        for (j = 0; j < 70; j++) {
+            if (j == i) {
+                *p++ = '\\';
+                *p++ = 'n';
+                expect[j] = '\n';
+            } else
+                *p++ = expect[j] = (char)(j % 2 ? 'a' + j % 26 : 0xC3 + j % 2);
+        }
+        *p++ = '"';
+        *p = '\0';
+        lept_init(&v);
+        EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse(&v, json));
+        EXPECT_TRUE(lept_get_string_length(&v) == 70 && memcmp(lept_get_string(&v), expect, 70) == 0);
+        lept_free(&v);
+        json[i + 1] = '\x1F';
+        EXPECT_EQ_RESULT(LEPT_PARSE_INVALID_STRING_CHAR, lept_parse(&v, json));
+        json[i + 1] = '\0';
+        EXPECT_EQ_RESULT(LEPT_PARSE_MISS_QUOTATION_MARK, lept_parse(&v, json));
+        lept_free(&v);
+    }
+}
+
 static void test_parse_array() {
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wformat"
@@ -254,10 +495,56 @@ static void test_parse_object() {
         lept_init(&v);                                  \
         v.type = LEPT_FALSE;                            \
         EXPECT_EQ_RESULT(error, lept_parse(&v, json));  \
+        EXPECT_SAME_ENGINES(json);                      \
+        EXPECT_SAME_SAX(json);                          \
+        EXPECT_SAME_PUSH(json);                         \
+        EXPECT_SAME_CURSOR(json);                       \
         EXPECT_EQ_TYPE(LEPT_NULL, lept_get_type(&v));   \
         lept_free(&v);                                  \
     } while(0)
 
+static void test_parse_whitespace() {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat"
+    lept_value v;
+    lept_init(&v);
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse(&v, " \t\r\nnull\n"));
+    EXPECT_EQ_TYPE(LEPT_NULL, lept_get_type(&v));
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse(&v,
+        "{\n"
+        "    \"a\": [\n"
+        "        1,\r\n"
+        "\t\t2\n"
+        "                                                                ]\n"
+        "}\n"));
+    EXPECT_EQ_SIZE_T(2, lept_get_array_size(lept_find_object_value(&v, "a", 1)));
+    lept_free(&v);
+    TEST_PARSE_ERROR(LEPT_PARSE_EXPECT_VALUE, "\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n");
+    TEST_PARSE_ERROR(LEPT_PARSE_ROOT_NOT_SINGULAR, "null                                  \fx");
+#pragma GCC diagnostic pop
+}
+
+/* Stage 1 carries escape, string and scalar state across 64-byte blocks */
+static void test_parse_indexed() {
+    static const char* docs[] = {
+        "[\"a\\\\\\\"b{}[],:\", {\"k\\\"\":[1,-2.5e3,true,false,null]}, \"\\\\\"]",
+        "{\"a\" : {\"b\":[[],{}, \"\\u00A2\"]},\n\t\"c\":\"\\\\\\\\\"}",
+        "[1,2 3]", "[1,2]x", "{\"a\":1}}", "[\"a\"1]", "[tru]", "[nullx]", "{\"a\" 1}", "[\"\\\"]",
+        "[1e]", "{\"a\":[1,}", "[\"\x01\"]", "\"", " "
+    };
+    char json[200];
+    size_t i, pad;
+    for (i = 0; i < sizeof(docs) / sizeof(docs[0]); i++)
+        for (pad = 0; pad < 70; pad++) {
+            memset(json, ' ', pad);
+            strcpy(json + pad, docs[i]);
+            EXPECT_SAME_ENGINES(json);
+        }
+    EXPECT_SAME_ENGINES(
+        "{\"n\":null,\"f\":false,\"t\":true,\"i\":123,\"s\":\"abc\",\"a\":[1,2,3],"
+        "\"o\":{\"1\":1,\"2\":2,\"3\":3}}");
+}
+
 static void test_parse_expect_value() {
     TEST_PARSE_ERROR(LEPT_PARSE_EXPECT_VALUE, "");
     TEST_PARSE_ERROR(LEPT_PARSE_EXPECT_VALUE, " ");
@@ -300,6 +587,8 @@ static void test_parse_root_not_singular() {
 static void test_parse_number_too_big() {
     TEST_PARSE_ERROR(LEPT_PARSE_NUMBER_TOO_BIG, "1e309");
     TEST_PARSE_ERROR(LEPT_PARSE_NUMBER_TOO_BIG, "-1e309");
+    TEST_PARSE_ERROR(LEPT_PARSE_NUMBER_TOO_BIG, "1.7976931348623159e308");
+    TEST_PARSE_ERROR(LEPT_PARSE_NUMBER_TOO_BIG, "1e99999999999999999999");
 }
 
 static void test_parse_missing_quotation_mark() {
@@ -380,8 +669,11 @@ static void test_parse() {
     test_parse_false();
     test_parse_number();
     test_parse_string();
+    test_parse_long_string();
     test_parse_array();
     test_parse_object();
+    test_parse_whitespace();
+    test_parse_indexed();
     test_parse_expect_value();
     test_parse_invalid_value();
     test_parse_root_not_singular();
@@ -404,12 +696,35 @@ static void test_parse() {
         size_t length;                                         \
         lept_init(&v);                                         \
         EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse(&v, json)); \
+        EXPECT_SAME_ENGINES(json);                             \
+        EXPECT_SAME_SAX(json);                                 \
+        EXPECT_SAME_PUSH(json);                                \
+        EXPECT_SAME_CURSOR(json);                              \
         json2 = lept_stringify(&v, &length);                   \
         EXPECT_EQ_STRING(json, json2, length);                 \
+        EXPECT_TRUE(lept_stringify_length(&v) == length);      \
         lept_free(&v);                                         \
         free(json2);                                           \
     } while (0)
 
+/* A double set directly must stringify as @json and parse back equal to itself */
+#define TEST_ROUNDTRIP_DOUBLE(d, json)                          \
+    do {                                                        \
+        lept_value v, back;                                     \
+        char* json2;                                            \
+        size_t length;                                          \
+        lept_init(&v);                                          \
+        lept_set_number(&v, d);                                 \
+        json2 = lept_stringify(&v, &length);                    \
+        EXPECT_EQ_STRING(json, json2, length);                  \
+        lept_init(&back);                                       \
+        EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse(&back, json2)); \
+        EXPECT_TRUE(lept_is_equal(&v, &back));                  \
+        lept_free(&back);                                       \
+        lept_free(&v);                                          \
+        free(json2);                                            \
+    } while (0)
+
 static void test_stringify_number() {
     TEST_ROUNDTRIP("0");
     TEST_ROUNDTRIP("-0");
@@ -421,12 +736,33 @@ static void test_stringify_number() {
     TEST_ROUNDTRIP("1e+20");
     TEST_ROUNDTRIP("1.234e+20");
     TEST_ROUNDTRIP("1.234e-20");
+    TEST_ROUNDTRIP("0.1");      /* shortest form, not 0.10000000000000001 */
+    TEST_ROUNDTRIP("0.3");
+    TEST_ROUNDTRIP("123.456");
+    TEST_ROUNDTRIP("-987654321");
+    TEST_ROUNDTRIP("0.0001");
+    TEST_ROUNDTRIP("1e-05");
+    TEST_ROUNDTRIP("9007199254740992");
+    TEST_ROUNDTRIP("10000000000000000");
+    TEST_ROUNDTRIP("1e+17");
+    TEST_ROUNDTRIP("9007199254740993");
+    TEST_ROUNDTRIP("9223372036854775807");
+    TEST_ROUNDTRIP("-9223372036854775808");
+    TEST_ROUNDTRIP("18446744073709551615");
+
+    /* integral doubles above 2^53 come back as the same value */
+    TEST_ROUNDTRIP_DOUBLE(83155391769959488.0, "83155391769959488");
+    TEST_ROUNDTRIP_DOUBLE(9007199254740994.0, "9007199254740994");
+    TEST_ROUNDTRIP_DOUBLE(-9007199254740996.0, "-9007199254740996");
+    TEST_ROUNDTRIP_DOUBLE(99999999999999984.0, "99999999999999984");
+    TEST_ROUNDTRIP_DOUBLE(1e17, "1e+17");
+    TEST_ROUNDTRIP_DOUBLE(100000000000000016.0, "1.0000000000000002e+17");
 
     TEST_ROUNDTRIP("1.0000000000000002"); /* the smallest number > 1 */
-    TEST_ROUNDTRIP("4.9406564584124654e-324"); /* minimum denormal */
-    TEST_ROUNDTRIP("-4.9406564584124654e-324");
-    TEST_ROUNDTRIP("2.2250738585072009e-308");  /* Max subnormal double */
-    TEST_ROUNDTRIP("-2.2250738585072009e-308");
+    TEST_ROUNDTRIP("5e-324"); /* minimum denormal */
+    TEST_ROUNDTRIP("-5e-324");
+    TEST_ROUNDTRIP("2.225073858507201e-308");  /* Max subnormal double */
+    TEST_ROUNDTRIP("-2.225073858507201e-308");
     TEST_ROUNDTRIP("2.2250738585072014e-308");  /* Min normal positive double */
     TEST_ROUNDTRIP("-2.2250738585072014e-308");
     TEST_ROUNDTRIP("1.7976931348623157e+308");  /* Max double */
@@ -452,6 +788,236 @@ static void test_stringify_object() {
                    "\"o\":{\"1\":1,\"2\":2,\"3\":3}}");
 }
 
+/* A writer that collects the output and remembers the largest piece */
+typedef struct {
+    char* s;
+    size_t len, largest;
+    int calls, fail_at;
+} stream_sink;
+
+static int stream_write(void* ctx, const char* data, size_t len) {
+    stream_sink* sink = (stream_sink*)ctx;
+    if (++sink->calls == sink->fail_at)
+        return 0;
+    sink->s = (char*)realloc(sink->s, sink->len + len);
+    memcpy(sink->s + sink->len, data, len);
+    sink->len += len;
+    if (len > sink->largest)
+        sink->largest = len;
+    return 1;
+}
+
+/*
+ * A writer over a device that takes at most @room bytes in all, the way
+ * write() reports a full disk: short counts, then 0. Like lept_write_fd() it
+ * retries the remainder and gives up when nothing more is accepted.
+ */
+static size_t device_write(stream_sink* sink, size_t room, size_t len) {
+    size_t n = room - sink->len < len ? room - sink->len : len;
+    sink->calls++;
+    sink->len += n;
+    return n;
+}
+
+static int short_write(void* ctx, const char* data, size_t len) {
+    stream_sink* sink = (stream_sink*)ctx;
+    (void)data;
+    while (len > 0) {
+        size_t n = device_write(sink, (size_t)sink->fail_at, len);
+        if (n == 0)
+            return 0;
+        len -= n;
+    }
+    return 1;
+}
+
+static void test_stringify_stream() {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat"
+    static const char long_string[] = "\"0123456789\\n\\u0001\"";
+    lept_value v, *e;
+    stream_sink sink;
+    char *json, *back;
+    size_t length, i;
+    FILE* fp;
+
+    /* a wide array with a few long strings that need escaping */
+    lept_init(&v);
+    lept_set_array(&v, 0);
+    for (i = 0; i < 20000; i++) {
+        e = lept_pushback_array_element(&v);
+        lept_parse(e, i % 5000 ? "{\"k\":[1.5,true,null,\"x\"]}" : long_string);
+        if (i % 5000 == 0) {
+            char* big = (char*)malloc(300000);
+            memset(big, '\n', 300000);
+            lept_set_string(e, big, 300000);
+            free(big);
+        }
+    }
+    json = lept_stringify(&v, &length);
+
+    memset(&sink, 0, sizeof(sink));
+    EXPECT_EQ_INT(LEPT_STRINGIFY_OK, lept_stringify_to(&v, stream_write, &sink));
+    EXPECT_EQ_SIZE_T(length, sink.len);
+    EXPECT_TRUE(memcmp(json, sink.s, length) == 0);
+    EXPECT_TRUE(sink.calls > 1);
+    EXPECT_TRUE(sink.largest < 2 * 65536); /* bounded by the buffer, not the document */
+    free(sink.s);
+
+    /* a failing writer stops the output */
+    memset(&sink, 0, sizeof(sink));
+    sink.fail_at = 2;
+    EXPECT_EQ_INT(LEPT_STRINGIFY_WRITE_ERROR, lept_stringify_to(&v, stream_write, &sink));
+    EXPECT_EQ_INT(2, sink.calls);
+    free(sink.s);
+
+    /* a device that fills up returns short counts and then 0, which fails */
+    memset(&sink, 0, sizeof(sink));
+    sink.fail_at = 100000;
+    EXPECT_EQ_INT(LEPT_STRINGIFY_WRITE_ERROR, lept_stringify_to(&v, short_write, &sink));
+    EXPECT_EQ_SIZE_T(100000, sink.len);
+
+    if ((fp = tmpfile()) != NULL) {
+        EXPECT_EQ_INT(LEPT_STRINGIFY_OK, lept_stringify_file(&v, fp));
+        EXPECT_EQ_SIZE_T(length, (size_t)ftell(fp));
+        back = (char*)malloc(length);
+        rewind(fp);
+        EXPECT_EQ_SIZE_T(length, fread(back, 1, length, fp));
+        EXPECT_TRUE(memcmp(json, back, length) == 0);
+        free(back);
+        fclose(fp);
+    }
+    free(json);
+
+#if defined(LEPT_HAVE_FD)
+    {
+        int fds[2], n;
+        char buf[32];
+        if (pipe(fds) == 0) {
+            lept_free(&v);
+            EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse(&v, "[1,\"a\",{\"b\":null}]"));
+            EXPECT_EQ_INT(LEPT_STRINGIFY_OK, lept_stringify_fd(&v, fds[1]));
+            n = (int)read(fds[0], buf, sizeof(buf));
+            EXPECT_EQ_STRING("[1,\"a\",{\"b\":null}]", buf, (size_t)n);
+            close(fds[0]);
+            close(fds[1]);
+        }
+        /* a full device fails the write instead of being retried forever */
+        if ((n = open("/dev/full", O_WRONLY)) >= 0) {
+            EXPECT_EQ_INT(LEPT_STRINGIFY_WRITE_ERROR, lept_stringify_fd(&v, n));
+            close(n);
+        }
+    }
+#endif
+    lept_free(&v);
+#pragma GCC diagnostic pop
+}
+
+static void test_stringify_buffer() {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat"
+    static const char json[] = "{\"a\":[1,-2.5,true,null],\"s\\n\":\"\\u0001\\\"x\"}";
+    size_t length = sizeof(json) - 1;
+    char buffer[64];
+    lept_value v;
+
+    lept_init(&v);
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse(&v, json));
+    EXPECT_EQ_SIZE_T(length, lept_stringify_length(&v));
+
+    /* only the size is asked for */
+    EXPECT_EQ_SIZE_T(length, lept_stringify_buffer(&v, NULL, 0));
+
+    /* exact fit, including the NUL */
+    memset(buffer, '#', sizeof(buffer));
+    EXPECT_EQ_SIZE_T(length, lept_stringify_buffer(&v, buffer, length + 1));
+    EXPECT_EQ_STRING(json, buffer, length);
+    EXPECT_TRUE(buffer[length] == '\0' && buffer[length + 1] == '#');
+
+    /* one byte short leaves no room for the NUL; nothing is written past the end */
+    memset(buffer, '#', sizeof(buffer));
+    EXPECT_EQ_SIZE_T(length, lept_stringify_buffer(&v, buffer, length));
+    EXPECT_TRUE(buffer[length] == '#');
+    memset(buffer, '#', sizeof(buffer));
+    EXPECT_EQ_SIZE_T(length, lept_stringify_buffer(&v, buffer, 10));
+    EXPECT_TRUE(buffer[10] == '#');
+
+    /* the same buffer reused for another value */
+    lept_set_number(&v, 0.1);
+    EXPECT_EQ_SIZE_T(3, lept_stringify_buffer(&v, buffer, sizeof(buffer)));
+    EXPECT_EQ_STRING("0.1", buffer, 3);
+    lept_free(&v);
+#pragma GCC diagnostic pop
+}
+
+/* lept_stringify_parallel() must give the bytes of lept_stringify() */
+static int same_stringify_parallel(const lept_value* v, size_t threads) {
+    size_t len1, len2;
+    char* json1 = lept_stringify(v, &len1);
+    char* json2 = lept_stringify_parallel(v, &len2, threads);
+    int same = len1 == len2 && memcmp(json1, json2, len1 + 1) == 0;
+    free(json1);
+    free(json2);
+    return same;
+}
+
+#define EXPECT_SAME_STRINGIFY_PARALLEL(v, threads) \
+    EXPECT_EQ_BASE(same_stringify_parallel(v, threads), "same", "different", "%s")
+
+static void test_stringify_parallel() {
+    lept_value v, o;
+    char key[16];
+    size_t i;
+
+    lept_init(&v);
+    lept_set_array(&v, 0);
+    for (i = 0; i < 20001; i++) {
+        lept_value* e = lept_pushback_array_element(&v);
+        switch (i % 4) {
+            case 0: lept_set_number(e, i * 0.25); break;
+            case 1: lept_set_string(e, "a\"\n,\x01", 5); break;
+            case 2: EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse(e, "{\"k\":[1,{}],\"x\":null}")); break;
+            case 3: lept_set_array(e, 0); break;
+        }
+    }
+    EXPECT_SAME_STRINGIFY_PARALLEL(&v, 2);
+    EXPECT_SAME_STRINGIFY_PARALLEL(&v, 3);
+    EXPECT_SAME_STRINGIFY_PARALLEL(&v, 0);
+    EXPECT_SAME_STRINGIFY_PARALLEL(&v, 1);
+
+    lept_init(&o);
+    lept_set_object(&o, 0);
+    for (i = 0; i < 37; i++) {
+        sprintf(key, "k%lu", (unsigned long)i);
+        lept_copy(lept_set_object_value(&o, key, strlen(key)), &v);
+    }
+    EXPECT_SAME_STRINGIFY_PARALLEL(&o, 4);
+    EXPECT_SAME_STRINGIFY_PARALLEL(&o, 200);
+    lept_free(&o);
+
+    /* a large array under small wrappers, with values before and after it */
+    lept_init(&o);
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse(&o, "{\"meta\":{\"n\":1},\"page\":[[0,{\"s\":\"x\"}]],\"z\":[true]}"));
+    lept_copy(lept_pushback_array_element(lept_get_array_element(lept_find_object_value(&o, "page", 4), 0)), &v);
+    lept_pushback_array_element(lept_get_array_element(lept_find_object_value(&o, "page", 4), 0));
+    EXPECT_SAME_STRINGIFY_PARALLEL(&o, 4);
+    EXPECT_SAME_STRINGIFY_PARALLEL(&o, 2);
+    lept_free(&o);
+
+    /* too little to split */
+    lept_set_array(&v, 0);
+    EXPECT_SAME_STRINGIFY_PARALLEL(&v, 4);
+    lept_set_array(&v, 0);
+    lept_set_number(lept_pushback_array_element(&v), 1.0);
+    lept_set_array(lept_pushback_array_element(&v), 0);
+    EXPECT_SAME_STRINGIFY_PARALLEL(&v, 4);
+    lept_set_string(lept_pushback_array_element(&v), "x", 1);
+    EXPECT_SAME_STRINGIFY_PARALLEL(&v, 4);
+    lept_set_number(&v, 1.5);
+    EXPECT_SAME_STRINGIFY_PARALLEL(&v, 4);
+    lept_free(&v);
+}
+
 static void test_stringify() {
     TEST_ROUNDTRIP("null");
     TEST_ROUNDTRIP("false");
@@ -460,6 +1026,9 @@ static void test_stringify() {
     test_stringify_string();
     test_stringify_array();
     test_stringify_object();
+    test_stringify_stream();
+    test_stringify_buffer();
+    test_stringify_parallel();
 }
 
 #define TEST_EQUAL(json1, json2, equality)                       \
@@ -468,7 +1037,9 @@ static void test_stringify() {
         lept_init(&v1);                                          \
         lept_init(&v2);                                          \
         EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse(&v1, json1)); \
+        EXPECT_SAME_ENGINES(json1);                              \
         EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse(&v2, json2)); \
+        EXPECT_SAME_ENGINES(json2);                              \
         EXPECT_EQ_INT(equality, lept_is_equal(&v1, &v2));        \
         lept_free(&v1);                                          \
         lept_free(&v2);                                          \
@@ -482,6 +1053,17 @@ static void test_equal() {
     TEST_EQUAL("null", "0", 0);
     TEST_EQUAL("123", "123", 1);
     TEST_EQUAL("123", "456", 0);
+    TEST_EQUAL("123", "123.0", 1);
+    TEST_EQUAL("123", "1.23e2", 1);
+    TEST_EQUAL("-0", "0", 1);
+    TEST_EQUAL("9007199254740993", "9007199254740993", 1);
+    TEST_EQUAL("9007199254740993", "9007199254740992", 0);
+    TEST_EQUAL("9007199254740993", "9007199254740993.0", 0); /* the double rounds to ...992 */
+    TEST_EQUAL("18446744073709551615", "18446744073709551615", 1);
+    TEST_EQUAL("18446744073709551615", "1.8446744073709552e19", 0);
+    TEST_EQUAL("9223372036854775808", "9223372036854775808.0", 1);
+    TEST_EQUAL("-9223372036854775808", "-9223372036854775808.0", 1);
+    TEST_EQUAL("9223372036854775807", "-9223372036854775808", 0);
     TEST_EQUAL("\"abc\"", "\"abc\"", 1);
     TEST_EQUAL("\"abc\"", "\"abcd\"", 0);
     TEST_EQUAL("[]", "[]", 1);
@@ -573,6 +1155,45 @@ static void test_access_number() {
     lept_free(&v);
 }
 
+static void test_access_integer() {
+    lept_value v;
+    lept_init(&v);
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse(&v, "9007199254740993"));
+    EXPECT_TRUE(lept_is_int64(&v));
+    EXPECT_TRUE(lept_get_int64(&v) == INT64_C(9007199254740993));
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse(&v, "-9223372036854775808"));
+    EXPECT_TRUE(lept_is_int64(&v));
+    EXPECT_FALSE(lept_is_uint64(&v));
+    EXPECT_TRUE(lept_get_int64(&v) == INT64_MIN);
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse(&v, "18446744073709551615"));
+    EXPECT_FALSE(lept_is_int64(&v));
+    EXPECT_TRUE(lept_is_uint64(&v));
+    EXPECT_TRUE(lept_get_uint64(&v) == UINT64_MAX);
+    EXPECT_EQ_DOUBLE(18446744073709551616.0, lept_get_number(&v));
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse(&v, "18446744073709551616")); /* too big: a double */
+    EXPECT_FALSE(lept_is_uint64(&v));
+    EXPECT_EQ_DOUBLE(18446744073709551616.0, lept_get_number(&v));
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse(&v, "-9223372036854775809")); /* rounds to -2^63 */
+    EXPECT_EQ_DOUBLE(-9223372036854775808.0, lept_get_number(&v));
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse(&v, "1e3"));
+    EXPECT_TRUE(lept_is_int64(&v));
+    EXPECT_TRUE(lept_get_int64(&v) == 1000);
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse(&v, "1.5"));
+    EXPECT_FALSE(lept_is_int64(&v));
+    EXPECT_FALSE(lept_is_uint64(&v));
+
+    lept_set_int64(&v, INT64_C(-42));
+    EXPECT_EQ_TYPE(LEPT_NUMBER, lept_get_type(&v));
+    EXPECT_TRUE(lept_get_int64(&v) == -42);
+    EXPECT_EQ_DOUBLE(-42.0, lept_get_number(&v));
+    EXPECT_FALSE(lept_is_uint64(&v));
+    lept_set_uint64(&v, UINT64_C(12345678901234567890));
+    EXPECT_TRUE(lept_get_uint64(&v) == UINT64_C(12345678901234567890));
+    lept_set_uint64(&v, 7);
+    EXPECT_TRUE(lept_get_int64(&v) == 7);
+    lept_free(&v);
+}
+
 static void test_access_string() {
     lept_value v;
     lept_init(&v);
@@ -583,6 +1204,61 @@ static void test_access_string() {
     lept_free(&v);
 }
 
+/* Whether the string of @v is stored inside the value itself */
+static int string_is_inline(const lept_value* v) {
+    const char* s = lept_get_string(v);
+    return s >= (const char*)v && s < (const char*)(v + 1);
+}
+
+static void test_access_short_string() {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat"
+    static const char text[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+    lept_value v, v2, a;
+    lept_arena arena;
+    char json[64], *str;
+    size_t len, max = offsetof(lept_value, type) - 1; /* the value bytes in front of the type */
+
+    lept_init(&v);
+    lept_init(&v2);
+    lept_init(&a);
+    for (len = 0; len < sizeof(text); len++) {
+        lept_set_string(&v, text, len);
+        EXPECT_TRUE(string_is_inline(&v) == (len <= max));
+        EXPECT_EQ_SIZE_T(len, lept_get_string_length(&v));
+        EXPECT_TRUE(memcmp(text, lept_get_string(&v), len) == 0 && lept_get_string(&v)[len] == '\0');
+
+        /* copies and moves carry the inline bytes along */
+        lept_copy(&v2, &v);
+        EXPECT_TRUE(lept_is_equal(&v, &v2));
+        lept_set_array(&a, 0);
+        lept_move(lept_pushback_array_element(&a), &v2);
+        lept_reserve_array(&a, 100);
+        EXPECT_TRUE(lept_is_equal(&v, lept_get_array_element(&a, 0)));
+
+        /* parsed the same way, heap and arena alike */
+        sprintf(json, "[\"%.*s\"]", (int)len, text);
+        lept_free(&a);
+        EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse(&a, json));
+        EXPECT_TRUE(lept_is_equal(&v, lept_get_array_element(&a, 0)));
+        EXPECT_TRUE(string_is_inline(lept_get_array_element(&a, 0)) == (len <= max));
+        lept_arena_init(&arena, 0, NULL);
+        EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse_arena(&arena, &v2, json));
+        EXPECT_TRUE(lept_is_equal(&a, &v2));
+        EXPECT_EQ_SIZE_T(len + 4, lept_stringify_length(&v2));
+        lept_arena_free(&arena);
+        lept_init(&v2);
+    }
+    lept_set_string(&v, "\"\n", 2);
+    EXPECT_TRUE(string_is_inline(&v));
+    str = lept_stringify(&v, &len);
+    EXPECT_EQ_STRING("\"\\\"\\n\"", str, len);
+    free(str);
+    lept_free(&a);
+    lept_free(&v);
+#pragma GCC diagnostic pop
+}
+
 static void test_access_array() {
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wformat"
@@ -746,13 +1422,940 @@ static void test_access_object() {
 #pragma GCC diagnostic pop
 }
 
+/* Every key "k<i>" of @o holds i, and no key past @count is there */
+static int object_hash_check(const lept_value* o, size_t count, size_t skip) {
+    char key[24];
+    size_t i;
+    for (i = 0; i < count + 1; i++) {
+        lept_value* pv;
+        sprintf(key, "k%lu", (unsigned long)i);
+        pv = lept_find_object_value(o, key, strlen(key));
+        if ((i % skip == 0 && i < count) != (pv != NULL))
+            return 0;
+        if (pv != NULL && lept_get_number(pv) != (double)i)
+            return 0;
+    }
+    return 1;
+}
+
+static void test_access_object_hash() {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat"
+    lept_value o, o2, v;
+    lept_arena arena;
+    char key[24], *json;
+    size_t i, length, capacity;
+    lept_parse_options options;
+
+    /* grows an index on the way, capacity doubles instead of growing on every insert */
+    lept_init(&o);
+    lept_set_object(&o, 0);
+    for (i = 0; i < 1000; i++) {
+        sprintf(key, "k%lu", (unsigned long)i);
+        lept_set_number(lept_set_object_value(&o, key, strlen(key)), (double)i);
+    }
+    EXPECT_EQ_SIZE_T(1000, lept_get_object_size(&o));
+    EXPECT_EQ_SIZE_T(1024, lept_get_object_capacity(&o));
+    EXPECT_TRUE(object_hash_check(&o, 1000, 1));
+    EXPECT_EQ_STRING("k0", lept_get_object_key(&o, 0), 2); /* insertion order is kept */
+    EXPECT_EQ_STRING("k999", lept_get_object_key(&o, 999), 4);
+
+    /* overwriting an existing key frees the old value in place */
+    lept_set_string(lept_set_object_value(&o, "k7", 2), "seven", 5);
+    EXPECT_EQ_SIZE_T(1000, lept_get_object_size(&o));
+    EXPECT_EQ_SIZE_T(7, lept_find_object_index(&o, "k7", 2));
+    lept_set_number(lept_set_object_value(&o, "k7", 2), 7.0);
+
+    /* removal shifts the members and keeps the index right */
+    for (i = 999; i > 0; i--)
+        if (i % 3 != 0) {
+            sprintf(key, "k%lu", (unsigned long)i);
+            lept_remove_object_value(&o, lept_find_object_index(&o, key, strlen(key)));
+        }
+    EXPECT_EQ_SIZE_T(334, lept_get_object_size(&o));
+    EXPECT_TRUE(object_hash_check(&o, 1000, 3));
+    lept_shrink_object(&o);
+    EXPECT_TRUE(object_hash_check(&o, 1000, 3));
+
+    /* copies, moves and equality */
+    lept_init(&o2);
+    lept_copy(&o2, &o);
+    EXPECT_TRUE(lept_is_equal(&o, &o2));
+    EXPECT_TRUE(object_hash_check(&o2, 1000, 3));
+    lept_init(&v);
+    lept_move(&v, &o2);
+    EXPECT_TRUE(object_hash_check(&v, 1000, 3));
+    lept_set_number(lept_find_object_value(&v, "k999", 4), 0.0);
+    EXPECT_FALSE(lept_is_equal(&o, &v));
+    lept_free(&v);
+
+    /* clear keeps the storage and empties the index */
+    capacity = lept_get_object_capacity(&o);
+    lept_clear_object(&o);
+    EXPECT_EQ_SIZE_T(capacity, lept_get_object_capacity(&o));
+    EXPECT_TRUE(object_hash_check(&o, 0, 1));
+    lept_set_number(lept_set_object_value(&o, "k0", 2), 0.0);
+    EXPECT_TRUE(object_hash_check(&o, 1, 1));
+
+    /* a small object indexed on request */
+    lept_set_object(&o, 0);
+    lept_index_object(&o);
+    lept_set_number(lept_set_object_value(&o, "k0", 2), 0.0);
+    lept_set_number(lept_set_object_value(&o, "k1", 2), 1.0);
+    EXPECT_TRUE(object_hash_check(&o, 2, 1));
+
+    /* parsed objects, with duplicate keys resolving to the first one */
+    lept_set_object(&o, 0);
+    for (i = 0; i < 100; i++) {
+        sprintf(key, "k%lu", (unsigned long)i);
+        lept_set_number(lept_set_object_value(&o, key, strlen(key)), (double)i);
+    }
+    json = lept_stringify(&o, &length);
+    json[length - 1] = ',';
+    json = (char*)realloc(json, length + 16);
+    strcpy(json + length, "\"k5\":-1}");
+    lept_parse_options_init(&options);
+    for (options.engine = LEPT_ENGINE_RECURSIVE; options.engine <= LEPT_ENGINE_INDEXED; options.engine++) {
+        EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse_ex(&o2, json, strlen(json), &options));
+        EXPECT_TRUE(object_hash_check(&o2, 100, 1));
+        lept_free(&o2);
+    }
+    lept_arena_init(&arena, 0, NULL);
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse_arena(&arena, &o2, json));
+    EXPECT_TRUE(object_hash_check(&o2, 100, 1));
+    lept_set_number(lept_set_object_value(&o2, "k100", 4), 100.0); /* copied out of the arena */
+    EXPECT_TRUE(object_hash_check(&o2, 101, 1));
+    lept_free(&o2);
+    lept_arena_free(&arena);
+    free(json);
+
+    lept_free(&o);
+#pragma GCC diagnostic pop
+}
+
+static void test_key_pool() {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat"
+    static const char* docs[] = {
+        "{\"id\":1,\"name\":\"a\",\"tags\":{\"id\":2}}",
+        "{\"name\":\"b\",\"id\":3,\"n\\u0061me\":4}",
+    };
+    lept_key_pool pool;
+    lept_parse_options options;
+    lept_value v[2], o;
+    const char* id;
+    char key[24];
+    size_t i;
+
+    lept_key_pool_init(&pool, NULL);
+    id = lept_key_pool_intern(&pool, "id", 2);
+    EXPECT_EQ_STRING("id", id, 2);
+    EXPECT_TRUE(lept_key_pool_intern(&pool, "id", 2) == id);
+    EXPECT_TRUE(lept_key_pool_intern(&pool, "idx", 2) == id);
+    EXPECT_EQ_SIZE_T(1, pool.count);
+
+    /* parsed documents share their keys, in both engines */
+    lept_parse_options_init(&options);
+    options.keys = &pool;
+    for (options.engine = LEPT_ENGINE_RECURSIVE; options.engine <= LEPT_ENGINE_INDEXED; options.engine++) {
+        for (i = 0; i < 2; i++) {
+            lept_init(&v[i]);
+            EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse_ex(&v[i], docs[i], strlen(docs[i]), &options));
+        }
+        EXPECT_TRUE(lept_get_object_key(&v[0], 0) == id);
+        EXPECT_TRUE(lept_get_object_key(&v[1], 1) == id);
+        EXPECT_TRUE(lept_get_object_key(&v[0], 1) == lept_get_object_key(&v[1], 0));
+        EXPECT_TRUE(lept_get_object_key(&v[1], 2) == lept_get_object_key(&v[1], 0)); /* unescaped */
+        EXPECT_TRUE(lept_get_object_key(lept_get_object_value(&v[0], 2), 0) == id);
+        EXPECT_EQ_SIZE_T(1, lept_find_object_index(&v[1], id, 2));
+        EXPECT_EQ_SIZE_T(1, lept_find_object_index(&v[1], "id", 2));
+        lept_free(&v[0]);
+        lept_free(&v[1]);
+    }
+    EXPECT_EQ_SIZE_T(3, pool.count);
+
+    /* errors leave the pooled keys alone */
+    lept_init(&v[0]);
+    EXPECT_EQ_RESULT(LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET, lept_parse_ex(&v[0], "{\"id\":1\"x\"", 11, &options));
+    EXPECT_EQ_RESULT(LEPT_PARSE_MISS_COLON, lept_parse_ex(&v[0], "{\"id\":{\"name\"}}", 16, &options));
+
+    /* heap keys move into the pool and back out on a plain insert */
+    lept_init(&o);
+    lept_set_object(&o, 0);
+    for (i = 0; i < 40; i++) {
+        sprintf(key, "k%lu", (unsigned long)i);
+        lept_set_number(lept_set_object_value(&o, key, strlen(key)), (double)i);
+    }
+    lept_set_number(lept_set_object_value_pooled(&o, &pool, "id", 2), 40.0);
+    EXPECT_TRUE(lept_get_object_key(&o, 40) == id);
+    EXPECT_TRUE(lept_get_object_key(&o, 0) == lept_key_pool_intern(&pool, "k0", 2));
+    EXPECT_TRUE(object_hash_check(&o, 40, 1));
+    lept_set_number(lept_set_object_value_pooled(&o, &pool, "k3", 2), 3.0);
+    EXPECT_EQ_SIZE_T(41, lept_get_object_size(&o));
+    lept_init(&v[0]);
+    lept_copy(&v[0], &o);
+    EXPECT_TRUE(lept_is_equal(&v[0], &o));
+    lept_set_null(lept_set_object_value(&o, "extra", 5));
+    EXPECT_TRUE(lept_get_object_key(&o, 40) != id);
+    EXPECT_EQ_SIZE_T(40, lept_find_object_index(&o, id, 2));
+    EXPECT_TRUE(object_hash_check(&o, 40, 1));
+    lept_free(&o);
+    lept_key_pool_free(&pool);
+    EXPECT_TRUE(object_hash_check(&v[0], 40, 1)); /* copies own their keys */
+    lept_free(&v[0]);
+#pragma GCC diagnostic pop
+}
+
+static void test_arena() {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat"
+    static const char json[] = "{\"n\":null,\"s\":\"abc\",\"a\":[1,2,3],\"o\":{\"1\":1,\"2\":2}}";
+    lept_arena a;
+    lept_value v1, v2, *pv;
+    size_t i;
+
+    lept_arena_init(&a, 64, NULL); /* small blocks to exercise block chaining */
+    lept_init(&v1);
+    lept_init(&v2);
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse(&v1, json));
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse_arena(&a, &v2, json));
+    EXPECT_TRUE(lept_is_equal(&v1, &v2));
+    lept_free(&v1);
+
+    /* mutation on arena-owned values */
+    pv = lept_find_object_value(&v2, "a", 1);
+    for (i = 0; i < 10; i++)
+        lept_set_number(lept_pushback_array_element(pv), (double)i);
+    lept_erase_array_element(pv, 0, 3);
+    EXPECT_EQ_SIZE_T(10, lept_get_array_size(pv));
+    lept_set_string(lept_find_object_value(&v2, "s", 1), "Hello", 5);
+    lept_set_number(lept_set_object_value(&v2, "x", 1), 1.0);
+    lept_remove_object_value(&v2, lept_find_object_index(&v2, "n", 1));
+    lept_clear_object(lept_find_object_value(&v2, "o", 1));
+    lept_shrink_object(lept_find_object_value(&v2, "o", 1));
+    lept_parse(&v1, "{\"s\":\"Hello\",\"a\":[0,1,2,3,4,5,6,7,8,9],\"o\":{},\"x\":1}");
+    EXPECT_TRUE(lept_is_equal(&v1, &v2));
+    lept_free(&v1);
+    lept_free(&v2);
+    lept_arena_free(&a);
+
+    /* untouched trees are dropped with the arena alone */
+    lept_arena_init(&a, 0, NULL);
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse_arena(&a, &v2, json));
+    EXPECT_EQ_RESULT(LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET, lept_parse_arena(&a, &v1, "{\"a\":[1,\"b\"]"));
+    EXPECT_EQ_TYPE(LEPT_NULL, lept_get_type(&v1));
+    lept_arena_free(&a);
+#pragma GCC diagnostic pop
+}
+
+/* Parse @json from an exact-size heap copy, so that over-reads are caught by memory checkers */
+#define TEST_PARSE_N(error, json)                                       \
+    do {                                                                \
+        size_t len = sizeof(json) - 1, consumed;                        \
+        char* buf = (char*)malloc(len + 1);                             \
+        lept_value v;                                                   \
+        memcpy(buf, json, len);                                         \
+        lept_init(&v);                                                  \
+        EXPECT_EQ_RESULT(error, lept_parse_n(&v, buf, len, &consumed)); \
+        EXPECT_TRUE(consumed <= len);                                   \
+        if (error == LEPT_PARSE_OK)                                     \
+            EXPECT_TRUE(consumed == len);                               \
+        lept_free(&v);                                                  \
+        free(buf);                                                      \
+    } while(0)
+
+static size_t sax_last_count;
+
+static int sax_count(void* ctx, size_t count) {
+    (void)ctx;
+    sax_last_count = count;
+    return 1;
+}
+
+static void test_parse_sax() {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat"
+    static const lept_sax_handler empty = { NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL };
+    lept_sax_handler counter = { NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL };
+    const char* json = "{\"a\":[1,2,3],\"s\":\"x\\ny\",\"o\":{\"t\":true,\"f\":false,\"n\":null}}";
+    sax_writer w;
+
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse_sax(json, strlen(json), &empty, NULL));
+    EXPECT_EQ_RESULT(LEPT_PARSE_MISS_KEY, lept_parse_sax("{1}", 3, &empty, NULL));
+
+    memset(&w, 0, sizeof(w));
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse_sax(json, strlen(json), &sax_writer_handler, &w));
+    EXPECT_EQ_SIZE_T(strlen(json), w.len);
+    EXPECT_TRUE(memcmp(json, w.json, w.len) == 0);
+
+    counter.end_array = sax_count;
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse_sax("[[],[1,[2]],3]", 14, &counter, NULL));
+    EXPECT_EQ_SIZE_T(3, sax_last_count);
+    counter.end_array = NULL;
+    counter.end_object = sax_count;
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse_sax(json, strlen(json), &counter, NULL));
+    EXPECT_EQ_SIZE_T(3, sax_last_count);
+
+    /* a callback stops the parse, nothing after it is reported */
+    memset(&w, 0, sizeof(w));
+    w.abort_at = 3;
+    EXPECT_EQ_RESULT(LEPT_PARSE_ABORTED, lept_parse_sax("[1,2,3]", 7, &sax_writer_handler, &w));
+    EXPECT_EQ_STRING("[1,2", w.json, w.len);
+    memset(&w, 0, sizeof(w));
+    w.abort_at = 2;
+    EXPECT_EQ_RESULT(LEPT_PARSE_ABORTED, lept_parse_sax(json, strlen(json), &sax_writer_handler, &w));
+    EXPECT_EQ_STRING("{\"a\":", w.json, w.len);
+#pragma GCC diagnostic pop
+}
+
+static void test_parse_push() {
+    const char* json = "{\"n\":null,\"a\":[1.5e3,-0,\"\\u00A2\\uD834\\uDD1E\"],\"o\":{\"t\":true,\"f\":false}}";
+    lept_push_parser* p = lept_push_parser_new();
+    lept_value v1, v2;
+
+    /* the input ends in every state of the structure */
+    EXPECT_SAME_PUSH("");
+    EXPECT_SAME_PUSH("  ");
+    EXPECT_SAME_PUSH("[");
+    EXPECT_SAME_PUSH("[1,");
+    EXPECT_SAME_PUSH("{");
+    EXPECT_SAME_PUSH("{\"a\"");
+    EXPECT_SAME_PUSH("{\"a\":");
+    EXPECT_SAME_PUSH("{\"a\":1,");
+    EXPECT_SAME_PUSH("\"abc");
+    EXPECT_SAME_PUSH("\"\\u12");
+    EXPECT_SAME_PUSH("\"\\");
+    EXPECT_SAME_PUSH("tru");
+    EXPECT_SAME_PUSH("-");
+    EXPECT_SAME_PUSH("[1.");
+    EXPECT_SAME_PUSH(json);
+
+    /* errors are reported by the chunk that reveals them and stick */
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_push_parser_feed(p, "[1", 2));
+    EXPECT_EQ_RESULT(LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, lept_push_parser_feed(p, "}", 1));
+    EXPECT_EQ_RESULT(LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, lept_push_parser_feed(p, "]", 1));
+    lept_init(&v1);
+    EXPECT_EQ_RESULT(LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, lept_push_parser_finish(p, &v1));
+    EXPECT_EQ_TYPE(LEPT_NULL, lept_get_type(&v1));
+
+    /* the parser is reusable after finish() */
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse(&v1, json));
+    lept_init(&v2);
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, push_parse(p, &v2, json, 5, 3));
+    EXPECT_TRUE(lept_is_equal(&v1, &v2));
+    lept_free(&v2);
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, push_parse(p, &v2, "[\"x\"]", 1, 1));
+    EXPECT_EQ_STRING("x", lept_get_string(lept_get_array_element(&v2, 0)), lept_get_string_length(lept_get_array_element(&v2, 0)));
+    lept_free(&v2);
+    lept_free(&v1);
+
+    /* a partial document is dropped without leaks */
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_push_parser_feed(p, "{\"a\":[\"xy", 10));
+    lept_push_parser_free(p);
+}
+
+static void test_parse_cursor() {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat"
+    const char* json = " { \"id\" : 7, \"skip\" : {\"x\":[1,{\"y\":\"}\"}]}, \"name\":\"a\\nb\", \"list\":[1,2,3], \"k\\u0041\":true } ";
+    lept_cursor cur;
+    lept_value v;
+    lept_type type;
+    const char* s;
+    size_t len;
+    double n;
+    int found, more;
+
+    lept_cursor_init(&cur, json, strlen(json));
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_cursor_peek(&cur, &type));
+    EXPECT_EQ_TYPE(LEPT_OBJECT, type);
+    EXPECT_EQ_RESULT(LEPT_PARSE_WRONG_TYPE, lept_cursor_enter_array(&cur));
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_cursor_enter_object(&cur));
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_cursor_find_key(&cur, "id", 2, &found));
+    EXPECT_TRUE(found);
+    EXPECT_EQ_RESULT(LEPT_PARSE_WRONG_TYPE, lept_cursor_get_string(&cur, &s, &len));
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_cursor_get_number(&cur, &n));
+    EXPECT_EQ_DOUBLE(7.0, n);
+    /* "skip" is stepped over unread */
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_cursor_find_key(&cur, "name", 4, &found));
+    EXPECT_TRUE(found);
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_cursor_get_string(&cur, &s, &len));
+    EXPECT_EQ_STRING("a\nb", s, len);
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_cursor_next_member(&cur, &s, &len));
+    EXPECT_EQ_STRING("list", s, len);
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_cursor_enter_array(&cur));
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_cursor_next_element(&cur, &more));
+    EXPECT_TRUE(more);
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_cursor_next_element(&cur, &more)); /* 1 left unread */
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_cursor_get_number(&cur, &n));
+    EXPECT_EQ_DOUBLE(2.0, n);
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_cursor_next_element(&cur, &more));
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_cursor_next_element(&cur, &more));
+    EXPECT_FALSE(more);
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_cursor_find_key(&cur, "kA", 2, &found)); /* keys compare unescaped */
+    EXPECT_TRUE(found);
+    lept_init(&v);
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_cursor_get_value(&cur, &v));
+    EXPECT_EQ_TYPE(LEPT_TRUE, lept_get_type(&v));
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_cursor_find_key(&cur, "id", 2, &found)); /* forward only */
+    EXPECT_FALSE(found);
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_cursor_finish(&cur));
+    lept_cursor_free(&cur);
+
+    /* errors in skipped values are still reported */
+    lept_cursor_init(&cur, "{\"a\":[1,?],\"b\":1}", 17);
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_cursor_enter_object(&cur));
+    EXPECT_EQ_RESULT(LEPT_PARSE_INVALID_VALUE, lept_cursor_find_key(&cur, "b", 1, &found));
+    lept_cursor_free(&cur);
+
+    /* an inner container is left early, unread values and all */
+    json = "[{\"a\":1,\"b\":[2,{\"c\":\"]\"}],\"d\":3},[4,[5,6],7],8]";
+    lept_cursor_init(&cur, json, strlen(json));
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_cursor_enter_array(&cur));
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_cursor_next_element(&cur, &more));
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_cursor_enter_object(&cur));
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_cursor_find_key(&cur, "b", 1, &found));
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_cursor_enter_array(&cur));
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_cursor_next_element(&cur, &more));
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_cursor_leave_array(&cur));
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_cursor_leave_object(&cur));
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_cursor_next_element(&cur, &more));
+    EXPECT_TRUE(more);
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_cursor_enter_array(&cur));
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_cursor_leave_array(&cur)); /* nothing read yet */
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_cursor_next_element(&cur, &more));
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_cursor_get_number(&cur, &n));
+    EXPECT_EQ_DOUBLE(8.0, n);
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_cursor_next_element(&cur, &more));
+    EXPECT_FALSE(more);
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_cursor_finish(&cur));
+    lept_cursor_free(&cur);
+
+    /* leaving checks the rest of the container */
+    lept_cursor_init(&cur, "[[1,2 3]]", 9);
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_cursor_enter_array(&cur));
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_cursor_next_element(&cur, &more));
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_cursor_enter_array(&cur));
+    EXPECT_EQ_RESULT(LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, lept_cursor_leave_array(&cur));
+    lept_cursor_free(&cur);
+
+    lept_cursor_init(&cur, "[1] 2", 5);
+    EXPECT_EQ_RESULT(LEPT_PARSE_ROOT_NOT_SINGULAR, lept_cursor_finish(&cur));
+    lept_cursor_free(&cur);
+    lept_free(&v);
+#pragma GCC diagnostic pop
+}
+
+static void test_parse_ndjson() {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat"
+    static const char json[] = "{\"a\":1}\n\n[1,2]\r\n  \t\n{\"a\":}\n\"x\" \"y\"\nnull";
+    lept_record *records, *serial;
+    size_t count, n, i, len;
+    char *big, *p;
+    int same;
+
+    count = lept_parse_ndjson(json, sizeof(json) - 1, 2, &records);
+    EXPECT_EQ_SIZE_T(5, count);
+    EXPECT_EQ_SIZE_T(0, records[0].offset);
+    EXPECT_EQ_SIZE_T(9, records[1].offset);
+    EXPECT_EQ_SIZE_T(20, records[2].offset);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, records[0].result);
+    EXPECT_EQ_DOUBLE(1.0, lept_get_number(lept_find_object_value(&records[0].v, "a", 1)));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, records[1].result);
+    EXPECT_EQ_SIZE_T(2, lept_get_array_size(&records[1].v));
+    EXPECT_EQ_INT(LEPT_PARSE_INVALID_VALUE, records[2].result);
+    EXPECT_EQ_INT(LEPT_NULL, lept_get_type(&records[2].v));
+    EXPECT_EQ_INT(LEPT_PARSE_ROOT_NOT_SINGULAR, records[3].result);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, records[4].result);
+    EXPECT_EQ_INT(LEPT_NULL, lept_get_type(&records[4].v));
+    lept_free_records(records, count);
+
+    EXPECT_EQ_SIZE_T(0, lept_parse_ndjson(" \n\n", 3, 0, &records));
+    lept_free_records(records, 0);
+
+    /* many blocks of lines: any number of threads gives the serial result */
+    big = p = (char*)malloc(5000 * 48);
+    for (i = 0; i < 5000; i++)
+        p += sprintf(p, i % 97 ? "{\"id\":%lu,\"tags\":[\"t\",%lu.5]}\n" : "{\"id\":%lu,]\n", (unsigned long)i, (unsigned long)i);
+    len = p - big;
+    n = lept_parse_ndjson(big, len, 1, &serial);
+    EXPECT_EQ_SIZE_T(5000, n);
+    for (i = 0; i < 3; i++) {
+        size_t j;
+        count = lept_parse_ndjson(big, len, i * 3, &records);
+        EXPECT_EQ_SIZE_T(n, count);
+        for (same = 1, j = 0; j < n && same; j++)
+            same = records[j].result == serial[j].result && records[j].offset == serial[j].offset &&
+                lept_is_equal(&records[j].v, &serial[j].v);
+        EXPECT_TRUE(same);
+        lept_free_records(records, count);
+    }
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_KEY, serial[97].result);
+    EXPECT_EQ_INT(98, (int)lept_get_number(lept_find_object_value(&serial[98].v, "id", 2)));
+    lept_free_records(serial, n);
+    free(big);
+
+    /* options reach every line: a depth limit, and keys shared through a pool */
+    {
+        static const char lines[] = "{\"id\":[1]}\n{\"id\":[[2]]}\n{\"id\":3}";
+        lept_parse_options options;
+        lept_key_pool pool;
+        lept_parse_options_init(&options);
+        options.max_depth = 2;
+        options.engine = LEPT_ENGINE_INDEXED;
+        count = lept_parse_ndjson_ex(lines, sizeof(lines) - 1, 0, &options, &records);
+        EXPECT_EQ_SIZE_T(3, count);
+        EXPECT_EQ_INT(LEPT_PARSE_OK, records[0].result);
+        EXPECT_EQ_INT(LEPT_PARSE_TOO_DEEP, records[1].result);
+        EXPECT_EQ_INT(LEPT_PARSE_OK, records[2].result);
+        lept_free_records(records, count);
+
+        lept_key_pool_init(&pool, NULL);
+        lept_parse_options_init(&options);
+        options.keys = &pool;
+        count = lept_parse_ndjson_ex(lines, sizeof(lines) - 1, 4, &options, &records);
+        EXPECT_EQ_SIZE_T(3, count);
+        EXPECT_TRUE(lept_get_object_key(&records[0].v, 0) == lept_get_object_key(&records[2].v, 0));
+        EXPECT_TRUE(lept_get_object_key(&records[1].v, 0) == lept_get_object_key(&records[2].v, 0));
+        EXPECT_EQ_SIZE_T(1, pool.count);
+        lept_free_records(records, count);
+        lept_key_pool_free(&pool);
+    }
+#pragma GCC diagnostic pop
+}
+
+/* lept_parse_ex() on @threads threads must agree with lept_parse() on the result and the tree */
+static int same_as_parallel(const char* json, size_t threads) {
+    lept_parse_options options;
+    lept_value v1, v2;
+    int same;
+    lept_parse_options_init(&options);
+    options.threads = threads;
+    lept_init(&v1);
+    lept_init(&v2);
+    same = lept_parse(&v1, json) == lept_parse_ex(&v2, json, strlen(json), &options) &&
+        lept_get_type(&v1) == lept_get_type(&v2) && lept_is_equal(&v1, &v2) &&
+        (lept_get_type(&v1) != LEPT_ARRAY || lept_get_array_capacity(&v1) == lept_get_array_capacity(&v2));
+    lept_free(&v1);
+    lept_free(&v2);
+    return same;
+}
+
+#define EXPECT_SAME_PARALLEL(json, threads) EXPECT_EQ_BASE(same_as_parallel(json, threads), "same", "different", "%s")
+
+static void test_parse_parallel() {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat"
+    lept_parse_options options;
+    lept_value v;
+    size_t i, n = 20000;
+    char *big, *p;
+
+    /* commas and brackets inside strings and nested values must not cut the array */
+    big = p = (char*)malloc(n * 64 + 16);
+    p += sprintf(p, " [ ");
+    for (i = 0; i < n; i++)
+        switch (i % 4) {
+            case 0: p += sprintf(p, "%s%lu", i ? "," : "", (unsigned long)i); break;
+            case 1: p += sprintf(p, ",\"a,]\\\"[,%lu\"", (unsigned long)i); break;
+            case 2: p += sprintf(p, ", {\"k,\":[%lu,{}],\"}\":\"\\\\\"}", (unsigned long)i); break;
+            case 3: p += sprintf(p, ",\n[[],[%lu, \"]\"]]", (unsigned long)i); break;
+        }
+    strcpy(p, " ]\n");
+    EXPECT_SAME_PARALLEL(big, 3);
+    EXPECT_SAME_PARALLEL(big, 8);
+    EXPECT_SAME_PARALLEL(big, 0);
+    lept_parse_options_init(&options);
+    options.threads = 4;
+    lept_init(&v);
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse_ex(&v, big, strlen(big), &options));
+    EXPECT_EQ_SIZE_T(n, lept_get_array_size(&v));
+    EXPECT_EQ_DOUBLE((double)(n - 1), lept_get_number(lept_get_array_element(lept_get_array_element(lept_get_array_element(&v, n - 1), 1), 0)));
+    lept_free(&v);
+
+    /* errors anywhere come out as from the serial parser */
+    strcpy(p, " ] x");
+    EXPECT_SAME_PARALLEL(big, 3);
+    strcpy(p, ",]");
+    EXPECT_SAME_PARALLEL(big, 3);
+    big[n * 20] = '}';
+    EXPECT_SAME_PARALLEL(big, 3);
+    big[3 * n] = '"';
+    EXPECT_SAME_PARALLEL(big, 3);
+    big[1] = '{';
+    EXPECT_SAME_PARALLEL(big, 3);
+    free(big);
+
+    EXPECT_SAME_PARALLEL("[1,2,3]", 4);
+    EXPECT_SAME_PARALLEL("[]", 4);
+#pragma GCC diagnostic pop
+}
+
+/* @depth arrays and objects nested in turn around a 0: [{"a":[{"a":0}]}] for 4 */
+static char* make_nested(size_t depth) {
+    char* json = (char*)malloc(depth * 6 + 2);
+    char* p = json;
+    size_t i;
+    for (i = 0; i < depth; i++) {
+        memcpy(p, i % 2 ? "{\"a\":" : "[", i % 2 ? 5 : 1);
+        p += i % 2 ? 5 : 1;
+    }
+    *p++ = '0';
+    for (i = depth; i-- > 0; )
+        *p++ = i % 2 ? '}' : ']';
+    *p = '\0';
+    return json;
+}
+
+static void test_parse_depth() {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat"
+    static const char wide[] = "[1,[2,[3,[4]]],{\"a\":{}}]";
+    static const char deep[] = "[1,[2,[3,[4,{}]]]]";
+    lept_parse_options options;
+    lept_value v, copy;
+    char *json, *json2;
+    size_t length, i;
+
+    /* far deeper than any C stack would allow with one frame per level */
+    json = make_nested(1000000);
+    lept_init(&v);
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse(&v, json));
+    EXPECT_EQ_SIZE_T(strlen(json), lept_stringify_length(&v));
+    json2 = lept_stringify(&v, &length);
+    EXPECT_TRUE(length == strlen(json) && memcmp(json, json2, length) == 0);
+    free(json2);
+    lept_init(&copy);
+    lept_copy(&copy, &v);
+    EXPECT_TRUE(lept_is_equal(&v, &copy));
+    lept_set_number(lept_get_object_value(lept_get_array_element(&copy, 0), 0), 1.0);
+    EXPECT_FALSE(lept_is_equal(&v, &copy));
+    lept_free(&copy);
+    lept_free(&v);
+    json[1000000 * 3 + 1] = ']'; /* the innermost object closed as an array */
+    EXPECT_EQ_RESULT(LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET, lept_parse(&v, json));
+    free(json);
+
+    /* the limit counts arrays and objects alike */
+    lept_parse_options_init(&options);
+    options.max_depth = 4;
+    for (i = 0; i < 2; i++) {
+        options.engine = i ? LEPT_ENGINE_INDEXED : LEPT_ENGINE_RECURSIVE;
+        json = make_nested(4);
+        EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse_ex(&v, json, strlen(json), &options));
+        lept_free(&v);
+        free(json);
+        json = make_nested(5);
+        EXPECT_EQ_RESULT(LEPT_PARSE_TOO_DEEP, lept_parse_ex(&v, json, strlen(json), &options));
+        EXPECT_EQ_TYPE(LEPT_NULL, lept_get_type(&v));
+        free(json);
+        json = make_nested(300);
+        EXPECT_EQ_RESULT(LEPT_PARSE_TOO_DEEP, lept_parse_ex(&v, json, strlen(json), &options));
+        free(json);
+        EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse_ex(&v, wide, strlen(wide), &options));
+        lept_free(&v);
+        EXPECT_EQ_RESULT(LEPT_PARSE_TOO_DEEP, lept_parse_ex(&v, deep, strlen(deep), &options));
+    }
+    /* the indexed engine hands deep input over rather than recursing */
+    options.max_depth = 0;
+    json = make_nested(1000);
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse_ex(&v, json, strlen(json), &options));
+    lept_free(&v);
+    free(json);
+#pragma GCC diagnostic pop
+}
+
+static void write_file(const char* path, const char* data, size_t len) {
+    FILE* fp = fopen(path, "wb");
+    if (fp) {
+        fwrite(data, 1, len, fp);
+        fclose(fp);
+    }
+}
+
+static void test_parse_file() {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat"
+    static const char path[] = "leptjson_test_file.json";
+    static const size_t sizes[] = { 4096, 16384, 65536 };
+    lept_value v, w;
+    lept_parse_options options;
+    char* json = (char*)malloc(65536);
+    size_t i, size;
+    int engine;
+
+    lept_init(&v);
+    lept_init(&w);
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse(&v, "{\"a\":[1,2.5,true,null],\"s\":\"x\\ny\"}"));
+    EXPECT_EQ_INT(LEPT_STRINGIFY_OK, lept_stringify_path(&v, path));
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse_file(&w, path, NULL));
+    EXPECT_TRUE(lept_is_equal(&v, &w));
+    lept_free(&v);
+    lept_free(&w);
+
+    lept_parse_options_init(&options);
+    options.max_depth = 1;
+    EXPECT_EQ_RESULT(LEPT_PARSE_TOO_DEEP, lept_parse_file(&w, path, &options));
+    EXPECT_EQ_TYPE(LEPT_NULL, lept_get_type(&w));
+
+    /* documents ending exactly at a page boundary, for the common page sizes */
+    for (engine = LEPT_ENGINE_RECURSIVE; engine <= LEPT_ENGINE_INDEXED; engine++) {
+        lept_parse_options_init(&options);
+        options.engine = engine;
+        for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+            size = sizes[i];
+            json[0] = '"';
+            memset(json + 1, 'a', size - 2);
+            json[size - 1] = '"';
+            write_file(path, json, size);
+            EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse_file(&w, path, &options));
+            EXPECT_EQ_SIZE_T(size - 2, lept_get_string_length(&w));
+            lept_free(&w);
+
+            memset(json, ' ', size);
+            memcpy(json + size - 5, "12345", 5);
+            write_file(path, json, size);
+            EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse_file(&w, path, &options));
+            EXPECT_EQ_DOUBLE(12345.0, lept_get_number(&w));
+            lept_free(&w);
+
+            /* cut short: the error is that of lept_parse_n() on the same bytes */
+            json[size - 1] = '[';
+            write_file(path, json, size);
+            EXPECT_EQ_RESULT(lept_parse_n(&v, json, size, NULL), lept_parse_file(&w, path, &options));
+            memset(json, ' ', size);
+            memcpy(json + size - 3, "\"ab", 3);
+            write_file(path, json, size);
+            EXPECT_EQ_RESULT(LEPT_PARSE_MISS_QUOTATION_MARK, lept_parse_file(&w, path, &options));
+        }
+    }
+
+    write_file(path, "", 0);
+    EXPECT_EQ_RESULT(LEPT_PARSE_EXPECT_VALUE, lept_parse_file(&w, path, NULL));
+
+    remove(path);
+    EXPECT_EQ_RESULT(LEPT_PARSE_FILE_ERROR, lept_parse_file(&w, path, NULL));
+    EXPECT_EQ_TYPE(LEPT_NULL, lept_get_type(&w));
+    EXPECT_EQ_INT(LEPT_STRINGIFY_WRITE_ERROR, lept_stringify_path(&w, "no-such-directory/leptjson_test_file.json"));
+    free(json);
+#pragma GCC diagnostic pop
+}
+
+static void test_parse_n() {
+    lept_value v;
+    size_t consumed;
+
+    TEST_PARSE_N(LEPT_PARSE_OK, "null");
+    TEST_PARSE_N(LEPT_PARSE_OK, "-1.5e-10");
+    TEST_PARSE_N(LEPT_PARSE_OK, "0");
+    TEST_PARSE_N(LEPT_PARSE_OK, "\"\\uD834\\uDD1E\"");
+    TEST_PARSE_N(LEPT_PARSE_OK, " [ 1 , { \"a\" : [ ] } ] ");
+    TEST_PARSE_N(LEPT_PARSE_EXPECT_VALUE, " ");
+    TEST_PARSE_N(LEPT_PARSE_INVALID_VALUE, "tru");
+    TEST_PARSE_N(LEPT_PARSE_INVALID_VALUE, "-");
+    TEST_PARSE_N(LEPT_PARSE_INVALID_VALUE, "1.");
+    TEST_PARSE_N(LEPT_PARSE_INVALID_VALUE, "1e+");
+    TEST_PARSE_N(LEPT_PARSE_MISS_QUOTATION_MARK, "\"abc");
+    TEST_PARSE_N(LEPT_PARSE_INVALID_STRING_ESCAPE, "\"\\");
+    TEST_PARSE_N(LEPT_PARSE_INVALID_UNICODE_HEX, "\"\\u12");
+    TEST_PARSE_N(LEPT_PARSE_INVALID_UNICODE_SURROGATE, "\"\\uD800\\");
+    TEST_PARSE_N(LEPT_PARSE_INVALID_UNICODE_HEX, "\"\\uD800\\uDC");
+    TEST_PARSE_N(LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, "[1");
+    TEST_PARSE_N(LEPT_PARSE_MISS_KEY, "{");
+    TEST_PARSE_N(LEPT_PARSE_MISS_COLON, "{\"a\"");
+    TEST_PARSE_N(LEPT_PARSE_EXPECT_VALUE, "{\"a\":");
+    TEST_PARSE_N(LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET, "{\"a\":1");
+
+    /* bytes after @len are not part of the input */
+    lept_init(&v);
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse_n(&v, "1234", 3, NULL));
+    EXPECT_EQ_DOUBLE(123.0, lept_get_number(&v));
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse_n(&v, "[1]]", 3, NULL));
+    lept_free(&v);
+    EXPECT_EQ_RESULT(LEPT_PARSE_MISS_QUOTATION_MARK, lept_parse_n(&v, "\"ab\"", 3, NULL));
+
+    /* embedded NUL bytes are ordinary input */
+    EXPECT_EQ_RESULT(LEPT_PARSE_INVALID_STRING_CHAR, lept_parse_n(&v, "\"a\0b\"", 5, NULL));
+    EXPECT_EQ_RESULT(LEPT_PARSE_ROOT_NOT_SINGULAR, lept_parse_n(&v, "null\0", 5, &consumed));
+    EXPECT_TRUE(consumed == 4);
+    EXPECT_EQ_TYPE(LEPT_NULL, lept_get_type(&v));
+    lept_free(&v);
+}
+
+static void test_parse_insitu() {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat"
+    char json[] = "{\"k\\n\":\"a\\u00A2\\uD834\\uDD1E\\\"b\",\"a\":[\"\",\"Hello\\nWorld\"],\"n\":1}";
+    char bad[] = "[\"abc\",\"\\v\"]";
+    lept_value v, *pv;
+
+    lept_init(&v);
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse_insitu(&v, json));
+    EXPECT_EQ_SIZE_T(3, lept_get_object_size(&v));
+    EXPECT_EQ_STRING("k\n", lept_get_object_key(&v, 0), lept_get_object_key_length(&v, 0));
+    EXPECT_TRUE(lept_get_object_key(&v, 0) > json && lept_get_object_key(&v, 0) < json + sizeof(json));
+    pv = lept_get_object_value(&v, 0);
+    EXPECT_EQ_STRING("a\xC2\xA2\xF0\x9D\x84\x9E\"b", lept_get_string(pv), lept_get_string_length(pv));
+    EXPECT_TRUE(lept_get_string(pv) > json && lept_get_string(pv) < json + sizeof(json));
+    EXPECT_EQ_INT('\0', lept_get_string(pv)[lept_get_string_length(pv)]);
+    pv = lept_get_object_value(&v, 1);
+    EXPECT_EQ_STRING("", lept_get_string(lept_get_array_element(pv, 0)), lept_get_string_length(lept_get_array_element(pv, 0)));
+    EXPECT_EQ_STRING("Hello\nWorld", lept_get_string(lept_get_array_element(pv, 1)), lept_get_string_length(lept_get_array_element(pv, 1)));
+
+    /* mutation takes ownership where needed */
+    lept_set_string(lept_get_array_element(pv, 0), "x", 1);
+    lept_set_number(lept_set_object_value(&v, "new", 3), 2.0);
+    lept_remove_object_value(&v, 0);
+    EXPECT_EQ_STRING("a", lept_get_object_key(&v, 0), lept_get_object_key_length(&v, 0));
+    lept_free(&v);
+
+    EXPECT_EQ_RESULT(LEPT_PARSE_INVALID_STRING_ESCAPE, lept_parse_insitu(&v, bad));
+    EXPECT_EQ_TYPE(LEPT_NULL, lept_get_type(&v));
+#pragma GCC diagnostic pop
+}
+
+typedef struct {
+    size_t allocs, frees;
+} counting_stats;
+
+static void* counting_alloc(void* ctx, size_t size) {
+    ((counting_stats*)ctx)->allocs++;
+    return malloc(size);
+}
+
+static void* counting_realloc(void* ctx, void* ptr, size_t size) {
+    (void)ctx;
+    return realloc(ptr, size);
+}
+
+static void counting_free(void* ctx, void* ptr) {
+    ((counting_stats*)ctx)->frees++;
+    free(ptr);
+}
+
+static void test_allocator() {
+    static const char json[] = "{\"s\":\"abc\",\"a\":[1,2,{\"k\":\"v\"}]}";
+    counting_stats global = { 0, 0 }, local = { 0, 0 };
+    lept_allocator ga, la;
+    lept_arena a;
+    lept_value v;
+    char* json2;
+    size_t length;
+
+    ga.alloc = la.alloc = counting_alloc;
+    ga.realloc = la.realloc = counting_realloc;
+    ga.free = la.free = counting_free;
+    ga.ctx = &global;
+    la.ctx = &local;
+
+    lept_set_allocator(&ga);
+    lept_init(&v);
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse(&v, json));
+    json2 = lept_stringify(&v, &length);
+    EXPECT_EQ_STRING(json, json2, length);
+    lept_get_allocator()->free(lept_get_allocator()->ctx, json2);
+    lept_free(&v);
+    EXPECT_TRUE(global.allocs > 0);
+    EXPECT_TRUE(global.allocs == global.frees);
+
+    /* per-call allocator for the parse stack and the stringify buffer */
+    global.allocs = global.frees = 0;
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse_with(&v, json, &la));
+    json2 = lept_stringify_with(&v, &length, &la);
+    EXPECT_EQ_STRING(json, json2, length);
+    la.free(la.ctx, json2);
+    lept_free(&v);
+    EXPECT_TRUE(local.allocs == 2);
+    EXPECT_TRUE(local.allocs == local.frees);
+    EXPECT_TRUE(global.allocs > 0);
+    EXPECT_TRUE(global.allocs == global.frees);
+
+    /* arena blocks */
+    local.allocs = local.frees = 0;
+    lept_arena_init(&a, 0, &la);
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse_arena(&a, &v, json));
+    lept_arena_free(&a);
+    EXPECT_TRUE(local.allocs == 1);
+    EXPECT_TRUE(local.allocs == local.frees);
+
+    lept_set_allocator(NULL);
+}
+
+static void test_parser() {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat"
+    static const char json[] = "[1,{\"a\":[\"b\",null]},\"long enough to leave the value\"]";
+    counting_stats global = { 0, 0 };
+    lept_allocator ga;
+    lept_parser* p;
+    lept_value v, expect;
+    char* big;
+    size_t i;
+
+    ga.alloc = counting_alloc;
+    ga.realloc = counting_realloc;
+    ga.free = counting_free;
+    ga.ctx = &global;
+
+    lept_init(&expect);
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse(&expect, json));
+    p = lept_parser_new(NULL, 4096);
+    lept_init(&v);
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parser_parse(p, &v, json, sizeof(json) - 1));
+    EXPECT_TRUE(lept_is_equal(&expect, &v));
+    lept_free(&v);
+    EXPECT_TRUE(lept_parser_stack_size(p) > 0);
+
+    /* the second parse allocates the tree and nothing else */
+    lept_set_allocator(&ga);
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parser_parse(p, &v, json, sizeof(json) - 1));
+    EXPECT_EQ_SIZE_T(5, global.allocs);
+    lept_free(&v);
+    global.allocs = global.frees = 0;
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parse_ex(&v, json, sizeof(json) - 1, NULL));
+    EXPECT_EQ_SIZE_T(6, global.allocs);
+    lept_free(&v);
+    lept_set_allocator(NULL);
+
+    /* errors leave the handle ready for the next document */
+    EXPECT_EQ_RESULT(LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET, lept_parser_parse(p, &v, "[{\"a\":1]", 9));
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parser_parse(p, &v, json, sizeof(json) - 1));
+    EXPECT_TRUE(lept_is_equal(&expect, &v));
+    lept_free(&v);
+
+    /* a large document grows the stack past the limit; it is cut back afterwards */
+    big = (char*)malloc(20001);
+    for (i = 0; i < 20000; i++)
+        big[i] = i % 2 ? '0' : ',';
+    big[0] = '[';
+    big[20000] = ']';
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parser_parse(p, &v, big, 20001));
+    EXPECT_EQ_SIZE_T(10000, lept_get_array_size(&v));
+    EXPECT_EQ_SIZE_T(4096, lept_parser_stack_size(p));
+    lept_free(&v);
+    free(big);
+
+    /* options live on the handle */
+    lept_parser_options(p)->engine = LEPT_ENGINE_INDEXED;
+    EXPECT_EQ_RESULT(LEPT_PARSE_OK, lept_parser_parse(p, &v, json, sizeof(json) - 1));
+    EXPECT_TRUE(lept_is_equal(&expect, &v));
+    lept_free(&v);
+    lept_parser_free(p);
+    lept_free(&expect);
+#pragma GCC diagnostic pop
+}
+
 static void test_access() {
     test_access_null();
     test_access_boolean();
     test_access_number();
+    test_access_integer();
     test_access_string();
+    test_access_short_string();
     test_access_array();
     test_access_object();
+    test_access_object_hash();
 }
 
 int main() {
@@ -763,6 +2366,19 @@ int main() {
     test_move();
     test_swap();
     test_access();
+    test_arena();
+    test_key_pool();
+    test_allocator();
+    test_parser();
+    test_parse_insitu();
+    test_parse_n();
+    test_parse_sax();
+    test_parse_push();
+    test_parse_cursor();
+    test_parse_ndjson();
+    test_parse_parallel();
+    test_parse_depth();
+    test_parse_file();
     printf("%d/%d (%3.2f) passed\n", test_pass, test_count, test_pass * 100.0 / test_count);
     return main_ret;
 }